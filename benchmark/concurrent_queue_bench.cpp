@@ -0,0 +1,218 @@
+// concurrent_queue_bench.cpp -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file concurrent_queue_bench.cpp
+ *  Runs a crawler frontier on worker threads sharing a
+ *  concurrent_hashed_queue, and a hashed_queue behind a std::mutex.
+ *
+ *  Build, from the top of the tree:
+ *    g++ -std=c++17 -O2 -DNDEBUG -pthread -I.
+ *        benchmark/concurrent_queue_bench.cpp -o concurrent_queue_bench
+ *
+ *  Usage: concurrent_queue_bench [--threads T] [--ops N] [--keys K]
+ *                                [--csv]
+ *  For 1, 2, 4... up to --threads (default the hardware concurrency)
+ *  workers, each making --ops (default 1e6) rounds of one push of a key
+ *  drawn among --keys (default 1e6), refused if it is queued, and one
+ *  pop, on a queue first filled with a tenth of the keys, prints for
+ *  each queue:
+ *    ms        the best of a few runs
+ *    mops      pushes and pops, millions a second
+ *    refused   pushes refused as duplicates
+ *  with:
+ *    locked    hashed_queue guarded by a std::mutex
+ *    sharded   concurrent_hashed_queue, default shard count
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "concurrent_hashed_queue.h"
+#include "hashed_queue.h"
+
+namespace
+{
+  bool g_csv = false;
+
+  // The interface of concurrent_hashed_queue, one lock around it all.
+  struct locked_queue
+  {
+    std::mutex m;
+    stl::hashed_queue<std::uint64_t> c;
+
+    bool
+    push(std::uint64_t x)
+    {
+      std::lock_guard<std::mutex> lock(m);
+      return c.push(x).second;
+    }
+
+    std::optional<std::uint64_t>
+    try_pop()
+    {
+      std::lock_guard<std::mutex> lock(m);
+      if (c.empty())
+        return std::nullopt;
+      const std::uint64_t x = c.front();
+      c.pop();
+      return x;
+    }
+  };
+
+  using sharded_queue = stl::concurrent_hashed_queue<std::uint64_t>;
+
+  struct result
+  {
+    double ms = 0;
+    std::size_t refused = 0;
+  };
+
+  struct config
+  {
+    std::size_t threads;
+    std::size_t ops;
+    std::size_t keys;
+  };
+
+  // xorshift64, one a thread.
+  std::uint64_t
+  next(std::uint64_t& x)
+  {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+  }
+
+  template<typename Queue>
+    result
+    run_once(const config& cfg)
+    {
+      Queue q;
+      for (std::size_t k = 0; k < cfg.keys; k += 10)
+        q.push(k);
+      std::atomic<std::size_t> refused{0};
+      std::atomic<bool> go{false};
+
+      std::vector<std::thread> pool;
+      for (std::size_t t = 0; t != cfg.threads; ++t)
+        pool.emplace_back([&, t]
+          {
+            std::uint64_t x = 0x9e3779b97f4a7c15ull * (t + 1);
+            std::size_t nb_refused = 0;
+            while (!go.load())
+              std::this_thread::yield();
+            for (std::size_t i = 0; i != cfg.ops; ++i)
+              {
+                if (!q.push(next(x) % cfg.keys))
+                  ++nb_refused;
+                q.try_pop();
+              }
+            refused.fetch_add(nb_refused);
+          });
+
+      const auto t0 = std::chrono::steady_clock::now();
+      go.store(true);
+      for (auto& th : pool)
+        th.join();
+      const auto t1 = std::chrono::steady_clock::now();
+
+      result r;
+      r.ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+      r.refused = refused.load();
+      return r;
+    }
+
+  // The best of a few runs.
+  template<typename Queue>
+    result
+    measure(const config& cfg)
+    {
+      result best;
+      for (int run = 0; run != 3; ++run)
+        {
+          const result r = run_once<Queue>(cfg);
+          if (run == 0 || r.ms < best.ms)
+            best = r;
+        }
+      return best;
+    }
+
+  void
+  print(const config& cfg, const char* name, const result& r)
+  {
+    const double mops = double(2 * cfg.threads * cfg.ops) / (r.ms * 1e3);
+    if (g_csv)
+      std::printf("%zu,%zu,%s,%.3f,%.3f,%zu\n", cfg.threads, cfg.keys, name
+                , r.ms, mops, r.refused);
+    else
+      std::printf("%7zu %8s %10.3f %8.3f %12zu\n", cfg.threads, name, r.ms
+                , mops, r.refused);
+  }
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  config cfg{1, 1000000, 1000000};
+  for (int i = 1; i < argc; ++i)
+    {
+      if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        max_threads = std::strtoul(argv[++i], nullptr, 10);
+      else if (std::strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+        cfg.ops = std::size_t(std::strtod(argv[++i], nullptr));
+      else if (std::strcmp(argv[i], "--keys") == 0 && i + 1 < argc)
+        cfg.keys = std::size_t(std::strtod(argv[++i], nullptr));
+      else if (std::strcmp(argv[i], "--csv") == 0)
+        g_csv = true;
+      else
+        {
+          std::fprintf(stderr, "usage: %s [--threads T] [--ops N]"
+                               " [--keys K] [--csv]\n", argv[0]);
+          return 1;
+        }
+    }
+  cfg.keys = std::max<std::size_t>(cfg.keys, 1);
+
+  if (g_csv)
+    std::printf("threads,keys,queue,ms,mops,refused\n");
+  else
+    std::printf("%7s %8s %10s %8s %12s\n", "threads", "queue", "ms", "mops"
+              , "refused");
+  for (cfg.threads = 1; cfg.threads <= max_threads; cfg.threads *= 2)
+    {
+      print(cfg, "locked", measure<locked_queue>(cfg));
+      print(cfg, "sharded", measure<sharded_queue>(cfg));
+    }
+}
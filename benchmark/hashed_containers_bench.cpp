@@ -0,0 +1,456 @@
+// hashed_containers_bench.cpp -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file hashed_containers_bench.cpp
+ *  Compares hashed_queue and hashed_stack with the usual two container
+ *  compositions: std::list + std::unordered_map (the LRU layout) and
+ *  std::queue + std::unordered_set.
+ *
+ *  Build, from the top of the tree:
+ *    g++ -std=c++17 -O2 -DNDEBUG -I. benchmark/hashed_containers_bench.cpp
+ *        -o hashed_containers_bench
+ *
+ *  Usage: hashed_containers_bench [--min N] [--max N] [--csv]
+ *  The element count sweeps the powers of ten from --min (default 1e3) to
+ *  --max (default 1e6, up to 1e8), for int64, 16-byte POD and std::string
+ *  keys, over the push, pop, contains, extract and iterate workloads.
+ *
+ *  Reported per workload: ns/op, allocations per operation, and for push
+ *  the bytes held per element once all the elements are in.  Allocations
+ *  are counted by replacing the global operator new and delete.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <new>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "hashed_queue.h"
+#include "hashed_stack.h"
+
+namespace
+{
+  // allocation accounting
+  std::size_t g_allocs = 0;
+  std::size_t g_live_bytes = 0;
+
+  // Each block carries its size ahead of the storage handed out.
+  constexpr std::size_t header = alignof(std::max_align_t);
+
+  void*
+  counted_alloc(std::size_t n)
+  {
+    void* p = std::malloc(n + header);
+    if (!p)
+      throw std::bad_alloc();
+    *static_cast<std::size_t*>(p) = n;
+    ++g_allocs;
+    g_live_bytes += n;
+    return static_cast<char*>(p) + header;
+  }
+
+  void
+  counted_free(void* p) noexcept
+  {
+    if (!p)
+      return;
+    char* block = static_cast<char*>(p) - header;
+    g_live_bytes -= *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+  }
+} // namespace
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::size_t) noexcept { counted_free(p); }
+
+namespace
+{
+  // key types
+  struct pod16
+  {
+    std::uint64_t hi;
+    std::uint64_t lo;
+
+    friend bool
+    operator==(const pod16& x, const pod16& y) noexcept
+    { return x.hi == y.hi && x.lo == y.lo; }
+  };
+
+  struct pod16_hash
+  {
+    std::size_t
+    operator()(const pod16& k) const noexcept
+    { return std::hash<std::uint64_t>()(k.hi * 0x9e3779b97f4a7c15ull ^ k.lo); }
+  };
+
+  template<typename Key>
+    struct key_traits;
+
+  template<>
+    struct key_traits<std::int64_t>
+    {
+      using hash = std::hash<std::int64_t>;
+      static const char* name() { return "int64"; }
+      static std::int64_t make(std::uint64_t i)
+      { return std::int64_t(i * 0x9e3779b97f4a7c15ull); }
+    };
+
+  template<>
+    struct key_traits<pod16>
+    {
+      using hash = pod16_hash;
+      static const char* name() { return "pod16"; }
+      static pod16 make(std::uint64_t i)
+      { return { i * 0x9e3779b97f4a7c15ull, ~i }; }
+    };
+
+  // Long enough not to fit the small string buffer.
+  template<>
+    struct key_traits<std::string>
+    {
+      using hash = std::hash<std::string>;
+      static const char* name() { return "string"; }
+      static std::string make(std::uint64_t i)
+      {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "key-%020llu"
+                    , static_cast<unsigned long long>(i));
+        return buf;
+      }
+    };
+
+  // Containers under test, behind a common push/pop/contains/extract/
+  // for_each interface.  The compositions without a cheap extract or
+  // iteration say so with has_extract / has_iterate.
+  template<typename Key>
+    struct hashed_queue_adaptor
+    {
+      static const char* name() { return "hashed_queue"; }
+      static constexpr bool has_extract = true;
+      static constexpr bool has_iterate = true;
+
+      stl::hashed_queue<Key, typename key_traits<Key>::hash> c;
+
+      void push(const Key& k) { c.push(k); }
+      void pop() { c.pop(); }
+      bool contains(const Key& k) const { return c.contains(k); }
+      bool extract(const Key& k) { return c.extract(k).has_value(); }
+      template<typename F> void for_each(F f) const
+      { for (const Key& k : c) f(k); }
+    };
+
+  template<typename Key>
+    struct hashed_stack_adaptor
+    {
+      static const char* name() { return "hashed_stack"; }
+      static constexpr bool has_extract = true;
+      static constexpr bool has_iterate = true;
+
+      stl::hashed_stack<Key, typename key_traits<Key>::hash> c;
+
+      void push(const Key& k) { c.push(k); }
+      void pop() { c.pop(); }
+      bool contains(const Key& k) const { return c.contains(k); }
+      bool extract(const Key& k) { return c.extract(k).has_value(); }
+      template<typename F> void for_each(F f) const
+      { for (const Key& k : c) f(k); }
+    };
+
+  template<typename Key>
+    struct list_map_adaptor
+    {
+      static const char* name() { return "list+unordered_map"; }
+      static constexpr bool has_extract = true;
+      static constexpr bool has_iterate = true;
+
+      using list_type = std::list<Key>;
+      list_type l;
+      std::unordered_map<Key, typename list_type::iterator
+                       , typename key_traits<Key>::hash> m;
+
+      void
+      push(const Key& k)
+      {
+        auto r = m.try_emplace(k);
+        if (r.second)
+          r.first->second = l.insert(l.end(), k);
+      }
+
+      void
+      pop()
+      {
+        m.erase(l.front());
+        l.pop_front();
+      }
+
+      bool contains(const Key& k) const { return m.count(k) != 0; }
+
+      bool
+      extract(const Key& k)
+      {
+        auto it = m.find(k);
+        if (it == m.end())
+          return false;
+        l.erase(it->second);
+        m.erase(it);
+        return true;
+      }
+
+      template<typename F> void for_each(F f) const
+      { for (const Key& k : l) f(k); }
+    };
+
+  template<typename Key>
+    struct queue_set_adaptor
+    {
+      static const char* name() { return "queue+unordered_set"; }
+      static constexpr bool has_extract = false;
+      static constexpr bool has_iterate = false;
+
+      std::queue<Key> q;
+      std::unordered_set<Key, typename key_traits<Key>::hash> s;
+
+      void
+      push(const Key& k)
+      {
+        if (s.insert(k).second)
+          q.push(k);
+      }
+
+      void
+      pop()
+      {
+        s.erase(q.front());
+        q.pop();
+      }
+
+      bool contains(const Key& k) const { return s.count(k) != 0; }
+      bool extract(const Key&) { return false; }
+      template<typename F> void for_each(F) const { }
+    };
+
+  // reporting
+  bool g_csv = false;
+
+  struct result
+  {
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_elem;      // negative if not measured
+  };
+
+  void
+  print_header()
+  {
+    if (g_csv)
+      std::printf("container,key,n,workload,ns_per_op,allocs_per_op"
+                  ",bytes_per_elem\n");
+    else
+      std::printf("%-20s %-7s %10s %-9s %10s %10s %10s\n", "container", "key"
+                , "n", "workload", "ns/op", "allocs/op", "bytes/elem");
+  }
+
+  void
+  print_row(const char* cont, const char* key, std::size_t n
+          , const char* workload, const result* r)
+  {
+    if (g_csv)
+      {
+        if (r)
+          std::printf("%s,%s,%zu,%s,%.2f,%.3f,%.1f\n", cont, key, n, workload
+                    , r->ns_per_op, r->allocs_per_op, r->bytes_per_elem);
+        else
+          std::printf("%s,%s,%zu,%s,,,\n", cont, key, n, workload);
+        return;
+      }
+    if (!r)
+      {
+        std::printf("%-20s %-7s %10zu %-9s %10s %10s %10s\n", cont, key, n
+                  , workload, "n/a", "n/a", "");
+        return;
+      }
+    char bytes[16] = "";
+    if (r->bytes_per_elem >= 0)
+      std::snprintf(bytes, sizeof(bytes), "%.1f", r->bytes_per_elem);
+    std::printf("%-20s %-7s %10zu %-9s %10.2f %10.3f %10s\n", cont, key, n
+              , workload, r->ns_per_op, r->allocs_per_op, bytes);
+  }
+
+  // Keeps the compiler from dropping the work being measured.
+  template<typename T>
+    void
+    do_not_optimize(const T& v)
+    { asm volatile("" : : "g"(&v) : "memory"); }
+
+  // Times @a f, performing @a ops operations.
+  template<typename F>
+    result
+    measure(std::size_t ops, F f)
+    {
+      const std::size_t allocs = g_allocs;
+      const auto t0 = std::chrono::steady_clock::now();
+      f();
+      const auto t1 = std::chrono::steady_clock::now();
+      const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+      return { ns / double(ops), double(g_allocs - allocs) / double(ops), -1 };
+    }
+
+  template<typename Adaptor, typename Key>
+    void
+    run(const std::vector<Key>& keys, const std::vector<Key>& misses
+      , const std::vector<std::size_t>& order)
+    {
+      const std::size_t n = keys.size();
+      const char* cont = Adaptor::name();
+      const char* kname = key_traits<Key>::name();
+
+      // push, then the bytes held by the filled container
+      {
+        const std::size_t live = g_live_bytes;
+        auto a = std::make_unique<Adaptor>();
+        result r = measure(n, [&] { for (const Key& k : keys) a->push(k); });
+        r.bytes_per_elem = double(g_live_bytes - live) / double(n);
+        print_row(cont, kname, n, "push", &r);
+
+        // contains, half hits and half misses
+        result c = measure(2 * n, [&] {
+          std::size_t hits = 0;
+          for (std::size_t i = 0; i != n; ++i)
+            hits += a->contains(keys[i]) + a->contains(misses[i]);
+          do_not_optimize(hits);
+        });
+        print_row(cont, kname, n, "contains", &c);
+
+        if (Adaptor::has_iterate)
+          {
+            result it = measure(n, [&] {
+              std::size_t count = 0;
+              a->for_each([&count](const Key& k) {
+                do_not_optimize(k);
+                ++count;
+              });
+              do_not_optimize(count);
+            });
+            print_row(cont, kname, n, "iterate", &it);
+          }
+        else
+          print_row(cont, kname, n, "iterate", nullptr);
+
+        result p = measure(n, [&] { for (std::size_t i = 0; i != n; ++i) a->pop(); });
+        print_row(cont, kname, n, "pop", &p);
+      }
+
+      // extract half of the elements, in random order
+      if (Adaptor::has_extract)
+        {
+          auto a = std::make_unique<Adaptor>();
+          for (const Key& k : keys)
+            a->push(k);
+          const std::size_t m = n / 2;
+          result e = measure(m, [&] {
+            std::size_t found = 0;
+            for (std::size_t i = 0; i != m; ++i)
+              found += a->extract(keys[order[i]]);
+            do_not_optimize(found);
+          });
+          print_row(cont, kname, n, "extract", &e);
+        }
+      else
+        print_row(cont, kname, n, "extract", nullptr);
+    }
+
+  template<typename Key>
+    void
+    sweep(std::size_t min_n, std::size_t max_n)
+    {
+      for (std::size_t n = min_n; n <= max_n; n *= 10)
+        {
+          std::vector<Key> keys, misses;
+          keys.reserve(n);
+          misses.reserve(n);
+          for (std::size_t i = 0; i != n; ++i)
+            {
+              keys.push_back(key_traits<Key>::make(i));
+              misses.push_back(key_traits<Key>::make(i + n));
+            }
+          std::vector<std::size_t> order(n);
+          for (std::size_t i = 0; i != n; ++i)
+            order[i] = i;
+          std::shuffle(order.begin(), order.end(), std::mt19937_64(n));
+
+          run<hashed_queue_adaptor<Key>>(keys, misses, order);
+          run<hashed_stack_adaptor<Key>>(keys, misses, order);
+          run<list_map_adaptor<Key>>(keys, misses, order);
+          run<queue_set_adaptor<Key>>(keys, misses, order);
+        }
+    }
+
+  std::size_t
+  parse_count(const char* s)
+  { return static_cast<std::size_t>(std::strtod(s, nullptr)); }
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::size_t min_n = 1000;
+  std::size_t max_n = 1000000;
+  for (int i = 1; i < argc; ++i)
+    {
+      if (!std::strcmp(argv[i], "--min") && i + 1 < argc)
+        min_n = parse_count(argv[++i]);
+      else if (!std::strcmp(argv[i], "--max") && i + 1 < argc)
+        max_n = parse_count(argv[++i]);
+      else if (!std::strcmp(argv[i], "--csv"))
+        g_csv = true;
+      else
+        {
+          std::fprintf(stderr, "usage: %s [--min N] [--max N] [--csv]\n"
+                     , argv[0]);
+          return 2;
+        }
+    }
+  min_n = std::max<std::size_t>(min_n, 1);
+  max_n = std::min<std::size_t>(max_n, 100000000);
+
+  print_header();
+  sweep<std::int64_t>(min_n, max_n);
+  sweep<pod16>(min_n, max_n);
+  sweep<std::string>(min_n, max_n);
+}
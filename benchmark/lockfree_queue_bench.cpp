@@ -0,0 +1,295 @@
+// lockfree_queue_bench.cpp -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file lockfree_queue_bench.cpp
+ *  Moves elements from producer threads to consumer threads through a
+ *  lockfree_hashed_queue, and through a hashed_queue behind a std::mutex.
+ *
+ *  Build, from the top of the tree:
+ *    g++ -std=c++17 -O2 -DNDEBUG -pthread -I.
+ *        benchmark/lockfree_queue_bench.cpp -o lockfree_queue_bench
+ *
+ *  Usage: lockfree_queue_bench [--threads T] [--pushes N] [--keys K]
+ *                              [--capacity C] [--churn M] [--csv]
+ *  For 1, 2, 4... up to --threads (default 4) producers, and as many
+ *  consumers, each producer cycling through --keys keys of its own
+ *  (default 64) until it had --pushes (default 1e6) of them accepted,
+ *  in a queue of --capacity (default 1024) elements, prints for each
+ *  queue:
+ *    ms        the best of a few runs
+ *    mops      elements moved, millions a second
+ *    refused   pushes refused, mostly as duplicates
+ *  with:
+ *    locked    hashed_queue guarded by a std::mutex
+ *    lockfree  lockfree_hashed_queue
+ *
+ *  Then, on one thread, with the queue half full, prints for each queue
+ *  the ns a contains() of a key not queued takes:
+ *    fresh     on a queue only ever pushed to
+ *    churned   after --churn (default 1e6) pops, each followed by the push
+ *              of a fresh key, so that the index is full of erased keys
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "hashed_queue.h"
+#include "lockfree_hashed_queue.h"
+
+namespace
+{
+  bool g_csv = false;
+
+  // The interface of lockfree_hashed_queue, one lock around it all.
+  struct locked_queue
+  {
+    std::mutex m;
+    stl::hashed_queue<std::uint64_t> c;
+    std::size_t cap;
+
+    explicit
+    locked_queue(std::size_t capacity)
+    : cap(capacity)
+    { }
+
+    bool
+    try_push(std::uint64_t x)
+    {
+      std::lock_guard<std::mutex> lock(m);
+      if (c.size() == cap)
+        return false;
+      return c.push(x).second;
+    }
+
+    std::optional<std::uint64_t>
+    try_pop()
+    {
+      std::lock_guard<std::mutex> lock(m);
+      if (c.empty())
+        return std::nullopt;
+      const std::uint64_t x = c.front();
+      c.pop();
+      return x;
+    }
+
+    bool
+    contains(std::uint64_t x)
+    {
+      std::lock_guard<std::mutex> lock(m);
+      return c.contains(x);
+    }
+  };
+
+  using lockfree_queue = stl::lockfree_hashed_queue<std::uint64_t>;
+
+  struct result
+  {
+    double ms = 0;
+    std::size_t refused = 0;
+  };
+
+  struct config
+  {
+    std::size_t threads;
+    std::size_t pushes;
+    std::size_t keys;
+    std::size_t capacity;
+  };
+
+  template<typename Queue>
+    result
+    run_once(const config& cfg)
+    {
+      Queue q(cfg.capacity);
+      const std::size_t total = cfg.threads * cfg.pushes;
+      std::atomic<std::size_t> nb_popped{0};
+      std::atomic<std::size_t> refused{0};
+      std::atomic<bool> go{false};
+
+      std::vector<std::thread> pool;
+      for (std::size_t p = 0; p != cfg.threads; ++p)
+        pool.emplace_back([&, p]
+          {
+            while (!go.load())
+              std::this_thread::yield();
+            std::size_t accepted = 0, nb_refused = 0;
+            for (std::size_t i = 0; accepted != cfg.pushes; ++i)
+              {
+                if (q.try_push(std::uint64_t(p) << 32 | (i % cfg.keys)))
+                  ++accepted;
+                else if (++nb_refused % 64 == 0)
+                  std::this_thread::yield();
+              }
+            refused.fetch_add(nb_refused);
+          });
+      for (std::size_t c = 0; c != cfg.threads; ++c)
+        pool.emplace_back([&]
+          {
+            while (!go.load())
+              std::this_thread::yield();
+            std::size_t empty = 0;
+            while (nb_popped.load(std::memory_order_relaxed) != total)
+              if (q.try_pop())
+                nb_popped.fetch_add(1, std::memory_order_relaxed);
+              else if (++empty % 64 == 0)
+                std::this_thread::yield();
+          });
+
+      const auto t0 = std::chrono::steady_clock::now();
+      go.store(true);
+      for (auto& th : pool)
+        th.join();
+      const auto t1 = std::chrono::steady_clock::now();
+
+      result r;
+      r.ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+      r.refused = refused.load();
+      return r;
+    }
+
+  // The best of a few runs.
+  template<typename Queue>
+    result
+    measure(const config& cfg)
+    {
+      result best;
+      for (int run = 0; run != 3; ++run)
+        {
+          const result r = run_once<Queue>(cfg);
+          if (run == 0 || r.ms < best.ms)
+            best = r;
+        }
+      return best;
+    }
+
+  // ns a contains() miss takes.
+  template<typename Queue>
+    double
+    time_misses(Queue& q)
+    {
+      constexpr std::size_t lookups = 1000000;
+      std::size_t found = 0;
+      const auto t0 = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i != lookups; ++i)
+        found += q.contains(std::uint64_t(1) << 62 | i);
+      const auto t1 = std::chrono::steady_clock::now();
+      if (found)
+        std::abort();
+      return std::chrono::duration<double, std::nano>(t1 - t0).count()
+             / double(lookups);
+    }
+
+  template<typename Queue>
+    void
+    measure_churn(const char* name, std::size_t capacity, std::size_t churn)
+    {
+      Queue q(capacity);
+      std::uint64_t key = 0;
+      while (key != capacity / 2)
+        q.try_push(key++);
+      const double fresh = time_misses(q);
+      for (std::size_t i = 0; i != churn; ++i)
+        {
+          q.try_pop();
+          q.try_push(key++);
+        }
+      const double churned = time_misses(q);
+      if (g_csv)
+        std::printf("%zu,%zu,%s,%.2f,%.2f\n", capacity, churn, name, fresh
+                  , churned);
+      else
+        std::printf("%8s %10.2f %10.2f\n", name, fresh, churned);
+    }
+
+  void
+  print(const config& cfg, const char* name, const result& r)
+  {
+    const double mops = double(cfg.threads * cfg.pushes) / (r.ms * 1e3);
+    if (g_csv)
+      std::printf("%zu,%zu,%zu,%s,%.3f,%.3f,%zu\n", cfg.threads, cfg.keys
+                , cfg.capacity, name, r.ms, mops, r.refused);
+    else
+      std::printf("%7zu %8s %10.3f %8.3f %12zu\n", cfg.threads, name, r.ms
+                , mops, r.refused);
+  }
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::size_t max_threads = 4;
+  std::size_t churn = 1000000;
+  config cfg{1, 1000000, 64, 1024};
+  for (int i = 1; i < argc; ++i)
+    {
+      if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        max_threads = std::strtoul(argv[++i], nullptr, 10);
+      else if (std::strcmp(argv[i], "--pushes") == 0 && i + 1 < argc)
+        cfg.pushes = std::size_t(std::strtod(argv[++i], nullptr));
+      else if (std::strcmp(argv[i], "--keys") == 0 && i + 1 < argc)
+        cfg.keys = std::strtoul(argv[++i], nullptr, 10);
+      else if (std::strcmp(argv[i], "--capacity") == 0 && i + 1 < argc)
+        cfg.capacity = std::strtoul(argv[++i], nullptr, 10);
+      else if (std::strcmp(argv[i], "--churn") == 0 && i + 1 < argc)
+        churn = std::size_t(std::strtod(argv[++i], nullptr));
+      else if (std::strcmp(argv[i], "--csv") == 0)
+        g_csv = true;
+      else
+        {
+          std::fprintf(stderr, "usage: %s [--threads T] [--pushes N]"
+                               " [--keys K] [--capacity C] [--churn M]"
+                               " [--csv]\n"
+                     , argv[0]);
+          return 1;
+        }
+    }
+  cfg.keys = std::max<std::size_t>(cfg.keys, 1);
+
+  if (g_csv)
+    std::printf("threads,keys,capacity,queue,ms,mops,refused\n");
+  else
+    std::printf("%7s %8s %10s %8s %12s\n", "threads", "queue", "ms", "mops"
+              , "refused");
+  for (cfg.threads = 1; cfg.threads <= max_threads; cfg.threads *= 2)
+    {
+      print(cfg, "locked", measure<locked_queue>(cfg));
+      print(cfg, "lockfree", measure<lockfree_queue>(cfg));
+    }
+
+  if (g_csv)
+    std::printf("\ncapacity,churn,queue,fresh_ns,churned_ns\n");
+  else
+    std::printf("\n%8s %10s %10s\n", "queue", "fresh", "churned");
+  measure_churn<locked_queue>("locked", cfg.capacity, churn);
+  measure_churn<lockfree_queue>("lockfree", cfg.capacity, churn);
+}
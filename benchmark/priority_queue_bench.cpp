@@ -0,0 +1,264 @@
+// priority_queue_bench.cpp -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file priority_queue_bench.cpp
+ *  Runs Dijkstra's shortest paths on random graphs with a
+ *  hashed_priority_queue, updating the distance of a vertex in place,
+ *  and with a std::priority_queue, pushing it again and skipping the
+ *  stale entries as they come out (lazy deletion).
+ *
+ *  Build, from the top of the tree:
+ *    g++ -std=c++17 -O2 -DNDEBUG -I. benchmark/priority_queue_bench.cpp
+ *        -o priority_queue_bench
+ *
+ *  Usage: priority_queue_bench [--min N] [--max N] [--degree D] [--csv]
+ *  For graphs of --min to --max vertices (default 1e3 to 1e6), growing
+ *  tenfold, each with --degree (default 8) random edges a vertex, prints
+ *  for each queue:
+ *    ms        the best of a few runs
+ *    pushes    entries pushed
+ *    peak      most entries held at once, what the queue's memory follows
+ *  with:
+ *    lazy      std::priority_queue, lazy deletion
+ *    chained   hashed_priority_queue, the default chained index
+ *    flat      hashed_priority_queue, __detail::_Flat_index_policy
+ *  The distances found by the three are checked to agree.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "hashed_priority_queue.h"
+
+namespace
+{
+  bool g_csv = false;
+
+  using vertex = std::uint32_t;
+  using distance = std::uint64_t;
+  constexpr distance unreached = std::numeric_limits<distance>::max();
+
+  // Adjacency lists, packed.
+  struct graph
+  {
+    std::vector<std::size_t> first;   // of the edges of each vertex
+    std::vector<vertex> to;
+    std::vector<std::uint32_t> weight;
+  };
+
+  graph
+  random_graph(std::size_t n, std::size_t degree)
+  {
+    std::mt19937_64 gen(n);
+    graph g;
+    g.first.reserve(n + 1);
+    for (std::size_t v = 0; v != n; ++v)
+      {
+        g.first.push_back(g.to.size());
+        for (std::size_t e = 0; e != degree; ++e)
+          {
+            g.to.push_back(vertex(gen() % n));
+            g.weight.push_back(std::uint32_t(gen() % 1000 + 1));
+          }
+      }
+    g.first.push_back(g.to.size());
+    return g;
+  }
+
+  struct result
+  {
+    std::vector<distance> dist;
+    std::size_t pushes = 0;
+    std::size_t peak = 0;
+  };
+
+  result
+  lazy_dijkstra(const graph& g)
+  {
+    using entry = std::pair<distance, vertex>;
+    const std::size_t n = g.first.size() - 1;
+    result r;
+    r.dist.assign(n, unreached);
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> q;
+    r.dist[0] = 0;
+    q.emplace(0, 0);
+    r.pushes = r.peak = 1;
+    while (!q.empty())
+      {
+        const auto [d, v] = q.top();
+        q.pop();
+        if (d != r.dist[v])
+          continue;               // stale
+        for (std::size_t e = g.first[v]; e != g.first[v + 1]; ++e)
+          {
+            const distance nd = d + g.weight[e];
+            if (nd < r.dist[g.to[e]])
+              {
+                r.dist[g.to[e]] = nd;
+                q.emplace(nd, g.to[e]);
+                ++r.pushes;
+                if (q.size() > r.peak)
+                  r.peak = q.size();
+              }
+          }
+      }
+    return r;
+  }
+
+  template<typename Queue>
+    result
+    hashed_dijkstra(const graph& g)
+    {
+      const std::size_t n = g.first.size() - 1;
+      result r;
+      r.dist.assign(n, unreached);
+      Queue q;
+      r.dist[0] = 0;
+      q.push(0, 0);
+      r.pushes = r.peak = 1;
+      while (!q.empty())
+        {
+          const vertex v = q.top().first;
+          const distance d = q.top().second;
+          q.pop();
+          for (std::size_t e = g.first[v]; e != g.first[v + 1]; ++e)
+            {
+              const vertex w = g.to[e];
+              const distance nd = d + g.weight[e];
+              if (nd >= r.dist[w])
+                continue;
+              if (r.dist[w] == unreached)
+                {
+                  q.push(w, nd);
+                  ++r.pushes;
+                  if (q.size() > r.peak)
+                    r.peak = q.size();
+                }
+              else
+                q.decrease_key(w, nd);
+              r.dist[w] = nd;
+            }
+        }
+      return r;
+    }
+
+  using chained_queue
+    = stl::hashed_priority_queue<vertex, distance, std::greater<distance>>;
+  using flat_queue
+    = stl::hashed_priority_queue<vertex, distance, std::greater<distance>
+                               , std::hash<vertex>, std::equal_to<vertex>
+                               , std::allocator<std::pair<vertex, distance>>
+                               , stl::__detail::_Flat_index_policy>;
+
+  // The best of a few runs, in ms.
+  template<typename F>
+    double
+    measure(F f, result& r)
+    {
+      double best = 0;
+      for (int run = 0; run != 3; ++run)
+        {
+          const auto t0 = std::chrono::steady_clock::now();
+          r = f();
+          const auto t1 = std::chrono::steady_clock::now();
+          const double ms
+            = std::chrono::duration<double, std::milli>(t1 - t0).count();
+          if (run == 0 || ms < best)
+            best = ms;
+        }
+      return best;
+    }
+
+  const char* const g_names[] = { "lazy", "chained", "flat" };
+  constexpr std::size_t g_methods = sizeof(g_names) / sizeof(g_names[0]);
+
+  bool
+  run(std::size_t n, std::size_t degree)
+  {
+    const graph g = random_graph(n, degree);
+    result r[g_methods];
+    double ms[g_methods];
+    ms[0] = measure([&] { return lazy_dijkstra(g); }, r[0]);
+    ms[1] = measure([&] { return hashed_dijkstra<chained_queue>(g); }, r[1]);
+    ms[2] = measure([&] { return hashed_dijkstra<flat_queue>(g); }, r[2]);
+
+    for (std::size_t m = 0; m != g_methods; ++m)
+      if (g_csv)
+        std::printf("%zu,%zu,%s,%.3f,%zu,%zu\n", n, degree, g_names[m], ms[m]
+                  , r[m].pushes, r[m].peak);
+      else
+        std::printf("%10zu %7s %10.3f %10zu %10zu\n", n, g_names[m], ms[m]
+                  , r[m].pushes, r[m].peak);
+
+    for (std::size_t m = 1; m != g_methods; ++m)
+      if (r[m].dist != r[0].dist)
+        {
+          std::fprintf(stderr, "%s: distances differ from lazy, %zu vertices\n"
+                     , g_names[m], n);
+          return false;
+        }
+    return true;
+  }
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::size_t min_n = 1000, max_n = 1000000, degree = 8;
+  for (int i = 1; i < argc; ++i)
+    {
+      if (std::strcmp(argv[i], "--min") == 0 && i + 1 < argc)
+        min_n = std::size_t(std::strtod(argv[++i], nullptr));
+      else if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+        max_n = std::size_t(std::strtod(argv[++i], nullptr));
+      else if (std::strcmp(argv[i], "--degree") == 0 && i + 1 < argc)
+        degree = std::strtoul(argv[++i], nullptr, 10);
+      else if (std::strcmp(argv[i], "--csv") == 0)
+        g_csv = true;
+      else
+        {
+          std::fprintf(stderr, "usage: %s [--min N] [--max N] [--degree D]"
+                               " [--csv]\n", argv[0]);
+          return 1;
+        }
+    }
+
+  if (g_csv)
+    std::printf("vertices,degree,queue,ms,pushes,peak\n");
+  else
+    std::printf("%10s %7s %10s %10s %10s\n", "vertices", "queue", "ms"
+              , "pushes", "peak");
+  for (std::size_t n = std::max<std::size_t>(min_n, 1); n <= max_n; n *= 10)
+    if (!run(n, degree))
+      return 1;
+}
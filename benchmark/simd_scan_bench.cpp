@@ -0,0 +1,204 @@
+// simd_scan_bench.cpp -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file simd_scan_bench.cpp
+ *  Finds, for each key width, the table size up to which a linear scan
+ *  of the keys beats hashing and probing an index: the crossover that
+ *  __detail::__simd_scan_threshold() encodes.
+ *
+ *  Build, from the top of the tree:
+ *    g++ -std=c++17 -O2 -DNDEBUG -I. benchmark/simd_scan_bench.cpp
+ *        -o simd_scan_bench
+ *
+ *  Usage: simd_scan_bench [--max N] [--csv]
+ *  For 1, 2, 4 and 8-byte keys and table sizes up to --max (default 128),
+ *  half hits and half misses are looked up with:
+ *    scalar   one key at a time, std::find
+ *    sse2     __detail::__simd_find limited to the SSE2 kernel
+ *    simd     __detail::__simd_find, AVX2 when the CPU has it
+ *    chained  a hashed_stack indexed by the default chained index
+ *    flat     a hashed_stack indexed by __detail::_Flat_index_policy
+ *  The hashed_stacks compare their keys with a predicate other than
+ *  std::equal_to, which keeps them indexed at every size.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "hashed_stack.h"
+
+namespace
+{
+  // Equality the small tables cannot scan by bits.
+  struct opaque_equal
+  {
+    template<typename T>
+      bool
+      operator()(const T& x, const T& y) const noexcept
+      { return x == y; }
+  };
+
+  bool g_csv = false;
+  constexpr std::size_t lookups = 1 << 18;
+
+  // Keeps the compiler from dropping the work being measured.
+  template<typename T>
+    void
+    do_not_optimize(const T& v)
+    { asm volatile("" : : "g"(&v) : "memory"); }
+
+  // ns per lookup of @a probes, a power of two of them cycled until
+  // @a lookups are done.  The best of a few runs, to shed the noise.
+  template<typename T, typename F>
+    double
+    measure(const std::vector<T>& probes, F f)
+    {
+      const std::size_t mask = probes.size() - 1;
+      double best = 0;
+      for (int run = 0; run != 5; ++run)
+        {
+          std::size_t hits = 0;
+          const auto t0 = std::chrono::steady_clock::now();
+          for (std::size_t i = 0; i != lookups; ++i)
+            hits += f(probes[i & mask]);
+          const auto t1 = std::chrono::steady_clock::now();
+          do_not_optimize(hits);
+          const double ns
+            = std::chrono::duration<double, std::nano>(t1 - t0).count();
+          if (run == 0 || ns < best)
+            best = ns;
+        }
+      return best / double(lookups);
+    }
+
+  const char* const g_names[] = { "scalar", "sse2", "simd", "chained", "flat" };
+  constexpr std::size_t g_methods = sizeof(g_names) / sizeof(g_names[0]);
+
+  template<typename T>
+    void
+    sweep(std::size_t max_n)
+    {
+      constexpr std::size_t width = sizeof(T);
+      // distinct keys, the misses drawn from the same range
+      const std::size_t range = width == 1 ? 256 : 1 << 16;
+      max_n = std::min(max_n, range / 2);
+      std::vector<T> pool(range);
+      for (std::size_t i = 0; i != range; ++i)
+        pool[i] = T(i * (width == 1 ? 1 : 40503u));
+      std::shuffle(pool.begin(), pool.end(), std::mt19937_64(width));
+
+      std::size_t crossover[g_methods] = { };
+      for (std::size_t n = 1; n <= max_n; n += n < 16 ? 1 : n < 64 ? 4 : 8)
+        {
+          const std::vector<T> keys(pool.begin(), pool.begin() + n);
+          std::vector<T> probes;
+          for (std::size_t i = 0; i != 256; ++i)
+            probes.push_back(i % 2 ? keys[i / 2 % n] : pool[n + i / 2 % n]);
+
+          stl::hashed_stack<T, std::hash<T>, opaque_equal> chained;
+          stl::hashed_stack<T, std::hash<T>, opaque_equal, std::allocator<T>
+                          , stl::__detail::_Flat_index_policy> flat;
+          for (const T& k : keys)
+            {
+              chained.push(k);
+              flat.push(k);
+            }
+
+          double ns[g_methods];
+          ns[0] = measure(probes, [&](const T& k)
+            { return std::find(keys.begin(), keys.end(), k) != keys.end(); });
+#if defined(__SSE2__)
+          ns[1] = measure(probes, [&](const T& k)
+            {
+              using word = stl::__detail::__scan_word<width>;
+              word w;
+              std::memcpy(&w, &k, width);
+              return stl::__detail::__scan_sse2<width>(
+                reinterpret_cast<const unsigned char*>(keys.data()), n, w) != n;
+            });
+#else
+          ns[1] = ns[0];
+#endif
+          ns[2] = measure(probes, [&](const T& k)
+            { return stl::__detail::__simd_find(keys.data(), n, k) != n; });
+          ns[3] = measure(probes, [&](const T& k)
+            { return chained.contains(k); });
+          ns[4] = measure(probes, [&](const T& k)
+            { return flat.contains(k); });
+
+          // the last size at which each scan still beats both indices
+          const double index_ns = std::min(ns[3], ns[4]);
+          for (std::size_t m = 0; m != 3; ++m)
+            if (ns[m] <= index_ns)
+              crossover[m] = n;
+
+          for (std::size_t m = 0; m != g_methods; ++m)
+            if (g_csv)
+              std::printf("%zu,%zu,%s,%.2f\n", width, n, g_names[m], ns[m]);
+          if (!g_csv)
+            std::printf("%5zu %5zu %9.2f %9.2f %9.2f %9.2f %9.2f\n", width, n
+                      , ns[0], ns[1], ns[2], ns[3], ns[4]);
+        }
+
+      if (!g_csv)
+        std::printf("crossover, %zu-byte keys: scalar %zu, sse2 %zu, simd %zu"
+                    " (__simd_scan_threshold: %zu)\n\n", width, crossover[0]
+                  , crossover[1], crossover[2]
+                  , stl::__detail::__simd_scan_threshold(width));
+    }
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::size_t max_n = 128;
+  for (int i = 1; i < argc; ++i)
+    {
+      if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+        max_n = std::strtoul(argv[++i], nullptr, 10);
+      else if (std::strcmp(argv[i], "--csv") == 0)
+        g_csv = true;
+      else
+        {
+          std::fprintf(stderr, "usage: %s [--max N] [--csv]\n", argv[0]);
+          return 1;
+        }
+    }
+
+  if (g_csv)
+    std::printf("width,n,method,ns_per_lookup\n");
+  else
+    std::printf("%5s %5s %9s %9s %9s %9s %9s\n", "width", "n", "scalar"
+              , "sse2", "simd", "chained", "flat");
+  sweep<std::uint8_t>(max_n);
+  sweep<std::uint16_t>(max_n);
+  sweep<std::uint32_t>(max_n);
+  sweep<std::uint64_t>(max_n);
+}
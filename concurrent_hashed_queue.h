@@ -0,0 +1,472 @@
+// concurrent_hashed_queue.h header -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file concurrent_hashed_queue.h
+ *  This is a Standard C++ Library style header.
+ */
+
+#ifndef CONCURRENT_HASHED_QUEUE_H
+#define CONCURRENT_HASHED_QUEUE_H 1
+
+#pragma GCC system_header
+
+#include <algorithm>         // for std::min, std::max
+#include <atomic>
+#include <cstdint>           // for std::uint64_t, std::uintptr_t
+#include <limits>
+#include <memory>            // for std::unique_ptr
+#include <mutex>
+#include <thread>            // for std::thread::hardware_concurrency
+#include "hashed_queue.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+  /**
+   *  @brief A thread safe FIFO container of unique elements.
+   *
+   *  The key space is split across a power of two count of shards by the
+   *  high bits of the mixed hash code. Each shard is a hashed_queue behind
+   *  its own mutex, on its own cache line, so threads pushing or looking
+   *  up different keys seldom contend.
+   *
+   *  Equivalent elements always land on the same shard, uniqueness is then
+   *  exact. The FIFO order is strict within a shard. Across shards, each
+   *  push is stamped from a logical clock of the calling thread, which
+   *  goes past the last stamp of every shard the thread pushes to or pops
+   *  from: the clocks of threads spreading their elements over the shards
+   *  keep close to each other. Each shard publishes the stamp of its
+   *  front, and try_pop() pops the older front of two shards drawn at
+   *  random by the calling thread. The consumers spread over the shards,
+   *  and across shards an element comes out, on average, within a few
+   *  times the count of shards pops of its turn.
+   *
+   *  size() and empty() lock the shards one after the other, their result
+   *  may be stale by the time it is returned.
+   *
+   *  @tparam _Value  Type of the elements.
+   *  @tparam _Hash  Hashing function object type, defaults to
+   *                 hash<_Value>.
+   *  @tparam _Pred  Predicate function object type, defaults
+   *                 to equal_to<_Value>.
+   *  @tparam _Alloc  Allocator type, defaults to allocator<_Value>.
+   *  @tparam _IndexPolicy  Lookup structure of each shard, node based by
+   *                        default, see __detail::_Flat_index_policy.
+   */
+  template<typename _Value
+          ,typename _Hash = std::hash<_Value>
+          ,typename _Pred = std::equal_to<_Value>
+          ,typename _Alloc = std::allocator<_Value>
+          ,typename _IndexPolicy = __detail::_Chained_index_policy>
+    class concurrent_hashed_queue
+    {
+      // An element and the stamp of its push, hashed and compared by the
+      // element alone. Lookups take the bare element.
+      struct _Stamped
+      {
+        _Value        _M_v;
+        std::uint64_t _M_seq;
+      };
+
+      struct _Stamped_hash
+      {
+        using is_transparent = void;
+
+        _Hash _M_hash;
+
+        std::size_t
+        operator()(const _Stamped& __x) const
+        { return _M_hash(__x._M_v); }
+
+        std::size_t
+        operator()(const _Value& __x) const
+        { return _M_hash(__x); }
+      };
+
+      struct _Stamped_equal
+      {
+        using is_transparent = void;
+
+        _Pred _M_eq;
+
+        bool
+        operator()(const _Stamped& __x, const _Stamped& __y) const
+        { return _M_eq(__x._M_v, __y._M_v); }
+
+        bool
+        operator()(const _Stamped& __x, const _Value& __y) const
+        { return _M_eq(__x._M_v, __y); }
+
+        bool
+        operator()(const _Value& __x, const _Stamped& __y) const
+        { return _M_eq(__x, __y._M_v); }
+      };
+
+      using _Queue = hashed_queue<_Stamped, _Stamped_hash, _Stamped_equal
+                                , std::__alloc_rebind<_Alloc, _Stamped>
+                                , _IndexPolicy>;
+
+      static constexpr std::size_t _S_cache_line = 64;
+
+      // shards whose front try_pop() compares
+      static constexpr unsigned _S_sample = 2;
+
+      // stamp of the front of an empty shard, newer than any
+      static constexpr std::uint64_t _S_no_front
+        = std::numeric_limits<std::uint64_t>::max();
+
+      struct alignas(_S_cache_line) _Shard
+      {
+        mutable std::mutex         _M_mutex;
+        _Queue                     _M_queue;
+        // stamp of the front element, written under _M_mutex, read
+        // without it by try_pop() as a hint
+        std::atomic<std::uint64_t> _M_front{_S_no_front};
+        // last stamp taken, under _M_mutex
+        std::uint64_t              _M_back = 0;
+
+        // Publishes the front after a change, under _M_mutex.
+        void
+        _M_update_front() noexcept
+        {
+          _M_front.store(_M_queue.empty() ? _S_no_front
+                                          : _M_queue.front()._M_seq
+                       , std::memory_order_relaxed);
+        }
+      };
+
+    public:
+      using key_type = _Value;
+      using value_type = _Value;
+      using hasher = _Hash;
+      using key_equal = _Pred;
+      using allocator_type = _Alloc;
+      using size_type = typename _Queue::size_type;
+
+      // the shard is picked with at most this many high bits
+      static constexpr unsigned _S_max_shard_bits = 16;
+
+    private:
+      static constexpr unsigned _S_shard_shift
+        = sizeof(std::size_t) * __CHAR_BIT__ - _S_max_shard_bits;
+
+      std::unique_ptr<_Shard[]> _M_shards;
+      size_type                 _M_shard_mask;
+      _Hash                     _M_hash;
+
+    public:
+      /**
+       * @brief Builds an empty queue.
+       * @param __shards  Count of shards, rounded up to a power of two and
+       *                  capped at 2^_S_max_shard_bits. Zero picks four
+       *                  times the hardware concurrency.
+       */
+      explicit
+      concurrent_hashed_queue(size_type __shards = 0
+                            , const hasher& __hf = hasher()
+                            , const key_equal& __eql = key_equal())
+      : _M_hash(__hf)
+      {
+        if (__shards == 0)
+          __shards = 4 * std::max(1u, std::thread::hardware_concurrency());
+        __shards = std::min(__shards, size_type(1) << _S_max_shard_bits);
+        size_type __n = 1;
+        while (__n < __shards)
+          __n <<= 1;
+
+        _M_shards.reset(new _Shard[__n]);
+        _M_shard_mask = __n - 1;
+        for (size_type __i = 0; __i != __n; ++__i)
+          _M_shards[__i]._M_queue
+            = _Queue(0, _Stamped_hash{__hf}, _Stamped_equal{__eql});
+      }
+
+      concurrent_hashed_queue(const concurrent_hashed_queue&) = delete;
+      concurrent_hashed_queue&
+      operator=(const concurrent_hashed_queue&) = delete;
+
+      size_type
+      shard_count() const noexcept
+      { return _M_shard_mask + 1; }
+
+      // capacity
+      [[__nodiscard__]] bool
+      empty() const
+      {
+        for (size_type __i = 0; __i <= _M_shard_mask; ++__i)
+          {
+            std::lock_guard<std::mutex> __lock(_M_shards[__i]._M_mutex);
+            if (!_M_shards[__i]._M_queue.empty())
+              return false;
+          }
+        return true;
+      }
+
+      size_type
+      size() const
+      {
+        size_type __n = 0;
+        for (size_type __i = 0; __i <= _M_shard_mask; ++__i)
+          {
+            std::lock_guard<std::mutex> __lock(_M_shards[__i]._M_mutex);
+            __n += _M_shards[__i]._M_queue.size();
+          }
+        return __n;
+      }
+
+      // modifiers
+
+      /**
+       * @brief push
+       *    Queues @a __x on its shard, unless an equivalent element is
+       *    already queued.
+       * @return whether the insertion took place.
+       */
+      bool
+      push(const value_type& __x)
+      { return _M_push(value_type(__x)); }
+
+      bool
+      push(value_type&& __x)
+      { return _M_push(std::move(__x)); }
+
+      // The element is built outside of any lock, its shard depends on it.
+      template<typename... _Args>
+        bool
+        emplace(_Args&&... __args)
+        { return push(value_type(std::forward<_Args>(__args)...)); }
+
+      /**
+       * @brief try_pop
+       *    Pops the older front of two shards drawn at random, as read from
+       *    the stamps the shards publish. When both are empty, pops the
+       *    front of the next shard found holding elements. A shard emptied
+       *    by another thread in the meantime sends it back to the draw.
+       * @return the element, or an empty optional if all the shards were
+       *    seen empty.
+       */
+      std::optional<value_type>
+      try_pop()
+      {
+        for (;;)
+          {
+            const std::uint64_t __r = _S_random();
+            _Shard* __s = _M_older_front(__r);
+            if (!__s)
+              __s = _M_next_front(__r);
+            if (!__s)
+              return std::nullopt;
+
+            std::lock_guard<std::mutex> __lock(__s->_M_mutex);
+            if (__s->_M_queue.empty())
+              continue;
+            // Moved out, unindexed by its hash code: no lookup.
+            std::optional<_Stamped> __x;
+            __s->_M_queue.pop_n(1, &__x);
+            __s->_M_update_front();
+            _Local& __l = _S_local();
+            __l._M_clock = std::max(__l._M_clock, __x->_M_seq);
+            return std::optional<value_type>(std::move(__x->_M_v));
+          }
+      }
+
+      std::optional<value_type>
+      extract(const key_type& __x)
+      {
+        _Shard& __s = _M_shard_for(__x);
+        std::lock_guard<std::mutex> __lock(__s._M_mutex);
+        std::optional<_Stamped> __e = __s._M_queue.extract(__x);
+        if (!__e)
+          return std::nullopt;
+        __s._M_update_front();
+        return std::optional<value_type>(std::move(__e->_M_v));
+      }
+
+      size_type
+      erase(const key_type& __x)
+      {
+        _Shard& __s = _M_shard_for(__x);
+        std::lock_guard<std::mutex> __lock(__s._M_mutex);
+        const size_type __n = __s._M_queue.erase(__x);
+        __s._M_update_front();
+        return __n;
+      }
+
+      void
+      clear()
+      {
+        for (size_type __i = 0; __i <= _M_shard_mask; ++__i)
+          {
+            std::lock_guard<std::mutex> __lock(_M_shards[__i]._M_mutex);
+            _M_shards[__i]._M_queue.clear();
+            _M_shards[__i]._M_update_front();
+          }
+      }
+
+      // lookup
+      bool
+      contains(const key_type& __x) const
+      {
+        const _Shard& __s = _M_shard_for(__x);
+        std::lock_guard<std::mutex> __lock(__s._M_mutex);
+        return __s._M_queue.contains(__x);
+      }
+
+      size_type
+      count(const key_type& __x) const
+      { return contains(__x) ? 1 : 0; }
+
+      // Reserves room for @a __n elements spread evenly over the shards.
+      void
+      reserve(size_type __n)
+      {
+        const size_type __per_shard = __n / shard_count() + 1;
+        for (size_type __i = 0; __i <= _M_shard_mask; ++__i)
+          {
+            std::lock_guard<std::mutex> __lock(_M_shards[__i]._M_mutex);
+            _M_shards[__i]._M_queue.reserve(__per_shard);
+          }
+      }
+
+      void
+      shrink_to_fit()
+      {
+        for (size_type __i = 0; __i <= _M_shard_mask; ++__i)
+          {
+            std::lock_guard<std::mutex> __lock(_M_shards[__i]._M_mutex);
+            _M_shards[__i]._M_queue.shrink_to_fit();
+          }
+      }
+
+      // observers
+      hasher
+      hash_function() const
+      { return _M_hash; }
+
+    private:
+      // The stamp is taken under the shard's lock, past its last one: the
+      // stamps of a shard grow from its front to its back. No state is
+      // shared between the pushes to different shards.
+      bool
+      _M_push(value_type&& __x)
+      {
+        _Shard& __s = _M_shard_for(__x);
+        _Local& __l = _S_local();
+        std::lock_guard<std::mutex> __lock(__s._M_mutex);
+        const std::uint64_t __seq = std::max(__l._M_clock, __s._M_back) + 1;
+        if (!__s._M_queue.push(_Stamped{ std::move(__x), __seq }).second)
+          return false;
+        __s._M_back = __l._M_clock = __seq;
+        if (__s._M_queue.size() == 1)
+          __s._M_update_front();
+        return true;
+      }
+
+      // State of the calling thread: its logical clock, and an xorshift64
+      // seeded from the address of the state, so that the threads draw
+      // different shards.
+      struct _Local
+      {
+        std::uint64_t _M_clock = 0;
+        std::uint64_t _M_rand = 0;
+      };
+
+      static _Local&
+      _S_local() noexcept
+      {
+        static thread_local _Local __l;
+        return __l;
+      }
+
+      static std::uint64_t
+      _S_random() noexcept
+      {
+        std::uint64_t& __x = _S_local()._M_rand;
+        if (__x == 0)
+          __x = __detail::__hash_mix(reinterpret_cast<std::uintptr_t>(&__x))
+                | 1;
+        __x ^= __x << 13;
+        __x ^= __x >> 7;
+        __x ^= __x << 17;
+        return __x;
+      }
+
+      // Of _S_sample shards drawn from the bits of @a __r, the one with the
+      // oldest front, or null if they were all seen empty.
+      _Shard*
+      _M_older_front(std::uint64_t __r) const noexcept
+      {
+        _Shard* __oldest = nullptr;
+        std::uint64_t __seq = _S_no_front;
+        for (unsigned __i = 0; __i != _S_sample; ++__i)
+          {
+            _Shard& __s = _M_shards[(__r >> (__i * 32)) & _M_shard_mask];
+            const std::uint64_t __f
+              = __s._M_front.load(std::memory_order_relaxed);
+            if (__f < __seq)
+              {
+                __seq = __f;
+                __oldest = &__s;
+              }
+          }
+        return __oldest;
+      }
+
+      // The first shard seen holding elements, from one drawn from the
+      // bits of @a __r, or null if they were all seen empty.
+      _Shard*
+      _M_next_front(std::uint64_t __r) const noexcept
+      {
+        for (size_type __i = 0; __i <= _M_shard_mask; ++__i)
+          {
+            _Shard& __s = _M_shards[(__r + __i) & _M_shard_mask];
+            if (__s._M_front.load(std::memory_order_relaxed) != _S_no_front)
+              return &__s;
+          }
+        return nullptr;
+      }
+
+      // The shard hashes the key again, with its low bits; the high bits
+      // picking the shard keep the shards' indices evenly loaded.
+      size_type
+      _M_shard_index(const key_type& __x) const
+      {
+        return (__detail::__hash_mix(_M_hash(__x)) >> _S_shard_shift)
+               & _M_shard_mask;
+      }
+
+      _Shard&
+      _M_shard_for(const key_type& __x)
+      { return _M_shards[_M_shard_index(__x)]; }
+
+      const _Shard&
+      _M_shard_for(const key_type& __x) const
+      { return _M_shards[_M_shard_index(__x)]; }
+    };
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // CONCURRENT_HASHED_QUEUE_H
@@ -0,0 +1,1752 @@
+// _ContainerHasher implementation -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file bits/container_hasher.h
+ *  This is an internal header file, included by other library headers.
+ *  Do not attempt to use it directly.
+ *  @headername{hashed_stack, hashed_queue}
+ */
+
+#ifndef CONTAINER_HASHER_H
+#define CONTAINER_HASHER_H 1
+
+#pragma GCC system_header
+
+#include <optional>          // for std::optional
+#include <initializer_list>
+#include <tuple>             // for std::forward_as_tuple
+#include <vector>            // for std::vector<bool>
+#include "hasher.h"
+#include "revolver.h"
+#include "simd_scan.h"
+#include "parallel_tasks.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+  /**
+   *  @brief The _ContainerHasher class
+   *
+   *  Adapts a sequence container (the 'inner container') into a container
+   *  of unique elements with constant time lookup, while keeping the
+   *  elements in the order they were pushed.
+   *
+   *  The elements live in the inner container only.  The index, selected
+   *  by @a _IndexPolicy, maps the hash code of a key to the index of its
+   *  element in the inner container (see _Sequence_traits).
+   *
+   *  Extracting an element from the middle of the sequence does not
+   *  disturb the others: its slot stays in the inner container as a hole
+   *  until it reaches the front or the back.  A slot is a hole when the
+   *  index does not point back to it, so holes cost a lookup on iteration
+   *  and pops, and nothing at all while there are none.
+   *
+   *  Once the holes make a third of the slots, extract(), erase() and
+   *  move_to_back() each carry out a bounded step of an incremental
+   *  compaction, sliding the live elements towards the front in order.
+   *  These operations therefore invalidate the iterators.
+   *
+   *  A small table is not indexed at all: up to _S_small_size elements,
+   *  the larger of the threshold of _Hashtable_hash_traits for @a _Hash
+   *  and the inline slots of the inner container, the lookups scan the
+   *  elements without hashing, and a removal from the middle closes the
+   *  gap instead of leaving a hole.  The index is built when the table
+   *  outgrows that size, and dropped again by clear(), or by
+   *  shrink_to_fit() once the table is small enough.  With inline slots
+   *  a small table thus never allocates.
+   *
+   *  An inner container may keep a mapped value beside each element, in
+   *  a column of its own at the same index, see mapped_revolver: the
+   *  lookups then touch the elements, the keys, only, and every move of
+   *  an element between slots, by move_to_back() or the compaction,
+   *  moves its mapped value along.  extract() and the pops then yield
+   *  pairs of an element and its mapped value.
+   *
+   *  With __detail::_Recording_index_policy the container records
+   *  statistics of its index and storage, see stats().  The lookups then
+   *  write to the container, which is no longer safe to read from
+   *  concurrent threads.  With any other policy nothing is recorded, and
+   *  the recorder is an empty base.
+   *
+   *  @tparam _Tp  Type of the elements.
+   *  @tparam _Alloc  Allocator type.
+   *  @tparam _Key  Type of the keys, the first element of a pair or tuple
+   *                _Tp, or _Tp itself.
+   *  @tparam _Container  The inner container, random access.
+   *  @tparam _Hash  Hash function object type.
+   *  @tparam _Equal  Key equality function object type.
+   *  @tparam _IndexPolicy  __detail::_Chained_index_policy,
+   *                        __detail::_Incremental_chained_index_policy or
+   *                        __detail::_Flat_index_policy, possibly wrapped
+   *                        in __detail::_Recording_index_policy.
+   */
+  template<typename _Tp, typename _Alloc, typename _Key, typename _Container
+          ,typename _Hash, typename _Equal, typename _IndexPolicy>
+    class _ContainerHasher
+    : private __detail::_Hash_stats_recorder<
+        __detail::__records_stats<_IndexPolicy>::value>
+    {
+      using __seq_traits = __detail::_Sequence_traits<_Container>;
+      using __iterator_tag = typename std::iterator_traits<
+                               typename _Container::iterator>::iterator_category;
+
+      static_assert(std::is_same<__iterator_tag
+                                , std::random_access_iterator_tag>::value
+                    , "_ContainerHasher needs a random access container");
+      static_assert(std::is_same<typename _Container::value_type, _Tp>::value
+                    , "_Container value_type must match the element type");
+
+      using __index_table =
+        typename _IndexPolicy::template __index_table<__iterator_tag, _Alloc
+                                                     , _Key, _Hash>;
+      using __index_type = typename __seq_traits::__index_type;
+      using __alloc_traits = std::allocator_traits<_Alloc>;
+
+      static constexpr bool _S_records_stats
+        = __detail::__records_stats<_IndexPolicy>::value;
+
+      // Keys hashed and prefetched ahead by the batched operations.
+      static constexpr std::size_t _S_batch = 16;
+
+      // Elements, or slots, a thread takes at least in a parallel pass.
+      static constexpr std::size_t _S_parallel_grain = 1 << 14;
+
+      // Slots examined by each step of the incremental compaction.
+      static constexpr std::size_t _S_compact_step = 8;
+
+      // Whether the scan of a small table compares the keys a vector at
+      // a time, see __detail::__simd_find.
+      static constexpr bool _S_simd_scan
+        = std::is_same<_Key, _Tp>::value
+        && __detail::__simd_scannable<_Key, _Equal>::value;
+
+      // Whether the inner container keeps a mapped value beside each
+      // element, see __detail::__mapped_column.
+      static constexpr bool _S_mapped
+        = __detail::__mapped_column<_Container>::value;
+      using __taken_type
+        = typename __detail::__mapped_column<_Container>::__taken_type;
+
+      // Whether the elements, with their mapped values, slide down in
+      // place, rather than being moved to a new inner container.
+      static constexpr bool _S_assignable
+        = std::is_move_assignable<_Tp>::value
+        && (!_S_mapped
+            || std::is_move_assignable<typename __detail::__mapped_column<
+                 _Container>::__mapped_type>::value);
+
+      // Elements looked up by a linear scan before the index is built.
+      // Closing a gap moves the elements, which must be assignable.  An
+      // embedded index costs nothing more to fill, the inline slots of
+      // the inner container are not a reason to leave it empty then.
+      static constexpr std::size_t _S_small_size
+        = _S_assignable
+        ? std::max({
+            __detail::_Hashtable_hash_traits<_Hash>::__small_size_threshold()
+          , __detail::__fixed_index<_IndexPolicy>::value
+              ? std::size_t(0) : __seq_traits::__inline_capacity
+          , _S_simd_scan ? __detail::__simd_scan_threshold(sizeof(_Key))
+                         : std::size_t(0) })
+        : 0;
+
+      // Progress of the incremental compaction, see _M_compact_step().
+      struct _Compaction
+      {
+        __index_type _M_src = 0;    // next slot examined
+        __index_type _M_dst = 0;    // next slot a live element moves to
+        bool         _M_active = false;
+      };
+
+    public:
+      using key_type = _Key;
+      using value_type = _Tp;
+      using container_type = _Container;
+      using allocator_type = _Alloc;
+      using hasher = _Hash;
+      using key_equal = _Equal;
+      using size_type = std::size_t;
+      using difference_type = std::ptrdiff_t;
+      using reference = value_type&;
+      using const_reference = const value_type&;
+
+      class const_iterator;
+      // Elements are not modifiable in place, it would break the index.
+      using iterator = const_iterator;
+
+    private:
+      _Container    _M_cont;
+      __index_table _M_index;
+      _Hash         _M_hash;
+      _Equal        _M_eq;
+      size_type     _M_holes = 0;
+      _Compaction   _M_pack;
+
+    public:
+      _ContainerHasher() = default;
+
+      // The inner container and the index allocate from copies of the
+      // same allocator.
+      explicit
+      _ContainerHasher(const allocator_type& __a)
+      : _M_cont(__a), _M_index(__a)
+      { }
+
+      explicit
+      _ContainerHasher(size_type __bkt_count_hint
+                     , const _Hash& __hf = _Hash()
+                     , const _Equal& __eql = _Equal()
+                     , const allocator_type& __a = allocator_type())
+      : _M_cont(__a), _M_index(__a), _M_hash(__hf), _M_eq(__eql)
+      { reserve(__bkt_count_hint); }
+
+      template<typename _InputIterator>
+        _ContainerHasher(_InputIterator __first, _InputIterator __last
+                       , size_type __bkt_count_hint = 0
+                       , const _Hash& __hf = _Hash()
+                       , const _Equal& __eql = _Equal()
+                       , const allocator_type& __a = allocator_type())
+        : _ContainerHasher(__bkt_count_hint, __hf, __eql, __a)
+        {
+          for (; __first != __last; ++__first)
+            push_back(*__first);
+        }
+
+      /**
+       *  With the execution policy std::execution::par or par_unseq, and
+       *  random access iterators, the elements are hashed and their
+       *  duplicates dropped on all the cores, see _M_parallel_fill().
+       *  As with push_back(), the first of equivalent elements is kept,
+       *  and the order of the others is that of [__first, __last).  The
+       *  hash function and the key equality are then called from several
+       *  threads at once.
+       */
+      template<typename _ExecutionPolicy, typename _ForwardIterator
+              ,typename = std::enable_if_t<
+                 __detail::__is_execution_policy<_ExecutionPolicy>::value>>
+        _ContainerHasher(_ExecutionPolicy&&
+                       , _ForwardIterator __first, _ForwardIterator __last
+                       , size_type __bkt_count_hint = 0
+                       , const _Hash& __hf = _Hash()
+                       , const _Equal& __eql = _Equal()
+                       , const allocator_type& __a = allocator_type())
+        : _ContainerHasher(__bkt_count_hint, __hf, __eql, __a)
+        {
+          using _Cat = typename std::iterator_traits<_ForwardIterator>
+                                  ::iterator_category;
+          if constexpr (__detail::__allows_parallel<_ExecutionPolicy>::value
+                        && std::is_base_of<std::random_access_iterator_tag
+                                         , _Cat>::value)
+            _M_parallel_fill(__first, __last);
+          else
+            push_range(__first, __last);
+        }
+
+      _ContainerHasher(std::initializer_list<value_type> __l
+                     , size_type __bkt_count_hint = 0
+                     , const _Hash& __hf = _Hash()
+                     , const _Equal& __eql = _Equal()
+                     , const allocator_type& __a = allocator_type())
+      : _ContainerHasher(__l.begin(), __l.end(), __bkt_count_hint, __hf, __eql
+                       , __a)
+      { }
+
+      // The index may hash the copied elements again, see _Chained_index.
+      _ContainerHasher(const _ContainerHasher& __x)
+      : _M_cont(__x._M_cont)
+      , _M_index(__x._M_index, __x._M_rehasher())
+      , _M_hash(__x._M_hash)
+      , _M_eq(__x._M_eq)
+      , _M_holes(__x._M_holes)
+      , _M_pack(__x._M_pack)
+      { }
+
+      _ContainerHasher(const _ContainerHasher& __x, const allocator_type& __a)
+      : _M_cont(__x._M_cont, __a)
+      , _M_index(__x._M_index, __x._M_rehasher(), __a)
+      , _M_hash(__x._M_hash)
+      , _M_eq(__x._M_eq)
+      , _M_holes(__x._M_holes)
+      , _M_pack(__x._M_pack)
+      { }
+
+      // Throws only if the inner container moves its elements one by one,
+      // see revolver.
+      _ContainerHasher(_ContainerHasher&& __x)
+      noexcept(std::is_nothrow_move_constructible<_Container>::value)
+      : _M_cont(std::move(__x._M_cont))
+      , _M_index(std::move(__x._M_index))
+      , _M_hash(std::move(__x._M_hash))
+      , _M_eq(std::move(__x._M_eq))
+      , _M_holes(std::__exchange(__x._M_holes, 0))
+      , _M_pack(std::__exchange(__x._M_pack, _Compaction()))
+      { }
+
+      // With an unequal allocator the elements are moved one by one, at
+      // the same indices, and the index is copied.
+      _ContainerHasher(_ContainerHasher&& __x, const allocator_type& __a)
+      : _M_cont(std::move(__x._M_cont), __a)
+      , _M_index(__a)
+      , _M_hash(__x._M_hash)
+      , _M_eq(__x._M_eq)
+      , _M_holes(__x._M_holes)
+      , _M_pack(__x._M_pack)
+      {
+        if (_M_index.get_allocator() == __x._M_index.get_allocator())
+          _M_index.swap(__x._M_index);
+        else
+          {
+            _M_index = __index_table(__x._M_index, _M_rehasher(), __a);
+            __x.clear();
+          }
+        __x._M_holes = 0;
+        __x._M_pack = _Compaction();
+      }
+
+      _ContainerHasher&
+      operator=(const _ContainerHasher& __x)
+      {
+        _M_cont = __x._M_cont;
+        _M_index._M_copy_assign(__x._M_index, __x._M_rehasher());
+        _M_hash = __x._M_hash;
+        _M_eq = __x._M_eq;
+        _M_holes = __x._M_holes;
+        _M_pack = __x._M_pack;
+        return *this;
+      }
+
+      _ContainerHasher&
+      operator=(_ContainerHasher&& __x)
+      noexcept((__alloc_traits::propagate_on_container_move_assignment::value
+                || __alloc_traits::is_always_equal::value)
+               && std::is_nothrow_move_constructible<_Container>::value
+               && std::__is_nothrow_swappable<_Container>::value)
+      {
+        if constexpr (__alloc_traits::propagate_on_container_move_assignment
+                        ::value)
+          {
+            _ContainerHasher __tmp(std::move(__x));
+            swap(__tmp);
+          }
+        else
+          {
+            // Keeps this allocator, which swap() then finds on both sides.
+            _ContainerHasher __tmp(std::move(__x), get_allocator());
+            swap(__tmp);
+          }
+        return *this;
+      }
+
+      // iterators, in sequence order
+      const_iterator
+      begin() const
+      { return const_iterator(this, _M_next_live(_M_front_index())); }
+
+      const_iterator
+      end() const noexcept
+      { return const_iterator(this, _M_end_index()); }
+
+      const_iterator
+      cbegin() const
+      { return begin(); }
+
+      const_iterator
+      cend() const noexcept
+      { return end(); }
+
+      // capacity
+      bool
+      empty() const noexcept
+      { return size() == 0; }
+
+      size_type
+      size() const noexcept
+      { return _M_scanning() ? _M_cont.size() : _M_index.size(); }
+
+      // element access
+      const_reference
+      front() const
+      { return *begin(); }
+
+      const_reference
+      back() const noexcept
+      { return _M_at(_M_end_index() - 1); }
+
+      // The mapped value of the element at @a __it, with an inner
+      // container keeping one beside each element.  Unlike the element,
+      // it can be modified in place.
+      template<typename _Cont = _Container>
+        typename _Cont::mapped_type&
+        mapped(const_iterator __it) noexcept
+        { return _M_cont.mapped_at_index(__it._M_idx); }
+
+      template<typename _Cont = _Container>
+        const typename _Cont::mapped_type&
+        mapped(const_iterator __it) const noexcept
+        { return _M_cont.mapped_at_index(__it._M_idx); }
+
+      // The mapped value of back().
+      template<typename _Cont = _Container>
+        typename _Cont::mapped_type&
+        mapped_back() noexcept
+        { return _M_cont.mapped_at_index(_M_end_index() - 1); }
+
+      template<typename _Cont = _Container>
+        const typename _Cont::mapped_type&
+        mapped_back() const noexcept
+        { return _M_cont.mapped_at_index(_M_end_index() - 1); }
+
+      // The column of the mapped values, in sequence order, with an inner
+      // container keeping them apart from the elements.  The holes are
+      // dropped first, invalidating the iterators if there were any: a
+      // scan of the column reads the mapped values alone, hashing no key.
+      template<typename _Cont = _Container>
+        const typename _Cont::mapped_column&
+        mapped_values()
+        {
+          if (_M_holes)
+            _M_compact();
+          return _M_cont.values();
+        }
+
+      // modifiers
+
+      /**
+       * @brief push_back
+       *    Appends @a __v at the end of the sequence, unless an equivalent
+       *    element is already in the container.
+       * @return an iterator to the element with the key of @a __v, and
+       *    whether the insertion took place.
+       */
+      std::pair<iterator, bool>
+      push_back(const value_type& __v)
+      { return _M_push_back(__v); }
+
+      std::pair<iterator, bool>
+      push_back(value_type&& __v)
+      { return _M_push_back(std::move(__v)); }
+
+      // The element is constructed first, and popped again if its key was
+      // already in the container.
+      template<typename... _Args>
+        std::pair<iterator, bool>
+        emplace_back(_Args&&... __args)
+        {
+          const __index_type __idx = _M_end_index();
+          _M_cont.emplace_back(std::forward<_Args>(__args)...);
+          if (_M_scanning())
+            {
+              const __index_type __found
+                = _M_scan(_S_key(_M_at(__idx)), __idx);
+              if (__found != __idx)
+                {
+                  _M_cont.pop_back();
+                  return { const_iterator(this, __found), false };
+                }
+              if (_M_cont.size() > _S_small_size)
+                __try
+                  {
+                    _M_build_index();
+                  }
+                __catch(...)
+                  {
+                    _M_cont.pop_back();
+                    __throw_exception_again;
+                  }
+              return { const_iterator(this, __idx), true };
+            }
+          __try
+            {
+              const key_type& __k = _S_key(_M_at(__idx));
+              const std::size_t __code = _M_hash(__k);
+              if (__index_type* __p = _M_find_index(__k, __code))
+                {
+                  const __index_type __found = *__p;
+                  _M_cont.pop_back();
+                  return { const_iterator(this, __found), false };
+                }
+              _M_index_insert(__code, __idx);
+            }
+          __catch(...)
+            {
+              _M_cont.pop_back();
+              __throw_exception_again;
+            }
+          return { const_iterator(this, __idx), true };
+        }
+
+      /**
+       * @brief try_emplace_back
+       *    Appends the key @a __k with a mapped value constructed from
+       *    @a __args, unless @a __k is already in the container: nothing
+       *    is constructed then.  Only for an inner container keeping a
+       *    mapped value beside each element.
+       * @return an iterator to the element with key @a __k, and whether
+       *    the insertion took place.
+       */
+      template<typename... _Args>
+        std::pair<iterator, bool>
+        try_emplace_back(const key_type& __k, _Args&&... __args)
+        { return _M_try_emplace_back(__k, std::forward<_Args>(__args)...); }
+
+      template<typename... _Args>
+        std::pair<iterator, bool>
+        try_emplace_back(key_type&& __k, _Args&&... __args)
+        {
+          return _M_try_emplace_back(std::move(__k)
+                                   , std::forward<_Args>(__args)...);
+        }
+
+      /**
+       * @brief push_range
+       *    Appends the elements of [__first, __last) not already in the
+       *    container, in order. With forward iterators the keys are hashed
+       *    a block at a time, and the index prefetched for the whole block
+       *    before any of them is looked up.
+       * @return the number of elements inserted.
+       */
+      template<typename _InputIterator>
+        size_type
+        push_range(_InputIterator __first, _InputIterator __last)
+        {
+          using _Cat = typename std::iterator_traits<_InputIterator>
+                                  ::iterator_category;
+          size_type __n = 0;
+          if constexpr (std::is_base_of<std::forward_iterator_tag
+                                      , _Cat>::value)
+            {
+              reserve(size() + std::distance(__first, __last));
+              std::size_t __codes[_S_batch];
+              while (__first != __last)
+                {
+                  size_type __cnt = 0;
+                  for (_InputIterator __it = __first;
+                       __cnt != _S_batch && __it != __last; ++__it, ++__cnt)
+                    {
+                      __codes[__cnt] = _M_hash(_S_key(*__it));
+                      _M_index._M_prefetch(__codes[__cnt]);
+                    }
+                  for (size_type __i = 0; __i != __cnt; ++__i, ++__first)
+                    __n += _M_push_back_hashed(*__first, __codes[__i]).second;
+                }
+            }
+          else
+            for (; __first != __last; ++__first)
+              __n += _M_push_back(*__first).second;
+          return __n;
+        }
+
+      // Removes the first element of the sequence. Only for inner
+      // containers keeping their indices on a removal at the front.
+      void
+      pop_front()
+      {
+        static_assert(__seq_traits::__stable_front
+                      , "pop_front() would shift the indices of the other "
+                        "elements of the inner container");
+        if (!_M_scanning())
+          _M_erase_index(_M_front_index());
+        _M_cont.pop_front();
+        _M_trim_front();
+      }
+
+      // Removes the last element of the sequence.
+      void
+      pop_back()
+      {
+        if (!_M_scanning())
+          _M_erase_index(_M_end_index() - 1);
+        _M_cont.pop_back();
+        _M_trim_back();
+      }
+
+      /**
+       * @brief pop_front_n
+       *    Moves up to @a __n elements from the front of the sequence to
+       *    @a __out, oldest first, and removes them. The keys of a block
+       *    are hashed and their index entries prefetched up front.
+       * @return the output iterator past the last element written.
+       */
+      template<typename _OutputIterator>
+        _OutputIterator
+        pop_front_n(size_type __n, _OutputIterator __out)
+        {
+          static_assert(__seq_traits::__stable_front
+                        , "pop_front_n() would shift the indices of the other "
+                          "elements of the inner container");
+          return _M_pop_n<true>(__n, __out);
+        }
+
+      /// As pop_front_n(), from the back, newest first.
+      template<typename _OutputIterator>
+        _OutputIterator
+        pop_back_n(size_type __n, _OutputIterator __out)
+        { return _M_pop_n<false>(__n, __out); }
+
+      /**
+       * @brief extract
+       *    Takes the element with key @a __k out of the container, without
+       *    disturbing the sequencing of the other elements.
+       * @return the element, paired with its mapped value for an inner
+       *    container keeping one, or an empty optional if @a __k is not in
+       *    the container.
+       */
+      std::optional<__taken_type>
+      extract(const key_type& __k)
+      { return _M_extract_tr(__k); }
+
+      // Heterogeneous extract, for transparent hash and key equality types.
+      template<typename _Kt
+              ,typename = std::__has_is_transparent_t<_Hash, _Kt>
+              ,typename = std::__has_is_transparent_t<_Equal, _Kt>>
+        std::optional<__taken_type>
+        extract(const _Kt& __k)
+        { return _M_extract_tr(__k); }
+
+      size_type
+      erase(const key_type& __k)
+      { return _M_erase_tr(__k); }
+
+      // Heterogeneous erase, for transparent hash and key equality types.
+      template<typename _Kt
+              ,typename = std::__has_is_transparent_t<_Hash, _Kt>
+              ,typename = std::__has_is_transparent_t<_Equal, _Kt>>
+        size_type
+        erase(const _Kt& __k)
+        { return _M_erase_tr(__k); }
+
+      /**
+       * @brief move_to_back
+       *    Moves the element with key @a __k to the back of the sequence,
+       *    with a single lookup. Its old slot becomes a hole, or is closed
+       *    in a small table.
+       * @return an iterator to the moved element, or end() if @a __k is not
+       *    in the container.
+       */
+      const_iterator
+      move_to_back(const key_type& __k)
+      {
+        if (_M_scanning())
+          {
+            const __index_type __end = _M_end_index();
+            const __index_type __idx = _M_scan(__k, __end);
+            if (__idx == __end)
+              return end();
+            if constexpr (_S_small_size != 0)
+              if (__idx != __end - 1)
+                {
+                  __taken_type __tmp(_M_take(__idx));
+                  for (__index_type __i = __idx; __i != __end - 1; ++__i)
+                    _M_move_slot(__i, __i + 1);
+                  _M_put(__end - 1, std::move(__tmp));
+                }
+            return const_iterator(this, __end - 1);
+          }
+        _M_compact_step();
+        __index_type* __p = _M_find_index(__k, _M_hash(__k));
+        if (!__p)
+          return end();
+        const __index_type __idx = *__p;
+        const __index_type __new = _M_end_index();
+        if (__idx == __new - 1)
+          return const_iterator(this, __idx);
+
+        _M_push_moved(_M_cont, __idx);
+        if constexpr (_S_records_stats && __seq_traits::__relocates)
+          this->_M_record_capacity(_M_cont_capacity());
+        // Same key, same hash code: the entry is rewritten in place.
+        *__p = __new;
+        _M_remove_slot(__idx);
+        return const_iterator(this, __new);
+      }
+
+      void
+      clear() noexcept
+      {
+        _M_index._M_clear();
+        _M_cont.clear();
+        _M_holes = 0;
+        _M_pack = _Compaction();
+      }
+
+      allocator_type
+      get_allocator() const noexcept
+      { return allocator_type(_M_cont.get_allocator()); }
+
+      void
+      swap(_ContainerHasher& __x)
+      noexcept(std::__is_nothrow_swappable<_Container>::value)
+      {
+        using std::swap;
+        swap(_M_cont, __x._M_cont);
+        _M_index.swap(__x._M_index);
+        swap(_M_hash, __x._M_hash);
+        swap(_M_eq, __x._M_eq);
+        swap(_M_holes, __x._M_holes);
+        swap(_M_pack, __x._M_pack);
+      }
+
+      // lookup
+      const_iterator
+      find(const key_type& __k) const
+      { return _M_find_tr(__k); }
+
+      size_type
+      count(const key_type& __k) const
+      { return contains(__k) ? 1 : 0; }
+
+      bool
+      contains(const key_type& __k) const
+      { return find(__k) != end(); }
+
+      // Heterogeneous lookup, for transparent hash and key equality types:
+      // any type both can handle is looked up without building a key_type.
+      template<typename _Kt
+              ,typename = std::__has_is_transparent_t<_Hash, _Kt>
+              ,typename = std::__has_is_transparent_t<_Equal, _Kt>>
+        const_iterator
+        find(const _Kt& __k) const
+        { return _M_find_tr(__k); }
+
+      template<typename _Kt
+              ,typename = std::__has_is_transparent_t<_Hash, _Kt>
+              ,typename = std::__has_is_transparent_t<_Equal, _Kt>>
+        size_type
+        count(const _Kt& __k) const
+        { return contains(__k) ? 1 : 0; }
+
+      template<typename _Kt
+              ,typename = std::__has_is_transparent_t<_Hash, _Kt>
+              ,typename = std::__has_is_transparent_t<_Equal, _Kt>>
+        bool
+        contains(const _Kt& __k) const
+        { return find(__k) != end(); }
+
+      /**
+       * @brief contains_batch
+       *    Writes to @a __out, for each key of [__first, __last) in order,
+       *    whether it is in the container. The keys of a block are hashed
+       *    and their index entries prefetched before any is looked up,
+       *    unless the table is small enough to be scanned.
+       * @return the output iterator past the last result written.
+       */
+      template<typename _ForwardIterator, typename _OutputIterator>
+        _OutputIterator
+        contains_batch(_ForwardIterator __first, _ForwardIterator __last
+                     , _OutputIterator __out) const
+        {
+          if (_M_scanning())
+            {
+              const __index_type __end = _M_end_index();
+              for (; __first != __last; ++__first, ++__out)
+                *__out = _M_scan(*__first, __end) != __end;
+              return __out;
+            }
+          std::size_t __codes[_S_batch];
+          while (__first != __last)
+            {
+              size_type __cnt = 0;
+              for (_ForwardIterator __it = __first;
+                   __cnt != _S_batch && __it != __last; ++__it, ++__cnt)
+                {
+                  __codes[__cnt] = _M_hash(*__it);
+                  _M_index._M_prefetch(__codes[__cnt]);
+                }
+              for (size_type __i = 0; __i != __cnt; ++__i, ++__first, ++__out)
+                *__out = _M_find_index(*__first, __codes[__i]) != nullptr;
+            }
+          return __out;
+        }
+
+      // traversal
+      /**
+       * @brief chunk
+       *    Part @a __k of the sequence cut in @a __parts runs of about as
+       *    many slots: the chunks 0 to @a __parts - 1 cover the sequence
+       *    once, in order, and different threads may walk them at once.
+       *    The holes are skipped, so chunks may hold unequal counts of
+       *    elements.
+       */
+      std::pair<const_iterator, const_iterator>
+      chunk(size_type __k, size_type __parts) const
+      {
+        const auto __r
+          = __detail::__parallel_chunk(_M_cont.size(), __parts, __k);
+        const __index_type __front = _M_front_index();
+        return { const_iterator(this, _M_next_live(__front + __r.first))
+               , const_iterator(this, _M_next_live(__front + __r.second)) };
+      }
+
+      /**
+       * @brief for_each
+       *    Calls @a __f on each element.  With std::execution::par or
+       *    par_unseq the sequence is cut in chunks, walked by as many
+       *    threads, each in sequence order, and @a __f is called from
+       *    several threads at once.  In order otherwise.
+       */
+      template<typename _ExecutionPolicy, typename _Function>
+        std::enable_if_t<
+          __detail::__is_execution_policy<_ExecutionPolicy>::value>
+        for_each(_ExecutionPolicy&&, _Function __f) const
+        {
+          const unsigned __workers = _M_workers<_ExecutionPolicy>();
+          __detail::__parallel_run(__workers, [&](unsigned __t)
+            {
+              const auto __r = chunk(__t, __workers);
+              for (const_iterator __it = __r.first; __it != __r.second; ++__it)
+                __f(*__it);
+            });
+        }
+
+      /**
+       * @brief transform_reduce
+       *    @a __init combined by @a __reduce with @a __transform of each
+       *    element, in sequence order.  With std::execution::par or
+       *    par_unseq each chunk is reduced by a thread of its own, and the
+       *    results of the chunks combined in order afterwards: @a __reduce
+       *    must be associative, not necessarily commutative, and both
+       *    function objects are called from several threads at once.
+       */
+      template<typename _ExecutionPolicy, typename _Res
+              ,typename _BinaryOperation, typename _UnaryOperation>
+        std::enable_if_t<
+          __detail::__is_execution_policy<_ExecutionPolicy>::value, _Res>
+        transform_reduce(_ExecutionPolicy&&, _Res __init
+                       , _BinaryOperation __reduce
+                       , _UnaryOperation __transform) const
+        {
+          const unsigned __workers = _M_workers<_ExecutionPolicy>();
+          std::vector<std::optional<_Res>> __partial(__workers);
+          __detail::__parallel_run(__workers, [&](unsigned __t)
+            {
+              const auto __r = chunk(__t, __workers);
+              const_iterator __it = __r.first;
+              if (__it == __r.second)
+                return;
+              _Res __acc = __transform(*__it);
+              while (++__it != __r.second)
+                __acc = __reduce(std::move(__acc), __transform(*__it));
+              __partial[__t].emplace(std::move(__acc));
+            });
+          for (std::optional<_Res>& __p : __partial)
+            if (__p)
+              __init = __reduce(std::move(__init), std::move(*__p));
+          return __init;
+        }
+
+      // hash policy
+      size_type
+      bucket_count() const noexcept
+      { return _M_index.bucket_count(); }
+
+      float
+      load_factor() const noexcept
+      { return _M_index.load_factor(); }
+
+      float
+      max_load_factor() const noexcept
+      { return _M_index.max_load_factor(); }
+
+      void
+      reserve(size_type __n)
+      {
+        if constexpr (__detail::__has_reserve<_Container>::value)
+          _M_cont.reserve(__n);
+        if (__n > _S_small_size)
+          _M_index._M_reserve(__n, _M_rehasher());
+      }
+
+      /**
+       * @brief shrink_to_fit
+       *    Drops the holes, then gives the storage unused by the elements
+       *    back to the allocator: spare capacity of the inner container,
+       *    pooled index nodes and index slots.  The index of a table small
+       *    enough to be scanned goes altogether.
+       */
+      void
+      shrink_to_fit()
+      {
+        if (_M_holes)
+          _M_compact();
+        if (size() <= _S_small_size)
+          {
+            _M_index._M_clear();
+            _M_pack = _Compaction();
+          }
+        if constexpr (__detail::__has_shrink_to_fit<_Container>::value)
+          _M_cont.shrink_to_fit();
+        _M_index._M_shrink_to_fit(_M_rehasher());
+      }
+
+      /**
+       * @brief stats
+       *    Statistics recorded since the construction of the container,
+       *    with the index policy __detail::_Recording_index_policy only.
+       */
+      hashed_stats
+      stats() const noexcept
+      {
+        static_assert(_S_records_stats
+                      , "stats() needs the index policy "
+                        "__detail::_Recording_index_policy");
+        hashed_stats __s;
+        this->_M_snapshot(__s);
+        __s.load_factor = load_factor();
+        __s.element_bytes = _M_cont_capacity() * sizeof(value_type);
+        if constexpr (_S_mapped)
+          __s.element_bytes += _M_cont_capacity()
+                               * sizeof(typename _Container::mapped_type);
+        __s.index_bytes = _M_index._M_allocated_bytes();
+        return __s;
+      }
+
+      // observers
+      hasher
+      hash_function() const
+      { return _M_hash; }
+
+      key_equal
+      key_eq() const
+      { return _M_eq; }
+
+      const container_type&
+      container() const noexcept
+      { return _M_cont; }
+
+    private:
+      static const key_type&
+      _S_key(const value_type& __v) noexcept
+      {
+        if constexpr (std::is_same<_Key, _Tp>::value)
+          return __v;
+        else
+          return __detail::_Select1st{}(__v);
+      }
+
+      __index_type
+      _M_front_index() const noexcept
+      { return __seq_traits::_S_front_index(_M_cont); }
+
+      __index_type
+      _M_end_index() const noexcept
+      { return __seq_traits::_S_end_index(_M_cont); }
+
+      value_type&
+      _M_at(__index_type __i) noexcept
+      { return __seq_traits::_S_at(_M_cont, __i); }
+
+      const value_type&
+      _M_at(__index_type __i) const noexcept
+      { return __seq_traits::_S_at(_M_cont, __i); }
+
+      // The element at __i, to be moved from, with its mapped value.
+      decltype(auto)
+      _M_take(__index_type __i)
+      {
+        if constexpr (_S_mapped)
+          return __taken_type(std::move(_M_at(__i))
+                            , std::move(_M_cont.mapped_at_index(__i)));
+        else
+          return std::move(_M_at(__i));
+      }
+
+      // Assigns what _M_take() gave to the slot at __i.
+      void
+      _M_put(__index_type __i, __taken_type&& __v)
+      {
+        if constexpr (_S_mapped)
+          {
+            _M_at(__i) = std::move(__v.first);
+            _M_cont.mapped_at_index(__i) = std::move(__v.second);
+          }
+        else
+          _M_at(__i) = std::move(__v);
+      }
+
+      // Moves the element at __src, with its mapped value, to the slot at
+      // __dst.
+      void
+      _M_move_slot(__index_type __dst, __index_type __src)
+      {
+        _M_at(__dst) = std::move(_M_at(__src));
+        if constexpr (_S_mapped)
+          _M_cont.mapped_at_index(__dst)
+            = std::move(_M_cont.mapped_at_index(__src));
+      }
+
+      // Appends the element at __i, moved from, with its mapped value, to
+      // __c, this inner container or a new one.
+      void
+      _M_push_moved(_Container& __c, __index_type __i)
+      {
+        if constexpr (_S_mapped)
+          __c.emplace_back(std::piecewise_construct
+                         , std::forward_as_tuple(std::move(_M_at(__i)))
+                         , std::forward_as_tuple(
+                             std::move(_M_cont.mapped_at_index(__i))));
+        else
+          __c.push_back(std::move(_M_at(__i)));
+      }
+
+      template<typename _Kt, typename... _Args>
+        std::pair<iterator, bool>
+        _M_try_emplace_back(_Kt&& __k, _Args&&... __args)
+        {
+          static_assert(_S_mapped, "try_emplace_back() needs an inner "
+                                   "container keeping mapped values");
+          const std::size_t __code = _M_scanning() ? 0 : _M_hash(__k);
+          return _M_push_back_unique(__k, __code, [&, this]
+            {
+              _M_cont.emplace_back(std::piecewise_construct
+                                 , std::forward_as_tuple(
+                                     std::forward<_Kt>(__k))
+                                 , std::forward_as_tuple(
+                                     std::forward<_Args>(__args)...));
+            });
+        }
+
+      // hash code of the element at an index, for the index rebuilds
+      auto
+      _M_rehasher() const noexcept
+      {
+        return [this](__index_type __i)
+               { return _M_hash(_S_key(_M_at(__i))); };
+      }
+
+      template<typename _Kt>
+        __index_type*
+        _M_find_index(const _Kt& __k, std::size_t __code) const
+        {
+          auto __eq = [this, &__k](__index_type __i)
+                      { return _M_eq(_S_key(_M_at(__i)), __k); };
+          if constexpr (_S_records_stats)
+            this->_M_record_probe(
+              _M_index._M_probe_length(__code, __eq, _M_rehasher()));
+          return _M_index._M_find(__code, __eq, _M_rehasher());
+        }
+
+      // Indexes the element just pushed at __idx.  When recording, an
+      // insertion changing the bucket count is timed as a rehash.
+      void
+      _M_index_insert(std::size_t __code, __index_type __idx)
+      {
+        if constexpr (_S_records_stats)
+          {
+            using __clock = std::chrono::steady_clock;
+            if constexpr (__seq_traits::__relocates)
+              this->_M_record_capacity(_M_cont_capacity());
+            const size_type __bkts = bucket_count();
+            const __clock::time_point __start = __clock::now();
+            _M_index._M_insert(__code, __idx, _M_rehasher());
+            if (bucket_count() != __bkts)
+              this->_M_record_rehash(__clock::now() - __start);
+            this->_M_record_insert(load_factor());
+          }
+        else
+          _M_index._M_insert(__code, __idx, _M_rehasher());
+      }
+
+      // Slots the inner container holds storage for, the slots in use if
+      // it does not tell.
+      size_type
+      _M_cont_capacity() const noexcept
+      {
+        if constexpr (__detail::__has_capacity<_Container>::value)
+          return _M_cont.capacity();
+        else
+          return _M_end_index() - _M_front_index();
+      }
+
+      template<typename _Kt>
+        const_iterator
+        _M_find_tr(const _Kt& __k) const
+        {
+          if (_M_scanning())
+            return const_iterator(this, _M_scan(__k, _M_end_index()));
+          if (__index_type* __p = _M_find_index(__k, _M_hash(__k)))
+            return const_iterator(this, *__p);
+          return end();
+        }
+
+      template<typename _Kt>
+        std::optional<__taken_type>
+        _M_extract_tr(const _Kt& __k)
+        {
+          if (_M_scanning())
+            {
+              const __index_type __idx = _M_scan(__k, _M_end_index());
+              if (__idx == _M_end_index())
+                return std::nullopt;
+              std::optional<__taken_type> __ret(_M_take(__idx));
+              _M_close_gap(__idx);
+              return __ret;
+            }
+          _M_compact_step();
+          const std::size_t __code = _M_hash(__k);
+          __index_type* __p = _M_find_index(__k, __code);
+          if (!__p)
+            return std::nullopt;
+          const __index_type __idx = *__p;
+          // Unindexed first: the index may hash the element again. Should
+          // the move throw, the element is dropped.
+          _M_index._M_erase(__code, __idx, _M_rehasher());
+          __try
+            {
+              std::optional<__taken_type> __ret(_M_take(__idx));
+              _M_remove_slot(__idx);
+              return __ret;
+            }
+          __catch(...)
+            {
+              _M_remove_slot(__idx);
+              __throw_exception_again;
+            }
+        }
+
+      template<typename _Kt>
+        size_type
+        _M_erase_tr(const _Kt& __k)
+        {
+          if (_M_scanning())
+            {
+              const __index_type __idx = _M_scan(__k, _M_end_index());
+              if (__idx == _M_end_index())
+                return 0;
+              _M_close_gap(__idx);
+              return 1;
+            }
+          _M_compact_step();
+          const std::size_t __code = _M_hash(__k);
+          __index_type* __p = _M_find_index(__k, __code);
+          if (!__p)
+            return 0;
+          const __index_type __idx = *__p;
+          _M_index._M_erase(__code, __idx, _M_rehasher());
+          _M_remove_slot(__idx);
+          return 1;
+        }
+
+      // Whether the table is small and unindexed.  An indexed table only
+      // ever gets an empty index with its last element removed.
+      bool
+      _M_scanning() const noexcept
+      { return _S_small_size != 0 && _M_index.size() == 0; }
+
+      // The slot of the element with key __k among those before __end,
+      // __end if there is none.  Only for a small table, without holes.
+      // Keys compared by their bits are scanned a run of adjacent slots
+      // at a time.
+      template<typename _Kt>
+        __index_type
+        _M_scan(const _Kt& __k, __index_type __end) const
+        {
+          __index_type __i = _M_front_index();
+          if constexpr (_S_simd_scan && std::is_same<_Kt, _Key>::value)
+            while (__i != __end)
+              {
+                const std::size_t __n
+                  = __seq_traits::_S_contiguous(_M_cont, __i, __end);
+                const std::size_t __j
+                  = __detail::__simd_find(std::__addressof(_M_at(__i)), __n
+                                        , __k);
+                if (__j != __n)
+                  return __i + __j;
+                __i += __n;
+              }
+          else
+            while (__i != __end && !_M_eq(_S_key(_M_at(__i)), __k))
+              ++__i;
+          return __i;
+        }
+
+      /**
+       * @brief _M_parallel_fill
+       *    Appends the elements of [__first, __last) to the empty table,
+       *    the first of equivalent ones only, in order:
+       *    - each thread hashes a chunk of the keys, and counts them by
+       *      partition, a partition being a range of the hash codes;
+       *    - each thread scatters the positions of its chunk to their
+       *      partitions, in order, so a partition lists its positions in
+       *      ascending order;
+       *    - each thread takes whole partitions, and marks in each the
+       *      positions of the keys not seen before in it, with an open
+       *      addressing set of positions: equivalent keys have equal
+       *      codes and fall in the same partition, the first seen is the
+       *      first of them;
+       *    - the caller appends the marked elements in order, indexing
+       *      each under its code, without a lookup.
+       *    Falls back to push_range() when there are too few elements to
+       *    share.
+       */
+      template<typename _RandomAccessIterator>
+        void
+        _M_parallel_fill(_RandomAccessIterator __first
+                       , _RandomAccessIterator __last)
+        {
+          const std::size_t __n = __last - __first;
+          const unsigned __workers
+            = __detail::__parallel_workers(__n, _S_parallel_grain);
+          if (__workers <= 1)
+            {
+              push_range(__first, __last);
+              return;
+            }
+
+          // A few partitions a thread, so that uneven ones even out.
+          unsigned __log2_parts = 1;
+          while ((1u << __log2_parts) < 8 * __workers)
+            ++__log2_parts;
+          const std::size_t __parts = std::size_t(1) << __log2_parts;
+          const int __shift
+            = std::numeric_limits<std::size_t>::digits - __log2_parts;
+          auto __part_of = [__shift](std::size_t __code)
+            { return __detail::__hash_mix(__code) >> __shift; };
+
+          std::vector<std::size_t> __codes(__n);
+          // __offsets[__t * __parts + __p]: where chunk __t of the input
+          // scatters to partition __p, once counted and summed up.
+          std::vector<std::size_t> __offsets(__workers * __parts);
+          __detail::__parallel_run(__workers, [&](unsigned __t)
+            {
+              const auto __chunk
+                = __detail::__parallel_chunk(__n, __workers, __t);
+              std::size_t* __count = __offsets.data() + __t * __parts;
+              for (std::size_t __i = __chunk.first; __i != __chunk.second;
+                   ++__i)
+                {
+                  __codes[__i] = _M_hash(_S_key(__first[__i]));
+                  ++__count[__part_of(__codes[__i])];
+                }
+            });
+
+          std::vector<std::size_t> __part_begin(__parts + 1);
+          std::size_t __sum = 0;
+          for (std::size_t __p = 0; __p != __parts; ++__p)
+            {
+              __part_begin[__p] = __sum;
+              for (unsigned __t = 0; __t != __workers; ++__t)
+                {
+                  const std::size_t __cnt = __offsets[__t * __parts + __p];
+                  __offsets[__t * __parts + __p] = __sum;
+                  __sum += __cnt;
+                }
+            }
+          __part_begin[__parts] = __sum;
+
+          std::vector<std::size_t> __positions(__n);
+          std::vector<unsigned char> __keep(__n);
+          __detail::__parallel_run(__workers, [&](unsigned __t)
+            {
+              const auto __chunk
+                = __detail::__parallel_chunk(__n, __workers, __t);
+              std::size_t* __next = __offsets.data() + __t * __parts;
+              for (std::size_t __i = __chunk.first; __i != __chunk.second;
+                   ++__i)
+                __positions[__next[__part_of(__codes[__i])]++] = __i;
+            });
+
+          __detail::__parallel_run(__workers, [&](unsigned __t)
+            {
+              const std::size_t __none = std::size_t(-1);
+              std::vector<std::size_t> __set;
+              for (std::size_t __p = __t; __p < __parts; __p += __workers)
+                {
+                  const std::size_t* __pos
+                    = __positions.data() + __part_begin[__p];
+                  const std::size_t __cnt
+                    = __part_begin[__p + 1] - __part_begin[__p];
+                  std::size_t __cap = 16;
+                  while (__cap < 2 * __cnt)
+                    __cap <<= 1;
+                  __set.assign(__cap, __none);
+                  for (std::size_t __j = 0; __j != __cnt; ++__j)
+                    {
+                      const std::size_t __i = __pos[__j];
+                      const std::size_t __code = __codes[__i];
+                      // The low bits, the partition took the high ones.
+                      std::size_t __s
+                        = __detail::__hash_mix(__code) & (__cap - 1);
+                      for (;; __s = (__s + 1) & (__cap - 1))
+                        {
+                          const std::size_t __other = __set[__s];
+                          if (__other == __none)
+                            {
+                              __set[__s] = __i;
+                              __keep[__i] = 1;
+                              break;
+                            }
+                          if (__codes[__other] == __code
+                              && _M_eq(_S_key(__first[__other])
+                                     , _S_key(__first[__i])))
+                            break;
+                        }
+                    }
+                }
+            });
+
+          const std::size_t __kept
+            = std::count(__keep.begin(), __keep.end(), 1);
+          reserve(__kept);
+          const bool __indexed = __kept > _S_small_size;
+          for (std::size_t __i = 0; __i != __n; ++__i)
+            if (__keep[__i])
+              {
+                const __index_type __idx = _M_end_index();
+                _M_cont.push_back(__first[__i]);
+                if (__indexed)
+                  _M_index_insert(__codes[__i], __idx);
+              }
+        }
+
+      // Threads taking part in a pass over the slots under
+      // _ExecutionPolicy, one when it is sequential.
+      template<typename _ExecutionPolicy>
+        unsigned
+        _M_workers() const noexcept
+        {
+          if constexpr (__detail::__allows_parallel<_ExecutionPolicy>::value)
+            return __detail::__parallel_workers(_M_cont.size()
+                                              , _S_parallel_grain);
+          else
+            return 1;
+        }
+
+      // Indexes all the elements of a small table that just outgrew
+      // _S_small_size.  Should that throw, the table stays a small one.
+      void
+      _M_build_index()
+      {
+        __try
+          {
+            _M_index._M_reserve(_M_cont.size(), _M_rehasher());
+            for (__index_type __i = _M_front_index(), __end = _M_end_index();
+                 __i != __end; ++__i)
+              _M_index_insert(_M_hash(_S_key(_M_at(__i))), __i);
+          }
+        __catch(...)
+          {
+            _M_index._M_clear();
+            __throw_exception_again;
+          }
+        _M_pack = _Compaction();
+      }
+
+      // Removes the slot at __i of a small table: the elements after it
+      // move down one slot, or it is popped at the front.
+      void
+      _M_close_gap(__index_type __i)
+      {
+        if constexpr (__seq_traits::__stable_front)
+          if (__i == _M_front_index())
+            {
+              _M_cont.pop_front();
+              return;
+            }
+        if constexpr (_S_small_size != 0)
+          for (const __index_type __back = _M_end_index() - 1;
+               __i != __back; ++__i)
+            _M_move_slot(__i, __i + 1);
+        _M_cont.pop_back();
+      }
+
+      // The index entry pointing back to the slot at __i, null for a hole.
+      __index_type*
+      _M_entry_of(__index_type __i) const
+      {
+        return _M_index._M_find(_M_hash(_S_key(_M_at(__i)))
+                              , [__i](__index_type __j) { return __j == __i; }
+                              , _M_rehasher());
+      }
+
+      // A slot is live when the index points back to it.
+      bool
+      _M_is_live(__index_type __i) const
+      { return _M_holes == 0 || _M_entry_of(__i) != nullptr; }
+
+      __index_type
+      _M_next_live(__index_type __i) const
+      {
+        const __index_type __end = _M_end_index();
+        while (_M_holes && __i != __end && !_M_is_live(__i))
+          ++__i;
+        return __i;
+      }
+
+      template<typename _Arg>
+        std::pair<iterator, bool>
+        _M_push_back(_Arg&& __v)
+        {
+          // A small table does without the hash code.
+          const std::size_t __code = _M_scanning() ? 0 : _M_hash(_S_key(__v));
+          return _M_push_back_hashed(std::forward<_Arg>(__v), __code);
+        }
+
+      template<typename _Arg>
+        std::pair<iterator, bool>
+        _M_push_back_hashed(_Arg&& __v, std::size_t __code)
+        {
+          return _M_push_back_unique(_S_key(__v), __code, [this, &__v]
+            { _M_cont.push_back(std::forward<_Arg>(__v)); });
+        }
+
+      // Looks up __k, of hash code __code unless the table is scanned, and
+      // only if it is not in calls __append to append its element to the
+      // inner container, then indexes it.
+      template<typename _Append>
+        std::pair<iterator, bool>
+        _M_push_back_unique(const key_type& __k, std::size_t __code
+                          , _Append __append)
+        {
+          if (_M_scanning())
+            {
+              const __index_type __idx = _M_end_index();
+              const __index_type __found = _M_scan(__k, __idx);
+              if (__found != __idx)
+                return { const_iterator(this, __found), false };
+              __append();
+              if (_M_cont.size() > _S_small_size)
+                __try
+                  {
+                    _M_build_index();
+                  }
+                __catch(...)
+                  {
+                    _M_cont.pop_back();
+                    __throw_exception_again;
+                  }
+              return { const_iterator(this, __idx), true };
+            }
+          if (__index_type* __p = _M_find_index(__k, __code))
+            return { const_iterator(this, *__p), false };
+
+          const __index_type __idx = _M_end_index();
+          __append();
+          __try
+            {
+              _M_index_insert(__code, __idx);
+            }
+          __catch(...)
+            {
+              _M_cont.pop_back();
+              __throw_exception_again;
+            }
+          return { const_iterator(this, __idx), true };
+        }
+
+      // Pops __n elements from the front, or the back, hashing a block of
+      // live elements ahead. The popped end is always live, the holes
+      // behind it are trimmed as it moves.
+      template<bool _Front, typename _OutputIterator>
+        _OutputIterator
+        _M_pop_n(size_type __n, _OutputIterator __out)
+        {
+          __n = std::min(__n, size());
+          if (_M_scanning())
+            {
+              for (; __n != 0; --__n, ++__out)
+                {
+                  const __index_type __idx
+                    = _Front ? _M_front_index() : _M_end_index() - 1;
+                  *__out = _M_take(__idx);
+                  if constexpr (_Front)
+                    _M_cont.pop_front();
+                  else
+                    _M_cont.pop_back();
+                }
+              return __out;
+            }
+          std::size_t __codes[_S_batch];
+          while (__n != 0)
+            {
+              const size_type __cnt = std::min(__n, size_type(_S_batch));
+              __index_type __i = _Front ? _M_front_index() : _M_end_index() - 1;
+              for (size_type __k = 0; __k != __cnt; ++__k)
+                {
+                  while (!_M_is_live(__i))
+                    _Front ? ++__i : --__i;
+                  __codes[__k] = _M_hash(_S_key(_M_at(__i)));
+                  _M_index._M_prefetch(__codes[__k]);
+                  _Front ? ++__i : --__i;
+                }
+              for (size_type __k = 0; __k != __cnt; ++__k)
+                {
+                  const __index_type __idx
+                    = _Front ? _M_front_index() : _M_end_index() - 1;
+                  // As in extract(), unindexed before being moved from.
+                  _M_index._M_erase(__codes[__k], __idx, _M_rehasher());
+                  __try
+                    {
+                      *__out = _M_take(__idx);
+                      ++__out;
+                    }
+                  __catch(...)
+                    {
+                      _M_remove_slot(__idx);
+                      __throw_exception_again;
+                    }
+                  _M_remove_slot(__idx);
+                }
+              __n -= __cnt;
+            }
+          return __out;
+        }
+
+      void
+      _M_erase_index(__index_type __i)
+      { _M_index._M_erase(_M_hash(_S_key(_M_at(__i))), __i, _M_rehasher()); }
+
+      // The slot at __i is no longer indexed: pop it if it is at an end of
+      // the sequence, otherwise it becomes a hole.
+      void
+      _M_remove_slot(__index_type __i)
+      {
+        if (__i == _M_end_index() - 1)
+          {
+            _M_cont.pop_back();
+            _M_trim_back();
+            return;
+          }
+        if constexpr (__seq_traits::__stable_front)
+          if (__i == _M_front_index())
+            {
+              _M_cont.pop_front();
+              _M_trim_front();
+              return;
+            }
+        ++_M_holes;
+      }
+
+      // Pops the holes reaching the front, keeps front() a live element.
+      void
+      _M_trim_front()
+      {
+        if constexpr (__seq_traits::__stable_front)
+          while (_M_holes && !_M_cont.empty() && !_M_is_live(_M_front_index()))
+            {
+              _M_cont.pop_front();
+              --_M_holes;
+            }
+      }
+
+      // Also pulls the compaction cursors back under the end: the slots
+      // pushed from now on are not among the dead ones the pass left.
+      void
+      _M_trim_back()
+      {
+        while (_M_holes && !_M_cont.empty() && !_M_is_live(_M_end_index() - 1))
+          {
+            _M_cont.pop_back();
+            --_M_holes;
+          }
+        _M_pack._M_src = std::min(_M_pack._M_src, _M_end_index());
+        _M_pack._M_dst = std::min(_M_pack._M_dst, _M_pack._M_src);
+      }
+
+      // Drops all the holes, linear in the number of slots.  Assignable
+      // elements, and mapped values, slide down in place, as in a full pass of
+      // _M_compact_step(), without allocating.  The others are moved into
+      // a fresh inner container, in sequence order, and indexed again:
+      // the live slots are all found before any element is moved from, a
+      // lookup may hash the elements of other slots.
+      void
+      _M_compact()
+      {
+        if constexpr (_S_assignable)
+          {
+            const __index_type __end = _M_end_index();
+            __index_type __dst = _M_front_index();
+            for (__index_type __src = __dst; __src != __end; ++__src)
+              if (__index_type* __p = _M_entry_of(__src))
+                {
+                  if (__src != __dst)
+                    {
+                      _M_move_slot(__dst, __src);
+                      *__p = __dst;
+                    }
+                  ++__dst;
+                }
+            for (__index_type __i = __end; __i != __dst; --__i)
+              _M_cont.pop_back();
+            _M_holes = 0;
+            _M_pack = _Compaction();
+            return;
+          }
+
+        const __index_type __front = _M_front_index();
+        std::vector<bool> __live(_M_end_index() - __front);
+        for (std::size_t __i = 0; __i != __live.size(); ++__i)
+          __live[__i] = _M_is_live(__front + __i);
+
+        _Container __tmp(_M_cont.get_allocator());
+        if constexpr (__detail::__has_reserve<_Container>::value)
+          __tmp.reserve(size());
+        for (std::size_t __i = 0; __i != __live.size(); ++__i)
+          if (__live[__i])
+            _M_push_moved(__tmp, __front + __i);
+
+        _M_cont = std::move(__tmp);
+        _M_holes = 0;
+        _M_pack = _Compaction();
+        _M_index._M_clear();
+        const auto __rehash = _M_rehasher();
+        for (__index_type __i = _M_front_index(), __end = _M_end_index();
+             __i != __end; ++__i)
+          _M_index._M_insert(__rehash(__i), __i, __rehash);
+      }
+
+      // One step of the incremental compaction, examining at most
+      // _S_compact_step slots. A pass starts once the holes make a third
+      // of the slots: the live elements slide down to _M_dst in order,
+      // their index entries rewritten in place, and the dead tail is
+      // popped when _M_src reaches the end. The slots of [_M_dst, _M_src)
+      // are all unindexed, holes like the others, so lookups, iteration
+      // and pops need not know a pass is going on.
+      void
+      _M_compact_step()
+      {
+        if constexpr (!_S_assignable)
+          {
+            // The elements can only be moved into a new container.
+            if (_M_holes * 2 > size())
+              _M_compact();
+          }
+        else
+          {
+            if (!_M_pack._M_active)
+              {
+                if (_M_holes * 2 <= size())
+                  return;
+                _M_pack._M_src = _M_pack._M_dst = _M_front_index();
+                _M_pack._M_active = true;
+              }
+
+            // The front may have been trimmed since the last step.
+            __index_type __end = _M_end_index();
+            __index_type __dst = std::max(_M_pack._M_dst, _M_front_index());
+            __index_type __src = std::max(_M_pack._M_src, __dst);
+            for (std::size_t __n = 0;
+                 __n != _S_compact_step && _M_holes && __src != __end;
+                 ++__n, ++__src)
+              if (__index_type* __p = _M_entry_of(__src))
+                {
+                  if (__src != __dst)
+                    {
+                      _M_move_slot(__dst, __src);
+                      *__p = __dst;
+                    }
+                  ++__dst;
+                }
+
+            _M_pack._M_src = __src;
+            _M_pack._M_dst = __dst;
+            if (__src == __end)
+              {
+                // Only the moved from elements are left past __dst.
+                for (; __end != __dst; --__end)
+                  {
+                    _M_cont.pop_back();
+                    --_M_holes;
+                  }
+                _M_trim_back();
+                _M_pack = _Compaction();
+              }
+            else if (_M_holes == 0)
+              _M_pack = _Compaction();
+          }
+      }
+    };
+
+  /**
+   *  @brief The _ContainerHasher::const_iterator class
+   *    Forward iterator over the elements in sequence order, stepping over
+   *    the holes.
+   */
+  template<typename _Tp, typename _Alloc, typename _Key, typename _Container
+          ,typename _Hash, typename _Equal, typename _IndexPolicy>
+    class _ContainerHasher<_Tp, _Alloc, _Key, _Container
+                         , _Hash, _Equal, _IndexPolicy>::const_iterator
+    {
+      friend class _ContainerHasher;
+
+      const _ContainerHasher* _M_h = nullptr;
+      __index_type            _M_idx = 0;
+
+      const_iterator(const _ContainerHasher* __h, __index_type __idx) noexcept
+      : _M_h(__h), _M_idx(__idx)
+      { }
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = _Tp;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const _Tp*;
+      using reference = const _Tp&;
+
+      const_iterator() = default;
+
+      reference
+      operator*() const noexcept
+      { return _M_h->_M_at(_M_idx); }
+
+      pointer
+      operator->() const noexcept
+      { return std::__addressof(_M_h->_M_at(_M_idx)); }
+
+      const_iterator&
+      operator++()
+      {
+        _M_idx = _M_h->_M_next_live(_M_idx + 1);
+        return *this;
+      }
+
+      const_iterator
+      operator++(int)
+      {
+        const_iterator __tmp(*this);
+        ++*this;
+        return __tmp;
+      }
+
+      friend bool
+      operator==(const const_iterator& __x, const const_iterator& __y) noexcept
+      { return __x._M_idx == __y._M_idx; }
+
+      friend bool
+      operator!=(const const_iterator& __x, const const_iterator& __y) noexcept
+      { return __x._M_idx != __y._M_idx; }
+    };
+
+  template<typename _Tp, typename _Alloc, typename _Key, typename _Container
+          ,typename _Hash, typename _Equal, typename _IndexPolicy>
+    inline void
+    swap(_ContainerHasher<_Tp, _Alloc, _Key, _Container
+                        , _Hash, _Equal, _IndexPolicy>& __x
+       , _ContainerHasher<_Tp, _Alloc, _Key, _Container
+                        , _Hash, _Equal, _IndexPolicy>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // CONTAINER_HASHER_H
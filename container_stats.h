@@ -0,0 +1,212 @@
+// Statistics of the hashed containers -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file bits/container_stats.h
+ *  This is an internal header file, included by other library headers.
+ *  Do not attempt to use it directly.
+ *  @headername{hashed_stack, hashed_queue}
+ */
+
+#ifndef CONTAINER_STATS_H
+#define CONTAINER_STATS_H 1
+
+#pragma GCC system_header
+
+#include <algorithm>         // for std::min
+#include <chrono>
+#include <cstddef>
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+  /**
+   *  @brief Statistics of a hashed container built with
+   *  __detail::_Recording_index_policy, as returned by its stats().
+   */
+  struct hashed_stats
+  {
+    static constexpr std::size_t probe_bins = 16;
+    static constexpr std::size_t load_samples = 32;
+    // insertions between two samples of the load factor
+    static constexpr std::size_t sample_period = 1024;
+
+    /// Lookups by count of index entries examined: nodes of the bucket
+    /// for the chained index, groups probed for the flat one.  The last
+    /// bin also counts the longer lookups.
+    std::size_t probe_histogram[probe_bins];
+    std::size_t lookups;
+
+    /// The last load_factor_count samples of the load factor, oldest
+    /// first.
+    float       load_factor_history[load_samples];
+    std::size_t load_factor_count;
+    float       load_factor;
+
+    /// Insertions that grew the index, and the time they took.
+    std::size_t              rehash_count;
+    std::chrono::nanoseconds rehash_time;
+
+    /// Times the storage of the inner container was seen reallocated.
+    std::size_t container_reallocations;
+
+    /// Bytes held now by the inner container and by the index.
+    std::size_t element_bytes;
+    std::size_t index_bytes;
+  };
+
+  /**
+   *  @brief Statistics of a __detail::svector built with
+   *  __detail::_Record_stats, as returned by its stats().
+   */
+  struct svector_stats
+  {
+    /// Insertions that moved the values to a larger buffer.
+    std::size_t reallocations;
+    /// Bytes of all the buffers allocated, and of the current one.
+    std::size_t bytes_allocated;
+    std::size_t bytes_held;
+  };
+
+namespace __detail
+{
+  /**
+   * @addtogroup _ContainerHasher-detail
+   * @{
+   */
+
+  /// Statistics policies: nothing is recorded, and nothing is stored,
+  /// unless _Record_stats is selected.
+  struct _No_stats
+  { static constexpr bool __enabled = false; };
+
+  struct _Record_stats
+  { static constexpr bool __enabled = true; };
+
+  // Counters of _ContainerHasher, an empty base when not recording.
+  template<bool _Enabled>
+    struct _Hash_stats_recorder
+    { };
+
+  template<>
+    struct _Hash_stats_recorder<true>
+    {
+      // Lookups are const, and recorded.
+      mutable std::size_t _M_probes[hashed_stats::probe_bins] = { };
+      mutable std::size_t _M_lookups = 0;
+      std::size_t _M_inserts = 0;
+      float       _M_load[hashed_stats::load_samples] = { };
+      std::size_t _M_load_count = 0;
+      std::size_t _M_rehashes = 0;
+      std::chrono::nanoseconds _M_rehash_time{0};
+      std::size_t _M_reallocs = 0;
+      std::size_t _M_last_capacity = 0;
+
+      void
+      _M_record_probe(std::size_t __n) const noexcept
+      {
+        ++_M_lookups;
+        ++_M_probes[std::min(__n, hashed_stats::probe_bins - 1)];
+      }
+
+      void
+      _M_record_insert(float __load) noexcept
+      {
+        if (++_M_inserts % hashed_stats::sample_period == 0)
+          _M_load[_M_load_count++ % hashed_stats::load_samples] = __load;
+      }
+
+      void
+      _M_record_rehash(std::chrono::nanoseconds __d) noexcept
+      {
+        ++_M_rehashes;
+        _M_rehash_time += __d;
+      }
+
+      // A change of capacity from a non zero one is a reallocation.
+      void
+      _M_record_capacity(std::size_t __cap) noexcept
+      {
+        if (__cap != _M_last_capacity)
+          {
+            _M_reallocs += _M_last_capacity != 0;
+            _M_last_capacity = __cap;
+          }
+      }
+
+      void
+      _M_snapshot(hashed_stats& __s) const noexcept
+      {
+        for (std::size_t __i = 0; __i != hashed_stats::probe_bins; ++__i)
+          __s.probe_histogram[__i] = _M_probes[__i];
+        __s.lookups = _M_lookups;
+
+        const std::size_t __n
+          = std::min(_M_load_count, hashed_stats::load_samples);
+        const std::size_t __first = _M_load_count - __n;
+        for (std::size_t __i = 0; __i != hashed_stats::load_samples; ++__i)
+          __s.load_factor_history[__i] = __i < __n
+            ? _M_load[(__first + __i) % hashed_stats::load_samples] : 0.0f;
+        __s.load_factor_count = __n;
+
+        __s.rehash_count = _M_rehashes;
+        __s.rehash_time = _M_rehash_time;
+        __s.container_reallocations = _M_reallocs;
+      }
+    };
+
+  // Counters of svector, an empty base when not recording.
+  template<bool _Enabled>
+    struct _Silver_stats_recorder
+    {
+      constexpr void
+      _M_record_alloc(std::size_t) noexcept
+      { }
+
+      constexpr void
+      _M_record_realloc() noexcept
+      { }
+    };
+
+  template<>
+    struct _Silver_stats_recorder<true>
+    {
+      std::size_t _M_reallocs = 0;
+      std::size_t _M_bytes = 0;
+
+      constexpr void
+      _M_record_alloc(std::size_t __bytes) noexcept
+      { _M_bytes += __bytes; }
+
+      constexpr void
+      _M_record_realloc() noexcept
+      { ++_M_reallocs; }
+    };
+
+  ///@} _ContainerHasher-detail
+} // namespace __detail
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // CONTAINER_STATS_H
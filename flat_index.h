@@ -0,0 +1,958 @@
+// Open-addressing index for _ContainerHasher -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file bits/flat_index.h
+ *  This is an internal header file, included by other library headers.
+ *  Do not attempt to use it directly.
+ *  @headername{hashed_stack, hashed_queue}
+ */
+
+#ifndef FLAT_INDEX_H
+#define FLAT_INDEX_H 1
+
+#pragma GCC system_header
+
+#include <memory>      // for std::allocator_traits
+#include <cstring>     // for std::memset, std::memcpy
+#include <cstdint>     // for std::uint32_t
+#include <type_traits>
+#include <utility>     // for std::swap
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+    /// @cond undocumented
+
+namespace __detail
+{
+/**
+  *  @addtogroup _ContainerHasher-detail
+  *  @{
+  */
+
+  // Spreads the entropy of a hash code over all its bits.  The flat index
+  // takes its group position from the high bits and its fingerprint from
+  // the low seven bits, which are both poor for identity hashes such as
+  // std::hash<int>.
+  constexpr std::size_t
+  __hash_mix(std::size_t __code) noexcept
+  {
+    if constexpr (sizeof(std::size_t) == 8)
+      {
+        __code *= 0x9e3779b97f4a7c15ull;
+        return __code ^ (__code >> 32);
+      }
+    else
+      {
+        __code *= 0x9e3779b9u;
+        return __code ^ (__code >> 16);
+      }
+  }
+
+  /**
+   *  struct _Flat_ctrl
+   *
+   *  Control byte values of the flat index.  A full slot holds the low
+   *  seven bits of its mixed hash code (so is non-negative), an empty
+   *  slot ends every probe sequence going through its group, a deleted
+   *  slot is a tombstone that probes walk over.
+   */
+  struct _Flat_ctrl
+  {
+    using __ctrl_type = signed char;
+
+    static constexpr __ctrl_type _S_empty = -128;
+    static constexpr __ctrl_type _S_deleted = -2;
+
+    static constexpr std::size_t _S_group_width = 16;
+
+    static constexpr bool
+    _S_is_full(__ctrl_type __c) noexcept
+    { return __c >= 0; }
+
+    static constexpr __ctrl_type
+    _S_h2(std::size_t __mixed) noexcept
+    { return static_cast<__ctrl_type>(__mixed & 0x7f); }
+
+    static constexpr std::size_t
+    _S_h1(std::size_t __mixed) noexcept
+    { return __mixed >> 7; }
+  };
+
+  /// Set of slots of a group, one bit per slot.
+  struct _Flat_bitmask
+  {
+    std::uint32_t _M_mask;
+
+    explicit operator bool() const noexcept
+    { return _M_mask != 0; }
+
+    std::size_t
+    _M_lowest() const noexcept
+    { return __builtin_ctz(_M_mask); }
+
+    void
+    _M_pop_lowest() noexcept
+    { _M_mask &= _M_mask - 1; }
+  };
+
+  /**
+   *  struct _Flat_group
+   *
+   *  Sixteen consecutive control bytes loaded at once.  With SSE2 each
+   *  query is a single compare and a movemask, otherwise the bytes are
+   *  scanned one by one.
+   */
+  struct _Flat_group : _Flat_ctrl
+  {
+#if defined(__SSE2__)
+    __m128i _M_ctrl;
+
+    explicit
+    _Flat_group(const __ctrl_type* __pos) noexcept
+    : _M_ctrl(_mm_load_si128(reinterpret_cast<const __m128i*>(__pos)))
+    { }
+
+    _Flat_bitmask
+    _M_match(__ctrl_type __h2) const noexcept
+    {
+      auto __cmp = _mm_cmpeq_epi8(_mm_set1_epi8(__h2), _M_ctrl);
+      return { static_cast<std::uint32_t>(_mm_movemask_epi8(__cmp)) };
+    }
+
+    _Flat_bitmask
+    _M_match_empty() const noexcept
+    { return _M_match(_S_empty); }
+
+    // Empty and deleted are the only negative values below -1.
+    _Flat_bitmask
+    _M_match_empty_or_deleted() const noexcept
+    {
+      auto __cmp = _mm_cmpgt_epi8(_mm_set1_epi8(-1), _M_ctrl);
+      return { static_cast<std::uint32_t>(_mm_movemask_epi8(__cmp)) };
+    }
+#else
+    const __ctrl_type* _M_ctrl;
+
+    explicit
+    _Flat_group(const __ctrl_type* __pos) noexcept
+    : _M_ctrl(__pos)
+    { }
+
+    _Flat_bitmask
+    _M_match(__ctrl_type __h2) const noexcept
+    {
+      std::uint32_t __mask = 0;
+      for (std::size_t __i = 0; __i < _S_group_width; ++__i)
+        __mask |= std::uint32_t(_M_ctrl[__i] == __h2) << __i;
+      return { __mask };
+    }
+
+    _Flat_bitmask
+    _M_match_empty() const noexcept
+    { return _M_match(_S_empty); }
+
+    _Flat_bitmask
+    _M_match_empty_or_deleted() const noexcept
+    {
+      std::uint32_t __mask = 0;
+      for (std::size_t __i = 0; __i < _S_group_width; ++__i)
+        __mask |= std::uint32_t(_M_ctrl[__i] < -1) << __i;
+      return { __mask };
+    }
+#endif
+  };
+
+  /**
+   *  class _Flat_index
+   *
+   *  Open-addressing index of _ContainerHasher.  Instead of one
+   *  _Hash_node per element, the index keeps two flat arrays in a single
+   *  allocation: one control byte per slot followed by the slots
+   *  themselves, each holding an index into the inner container.
+   *
+   *  Groups of 16 control bytes are probed with one compare, the key
+   *  itself is only compared (through the caller supplied predicate) for
+   *  slots whose 7-bit fingerprint matches, so a lookup usually touches
+   *  one control line and one slot line.
+   *
+   *  The index never sees the keys: callers hand over the hash code and
+   *  a predicate on stored indices, and a functor giving back the hash
+   *  code of a stored index whenever the table has to be rebuilt.
+   */
+  template<typename _Index, typename _Alloc = std::allocator<_Index>>
+    class _Flat_index : _Flat_ctrl
+    {
+      static_assert(std::is_trivially_copyable<_Index>::value
+                    , "flat index slots are copied bytewise");
+
+      struct alignas(_S_group_width) __storage_unit
+      { unsigned char _M_bytes[_S_group_width]; };
+
+      using __unit_alloc_type = std::__alloc_rebind<_Alloc, __storage_unit>;
+      using __unit_alloc_traits = std::allocator_traits<__unit_alloc_type>;
+
+    public:
+      using size_type = std::size_t;
+      using index_type = _Index;
+      using allocator_type = _Alloc;
+
+    private:
+      __ctrl_type*      _M_ctrl = nullptr;
+      _Index*           _M_slots = nullptr;
+      size_type         _M_capacity = 0;
+      size_type         _M_size = 0;
+      size_type         _M_growth_left = 0;
+      __unit_alloc_type _M_alloc;
+
+    public:
+      _Flat_index() = default;
+
+      explicit
+      _Flat_index(const allocator_type& __a) noexcept
+      : _M_alloc(__a)
+      { }
+
+      _Flat_index(const _Flat_index& __othr)
+      : _M_alloc(__unit_alloc_traits::
+                 select_on_container_copy_construction(__othr._M_alloc))
+      { _M_copy_from(__othr); }
+
+      // Copies of the chained index need the functor, not this one.
+      template<typename _Rehash>
+        _Flat_index(const _Flat_index& __othr, _Rehash&&)
+        : _Flat_index(__othr)
+        { }
+
+      template<typename _Rehash>
+        _Flat_index(const _Flat_index& __othr, _Rehash&&
+                  , const allocator_type& __a)
+        : _M_alloc(__a)
+        { _M_copy_from(__othr); }
+
+      _Flat_index(_Flat_index&& __othr) noexcept
+      : _M_ctrl(std::__exchange(__othr._M_ctrl, nullptr))
+      , _M_slots(std::__exchange(__othr._M_slots, nullptr))
+      , _M_capacity(std::__exchange(__othr._M_capacity, 0))
+      , _M_size(std::__exchange(__othr._M_size, 0))
+      , _M_growth_left(std::__exchange(__othr._M_growth_left, 0))
+      , _M_alloc(std::move(__othr._M_alloc))
+      { }
+
+      _Flat_index&
+      operator=(_Flat_index __othr) noexcept
+      {
+        swap(__othr);
+        return *this;
+      }
+
+      ~_Flat_index()
+      { _M_deallocate(); }
+
+      // The allocator follows the copy only if it propagates.
+      template<typename _Rehash>
+        void
+        _M_copy_assign(const _Flat_index& __othr, _Rehash&& __rehash)
+        {
+          if (this == std::__addressof(__othr))
+            return;
+          using _Pocca = typename __unit_alloc_traits::
+                           propagate_on_container_copy_assignment;
+          _Flat_index __tmp(__othr, __rehash
+                          , allocator_type(_Pocca::value ? __othr._M_alloc
+                                                         : _M_alloc));
+          std::swap(_M_ctrl, __tmp._M_ctrl);
+          std::swap(_M_slots, __tmp._M_slots);
+          std::swap(_M_capacity, __tmp._M_capacity);
+          std::swap(_M_size, __tmp._M_size);
+          std::swap(_M_growth_left, __tmp._M_growth_left);
+          if constexpr (_Pocca::value)
+            std::swap(_M_alloc, __tmp._M_alloc);
+        }
+
+      void
+      swap(_Flat_index& __othr) noexcept
+      {
+        std::swap(_M_ctrl, __othr._M_ctrl);
+        std::swap(_M_slots, __othr._M_slots);
+        std::swap(_M_capacity, __othr._M_capacity);
+        std::swap(_M_size, __othr._M_size);
+        std::swap(_M_growth_left, __othr._M_growth_left);
+        std::__alloc_on_swap(_M_alloc, __othr._M_alloc);
+      }
+
+      size_type
+      size() const noexcept
+      { return _M_size; }
+
+      bool
+      empty() const noexcept
+      { return _M_size == 0; }
+
+      // Number of slots, the equivalent of the bucket count.
+      size_type
+      bucket_count() const noexcept
+      { return _M_capacity; }
+
+      float
+      load_factor() const noexcept
+      { return _M_capacity ? float(_M_size) / float(_M_capacity) : 0.0f; }
+
+      static constexpr float
+      max_load_factor() noexcept
+      { return 7.0f / 8.0f; }
+
+      allocator_type
+      get_allocator() const noexcept
+      { return allocator_type(_M_alloc); }
+
+      /**
+       * @brief _M_find
+       *    Looks up the slot of the element hashed to @a __code for which
+       *    @a __eq returns true.
+       * @param __code
+       *    The hash code of the looked up key.
+       * @param __eq
+       *    Predicate on a stored index, comparing the element it refers to
+       *    with the looked up key.
+       * @return a pointer to the stored index, or nullptr.
+       */
+      template<typename _Pred, typename _Rehash>
+        _Index*
+        _M_find(std::size_t __code, _Pred&& __eq, _Rehash&&) const
+        { return _M_find(__code, __eq); }
+
+      template<typename _Pred>
+        _Index*
+        _M_find(std::size_t __code, _Pred&& __eq) const
+        { return _S_find(_M_ctrl, _M_slots, _M_capacity, __code, __eq); }
+
+      /**
+       * @brief _S_find
+       *    As _M_find(), on a table laid out by _Flat_index but owned by
+       *    someone else, e.g. mapped from a file: @a __cap control bytes
+       *    and the slots @a __slots.  The probing stops once it visited
+       *    every group, should none of them hold an empty byte.
+       */
+      template<typename _Slot, typename _Pred>
+        static _Slot*
+        _S_find(const __ctrl_type* __ctrl, _Slot* __slots, size_type __cap
+              , std::size_t __code, _Pred&& __eq)
+        {
+          if (__cap == 0)
+            return nullptr;
+
+          const std::size_t __mixed = __hash_mix(__code);
+          const __ctrl_type __h2 = _S_h2(__mixed);
+          const size_type __groups = __cap / _S_group_width;
+          const size_type __gmask = __groups - 1;
+          size_type __g = _S_h1(__mixed) & __gmask;
+          // the triangular steps visit each group once in __groups steps
+          for (size_type __step = 1; __step <= __groups; ++__step)
+            {
+              _Flat_group __grp(__ctrl + __g * _S_group_width);
+              for (auto __m = __grp._M_match(__h2); __m; __m._M_pop_lowest())
+                {
+                  _Slot* __slot =
+                    __slots + __g * _S_group_width + __m._M_lowest();
+                  if (__eq(*__slot))
+                    return __slot;
+                }
+              if (__grp._M_match_empty())
+                return nullptr;
+              __g = (__g + __step) & __gmask;
+            }
+          return nullptr;
+        }
+
+      /**
+       * @brief _M_insert
+       *    Stores @a __idx under @a __code. The caller must have checked
+       *    that no equivalent element is indexed already.
+       * @param __rehash
+       *    Functor returning the hash code of a stored index, used if the
+       *    table has to grow.
+       * @return a pointer to the stored index.
+       */
+      template<typename _Rehash>
+        _Index*
+        _M_insert(std::size_t __code, _Index __idx, _Rehash&& __rehash)
+        {
+          if (_M_growth_left == 0)
+            _M_grow(__rehash);
+
+          const std::size_t __mixed = __hash_mix(__code);
+          const size_type __pos = _M_find_non_full(__mixed);
+          if (_M_ctrl[__pos] == _S_empty)
+            --_M_growth_left;
+          _M_ctrl[__pos] = _S_h2(__mixed);
+          ::new (static_cast<void*>(_M_slots + __pos)) _Index(__idx);
+          ++_M_size;
+          return _M_slots + __pos;
+        }
+
+      /**
+       * @brief _M_erase
+       *    Removes the entry hashed to @a __code whose stored index is
+       *    @a __idx.
+       * @return true if such an entry was found.
+       */
+      template<typename _Rehash>
+        bool
+        _M_erase(std::size_t __code, _Index __idx, _Rehash&&) noexcept
+        {
+          _Index* __slot
+            = _M_find(__code, [__idx](_Index __i) { return __i == __idx; });
+          if (!__slot)
+            return false;
+          _M_erase_slot(__slot - _M_slots);
+          return true;
+        }
+
+      /**
+       * @brief _M_replace
+       *    Rewrites the stored index of the entry hashed to @a __code from
+       *    @a __old to @a __new, e.g. after the inner container moved the
+       *    element.
+       * @return true if such an entry was found.
+       */
+      template<typename _Rehash>
+        bool
+        _M_replace(std::size_t __code, _Index __old, _Index __new
+                 , _Rehash&&) noexcept
+        {
+          _Index* __slot
+            = _M_find(__code, [__old](_Index __i) { return __i == __old; });
+          if (!__slot)
+            return false;
+          *__slot = __new;
+          return true;
+        }
+
+      /**
+       * @brief _M_prefetch
+       *    Starts loading the first group probed for @a __code, control
+       *    bytes and slots, ahead of a batch of lookups.
+       */
+      void
+      _M_prefetch(std::size_t __code) const noexcept
+      {
+        if (_M_capacity == 0)
+          return;
+        const size_type __g = _S_h1(__hash_mix(__code)) & _M_group_mask();
+        __builtin_prefetch(_M_ctrl + __g * _S_group_width);
+        __builtin_prefetch(_M_slots + __g * _S_group_width);
+      }
+
+      /// Count of groups _M_find(@a __code, @a __eq) probes.
+      template<typename _Pred, typename _Rehash>
+        size_type
+        _M_probe_length(std::size_t __code, _Pred&& __eq, _Rehash&&) const
+        {
+          if (_M_capacity == 0)
+            return 0;
+
+          const std::size_t __mixed = __hash_mix(__code);
+          const __ctrl_type __h2 = _S_h2(__mixed);
+          const size_type __gmask = _M_group_mask();
+          size_type __g = _S_h1(__mixed) & __gmask;
+          for (size_type __step = 1;; ++__step)
+            {
+              _Flat_group __grp(_M_ctrl + __g * _S_group_width);
+              for (auto __m = __grp._M_match(__h2); __m; __m._M_pop_lowest())
+                if (__eq(_M_slots[__g * _S_group_width + __m._M_lowest()]))
+                  return __step;
+              if (__grp._M_match_empty())
+                return __step;
+              __g = (__g + __step) & __gmask;
+            }
+        }
+
+      /// Bytes held by the control bytes and the slots.
+      std::size_t
+      _M_allocated_bytes() const noexcept
+      { return _M_capacity * (1 + sizeof(_Index)); }
+
+      // The whole table, control bytes then slots, _M_allocated_bytes()
+      // long. It holds no pointer, so can be written out and used where
+      // it is loaded, through _S_find().
+      const void*
+      _M_data() const noexcept
+      { return _M_ctrl; }
+
+      /// Makes room for @a __n entries without further rebuilding.
+      template<typename _Rehash>
+        void
+        _M_reserve(size_type __n, _Rehash&& __rehash)
+        {
+          const size_type __cap = _S_capacity_for(__n);
+          if (__cap > _M_capacity)
+            _M_rebuild(__cap, __rehash);
+        }
+
+      /// Shrinks the table to the smallest capacity holding its entries.
+      template<typename _Rehash>
+        void
+        _M_shrink_to_fit(_Rehash&& __rehash)
+        {
+          if (_M_size == 0)
+            {
+              _M_deallocate();
+              _M_growth_left = 0;
+              return;
+            }
+          const size_type __cap = _S_capacity_for(_M_size);
+          if (__cap < _M_capacity)
+            _M_rebuild(__cap, __rehash);
+        }
+
+      void
+      _M_clear() noexcept
+      {
+        if (_M_capacity == 0)
+          return;
+        std::memset(_M_ctrl, _S_empty, _M_capacity);
+        _M_size = 0;
+        _M_growth_left = _S_max_size_for(_M_capacity);
+      }
+
+      /// The first empty or deleted slot of the probe sequence of
+      /// @a __mixed, in a table of @a __cap control bytes with room left.
+      static size_type
+      _S_find_non_full(const __ctrl_type* __ctrl, size_type __cap
+                     , std::size_t __mixed) noexcept
+      {
+        const size_type __gmask = __cap / _S_group_width - 1;
+        size_type __g = _S_h1(__mixed) & __gmask;
+        for (size_type __step = 1;; ++__step)
+          {
+            _Flat_group __grp(__ctrl + __g * _S_group_width);
+            if (auto __m = __grp._M_match_empty_or_deleted())
+              return __g * _S_group_width + __m._M_lowest();
+            __g = (__g + __step) & __gmask;
+          }
+      }
+
+      static constexpr size_type
+      _S_max_size_for(size_type __cap) noexcept
+      { return __cap - __cap / 8; }
+
+    private:
+      // Smallest power of two slot count, at least a group, keeping @a __n
+      // entries under the maximum load factor.
+      static constexpr size_type
+      _S_capacity_for(size_type __n) noexcept
+      {
+        size_type __cap = _S_group_width;
+        while (_S_max_size_for(__cap) < __n)
+          __cap <<= 1;
+        return __cap;
+      }
+
+      size_type
+      _M_group_mask() const noexcept
+      { return _M_capacity / _S_group_width - 1; }
+
+      size_type
+      _M_find_non_full(std::size_t __mixed) const noexcept
+      { return _S_find_non_full(_M_ctrl, _M_capacity, __mixed); }
+
+      // A probe only goes past a group which had no empty slot, and a group
+      // never regains an empty slot but through a rebuild.  So a slot in a
+      // group that still has an empty one can go back to empty.
+      void
+      _M_erase_slot(size_type __pos) noexcept
+      {
+        --_M_size;
+        _Flat_group __grp(_M_ctrl + (__pos & ~(_S_group_width - 1)));
+        if (__grp._M_match_empty())
+          {
+            _M_ctrl[__pos] = _S_empty;
+            ++_M_growth_left;
+          }
+        else
+          _M_ctrl[__pos] = _S_deleted;
+      }
+
+      // Tombstones eat into the growth budget: when they make for a good
+      // part of it, rebuilding at the same capacity is enough.
+      template<typename _Rehash>
+        void
+        _M_grow(_Rehash& __rehash)
+        {
+          if (_M_capacity != 0 && _M_size * 32 <= _M_capacity * 25)
+            _M_rebuild(_M_capacity, __rehash);
+          else
+            _M_rebuild(_S_capacity_for(_M_size + 1), __rehash);
+        }
+
+      template<typename _Rehash>
+        void
+        _M_rebuild(size_type __cap, _Rehash& __rehash)
+        {
+          _Flat_index __tmp(get_allocator());
+          __tmp._M_allocate(__cap);
+          for (size_type __pos = 0; __pos < _M_capacity; ++__pos)
+            if (_S_is_full(_M_ctrl[__pos]))
+              {
+                const _Index __idx = _M_slots[__pos];
+                const std::size_t __mixed = __hash_mix(__rehash(__idx));
+                const size_type __to = __tmp._M_find_non_full(__mixed);
+                __tmp._M_ctrl[__to] = _S_h2(__mixed);
+                ::new (static_cast<void*>(__tmp._M_slots + __to)) _Index(__idx);
+              }
+          __tmp._M_size = _M_size;
+          __tmp._M_growth_left -= _M_size;
+          swap(__tmp);
+        }
+
+      // may throw { std::bad_array_new_length, std::bad_alloc }
+      // control bytes and slots share one allocation, the slots start
+      // right after the last control byte.
+      void
+      _M_allocate(size_type __cap)
+      {
+        const size_type __units = __cap / _S_group_width * (1 + sizeof(_Index));
+        __storage_unit* __p =
+          std::__to_address(__unit_alloc_traits::allocate(_M_alloc, __units));
+        _M_ctrl = reinterpret_cast<__ctrl_type*>(__p);
+        _M_slots = reinterpret_cast<_Index*>(_M_ctrl + __cap);
+        _M_capacity = __cap;
+        _M_size = 0;
+        _M_growth_left = _S_max_size_for(__cap);
+        std::memset(_M_ctrl, _S_empty, __cap);
+      }
+
+      void
+      _M_copy_from(const _Flat_index& __othr)
+      {
+        if (__othr._M_capacity == 0)
+          return;
+        _M_allocate(__othr._M_capacity);
+        std::memcpy(_M_ctrl, __othr._M_ctrl, _M_capacity);
+        std::memcpy(_M_slots, __othr._M_slots, _M_capacity * sizeof(_Index));
+        _M_size = __othr._M_size;
+        _M_growth_left = __othr._M_growth_left;
+      }
+
+      void
+      _M_deallocate() noexcept
+      {
+        if (_M_capacity == 0)
+          return;
+        const size_type __units =
+          _M_capacity / _S_group_width * (1 + sizeof(_Index));
+        __unit_alloc_traits::
+          deallocate(_M_alloc, reinterpret_cast<__storage_unit*>(_M_ctrl)
+                     , __units);
+        _M_ctrl = nullptr;
+        _M_slots = nullptr;
+        _M_capacity = 0;
+      }
+    };
+
+  /**
+   *  class _Static_flat_index
+   *
+   *  The open-addressing table of _Flat_index, embedded: @a _Cap control
+   *  bytes and slots, a power of two of at least a group, and no
+   *  allocation ever.  The caller keeps the entries under the maximum
+   *  load, and the table never grows.  When the tombstones have eaten the
+   *  room left, the table is rebuilt in place at the same capacity.
+   *
+   *  The interface is that of _Flat_index, the allocator is accepted and
+   *  ignored.
+   */
+  template<typename _Index, std::size_t _Cap>
+    class _Static_flat_index : _Flat_ctrl
+    {
+      static_assert(std::is_trivially_copyable<_Index>::value
+                    , "flat index slots are copied bytewise");
+      static_assert(_Cap >= _S_group_width && (_Cap & (_Cap - 1)) == 0
+                    , "the capacity is a power of two of at least a group");
+
+      using __table = _Flat_index<_Index>;
+
+    public:
+      using size_type = std::size_t;
+      using index_type = _Index;
+      using allocator_type = std::allocator<_Index>;
+
+    private:
+      alignas(_S_group_width) __ctrl_type _M_ctrl[_Cap];
+      _Index     _M_slots[_Cap] = { };
+      size_type  _M_size = 0;
+      size_type  _M_growth_left = __table::_S_max_size_for(_Cap);
+
+    public:
+      _Static_flat_index() noexcept
+      { std::memset(_M_ctrl, _S_empty, _Cap); }
+
+      template<typename _Alloc>
+        explicit
+        _Static_flat_index(const _Alloc&) noexcept
+        : _Static_flat_index()
+        { }
+
+      _Static_flat_index(const _Static_flat_index&) = default;
+
+      template<typename _Rehash>
+        _Static_flat_index(const _Static_flat_index& __othr, _Rehash&&)
+        : _Static_flat_index(__othr)
+        { }
+
+      template<typename _Rehash, typename _Alloc>
+        _Static_flat_index(const _Static_flat_index& __othr, _Rehash&&
+                         , const _Alloc&)
+        : _Static_flat_index(__othr)
+        { }
+
+      // Nothing to steal, the moved from table is left as it was.
+      _Static_flat_index(_Static_flat_index&&) = default;
+
+      _Static_flat_index&
+      operator=(const _Static_flat_index&) = default;
+
+      template<typename _Rehash>
+        void
+        _M_copy_assign(const _Static_flat_index& __othr, _Rehash&&)
+        { *this = __othr; }
+
+      void
+      swap(_Static_flat_index& __othr) noexcept
+      { std::swap(*this, __othr); }
+
+      size_type
+      size() const noexcept
+      { return _M_size; }
+
+      bool
+      empty() const noexcept
+      { return _M_size == 0; }
+
+      static constexpr size_type
+      bucket_count() noexcept
+      { return _Cap; }
+
+      float
+      load_factor() const noexcept
+      { return float(_M_size) / float(_Cap); }
+
+      static constexpr float
+      max_load_factor() noexcept
+      { return __table::max_load_factor(); }
+
+      // Entries the table holds at most.
+      static constexpr size_type
+      max_size() noexcept
+      { return __table::_S_max_size_for(_Cap); }
+
+      allocator_type
+      get_allocator() const noexcept
+      { return allocator_type(); }
+
+      template<typename _Pred, typename _Rehash>
+        _Index*
+        _M_find(std::size_t __code, _Pred&& __eq, _Rehash&&) const
+        { return _M_find(__code, __eq); }
+
+      template<typename _Pred>
+        _Index*
+        _M_find(std::size_t __code, _Pred&& __eq) const
+        {
+          return __table::_S_find(_M_ctrl
+                                , const_cast<_Index*>(_M_slots), _Cap
+                                , __code, __eq);
+        }
+
+      // The caller has checked that there is room, under max_size().
+      template<typename _Rehash>
+        _Index*
+        _M_insert(std::size_t __code, _Index __idx, _Rehash&& __rehash)
+        {
+          if (_M_growth_left == 0)
+            _M_drop_deleted(__rehash);
+
+          const std::size_t __mixed = __hash_mix(__code);
+          const size_type __pos
+            = __table::_S_find_non_full(_M_ctrl, _Cap, __mixed);
+          if (_M_ctrl[__pos] == _S_empty)
+            --_M_growth_left;
+          _M_ctrl[__pos] = _S_h2(__mixed);
+          _M_slots[__pos] = __idx;
+          ++_M_size;
+          return _M_slots + __pos;
+        }
+
+      template<typename _Rehash>
+        bool
+        _M_erase(std::size_t __code, _Index __idx, _Rehash&&) noexcept
+        {
+          _Index* __slot
+            = _M_find(__code, [__idx](_Index __i) { return __i == __idx; });
+          if (!__slot)
+            return false;
+          _M_erase_slot(__slot - _M_slots);
+          return true;
+        }
+
+      template<typename _Rehash>
+        bool
+        _M_replace(std::size_t __code, _Index __old, _Index __new
+                 , _Rehash&&) noexcept
+        {
+          _Index* __slot
+            = _M_find(__code, [__old](_Index __i) { return __i == __old; });
+          if (!__slot)
+            return false;
+          *__slot = __new;
+          return true;
+        }
+
+      void
+      _M_prefetch(std::size_t __code) const noexcept
+      {
+        const size_type __g
+          = _S_h1(__hash_mix(__code)) & (_Cap / _S_group_width - 1);
+        __builtin_prefetch(_M_ctrl + __g * _S_group_width);
+        __builtin_prefetch(_M_slots + __g * _S_group_width);
+      }
+
+      template<typename _Pred, typename _Rehash>
+        size_type
+        _M_probe_length(std::size_t __code, _Pred&& __eq, _Rehash&&) const
+        {
+          const std::size_t __mixed = __hash_mix(__code);
+          const __ctrl_type __h2 = _S_h2(__mixed);
+          const size_type __gmask = _Cap / _S_group_width - 1;
+          size_type __g = _S_h1(__mixed) & __gmask;
+          for (size_type __step = 1;; ++__step)
+            {
+              _Flat_group __grp(_M_ctrl + __g * _S_group_width);
+              for (auto __m = __grp._M_match(__h2); __m; __m._M_pop_lowest())
+                if (__eq(_M_slots[__g * _S_group_width + __m._M_lowest()]))
+                  return __step;
+              if (__grp._M_match_empty())
+                return __step;
+              __g = (__g + __step) & __gmask;
+            }
+        }
+
+      /// Bytes of the embedded control bytes and slots.
+      static constexpr std::size_t
+      _M_allocated_bytes() noexcept
+      { return _Cap * (1 + sizeof(_Index)); }
+
+      // The capacity is fixed.
+      template<typename _Rehash>
+        void
+        _M_reserve(size_type, _Rehash&&) noexcept
+        { }
+
+      // Only the tombstones can go.
+      template<typename _Rehash>
+        void
+        _M_shrink_to_fit(_Rehash&& __rehash)
+        {
+          if (_M_growth_left + _M_size != max_size())
+            _M_drop_deleted(__rehash);
+        }
+
+      void
+      _M_clear() noexcept
+      {
+        std::memset(_M_ctrl, _S_empty, _Cap);
+        _M_size = 0;
+        _M_growth_left = max_size();
+      }
+
+    private:
+      void
+      _M_erase_slot(size_type __pos) noexcept
+      {
+        --_M_size;
+        _Flat_group __grp(_M_ctrl + (__pos & ~(_S_group_width - 1)));
+        if (__grp._M_match_empty())
+          {
+            _M_ctrl[__pos] = _S_empty;
+            ++_M_growth_left;
+          }
+        else
+          _M_ctrl[__pos] = _S_deleted;
+      }
+
+      /**
+       * @brief _M_drop_deleted
+       *    Rebuilds the table in place, without its tombstones.  The full
+       *    slots are first marked deleted and the deleted ones empty, then
+       *    each entry still marked deleted is placed again: kept if its
+       *    probe sequence reaches its own group first, otherwise moved to
+       *    the first free slot of the sequence, or swapped with the entry
+       *    there when that one has yet to be placed.
+       */
+      template<typename _Rehash>
+        void
+        _M_drop_deleted(_Rehash& __rehash)
+        {
+          for (size_type __pos = 0; __pos != _Cap; ++__pos)
+            _M_ctrl[__pos] = _S_is_full(_M_ctrl[__pos]) ? _S_deleted
+                                                        : _S_empty;
+          for (size_type __pos = 0; __pos != _Cap; ++__pos)
+            {
+              if (_M_ctrl[__pos] != _S_deleted)
+                continue;
+              const std::size_t __mixed = __hash_mix(__rehash(_M_slots[__pos]));
+              const size_type __to
+                = __table::_S_find_non_full(_M_ctrl, _Cap, __mixed);
+              if (__to / _S_group_width == __pos / _S_group_width)
+                _M_ctrl[__pos] = _S_h2(__mixed);
+              else if (_M_ctrl[__to] == _S_empty)
+                {
+                  _M_ctrl[__to] = _S_h2(__mixed);
+                  _M_slots[__to] = _M_slots[__pos];
+                  _M_ctrl[__pos] = _S_empty;
+                }
+              else
+                {
+                  // __to holds an entry not placed yet, looked at next.
+                  _M_ctrl[__to] = _S_h2(__mixed);
+                  std::swap(_M_slots[__to], _M_slots[__pos]);
+                  --__pos;
+                }
+            }
+          _M_growth_left = max_size() - _M_size;
+        }
+    };
+
+  ///@} _ContainerHasher-detail
+} // namespace __detail
+    /// @endcond
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // FLAT_INDEX_H
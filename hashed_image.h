@@ -0,0 +1,486 @@
+// hashed_image.h header -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file hashed_image.h
+ *  This is a Standard C++ Library style header.
+ */
+
+#ifndef HASHED_IMAGE_H
+#define HASHED_IMAGE_H 1
+
+#pragma GCC system_header
+
+#include <cerrno>
+#include <cstdint>           // for std::uint64_t
+#include <cstdio>            // for std::fopen, std::fwrite, std::rename
+#include <cstring>           // for std::memcpy, std::memcmp
+#include <string>
+#include <bits/functexcept.h>     // for std::__throw_system_error
+#include <bits/stl_algobase.h>    // for std::min, std::max
+#include <bits/functional_hash.h> // for std::hash
+#include <bits/stl_function.h>    // for std::equal_to
+#include <fcntl.h>           // for ::open
+#include <sys/mman.h>        // for ::mmap, ::munmap
+#include <sys/stat.h>        // for ::fstat
+#include <unistd.h>          // for ::close
+#include "flat_index.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+    /// @cond undocumented
+
+namespace __detail
+{
+/**
+  *  @addtogroup _ContainerHasher-detail
+  *  @{
+  */
+
+  // Position of an element in an image, as stored by its index.
+  using __image_slot = std::uint64_t;
+
+  /**
+   *  struct _Image_header
+   *
+   *  Start of a file written by __save_hashed_image().  Then come, at the
+   *  offsets it gives, the elements in sequence order and a _Flat_index
+   *  table of their positions.  Nothing in the file is a pointer, so it
+   *  is used where it is mapped.
+   *
+   *  Every field follows from the element type, the element count and
+   *  the index capacity (see __image_layout()), which is how a reader
+   *  checks an image against the type it expects.
+   */
+  struct _Image_header
+  {
+    static constexpr char          _S_magic[8] = "STLHIMG";
+    static constexpr std::uint32_t _S_version = 1;
+    static constexpr std::uint32_t _S_byte_order = 0x01020304;
+
+    char          _M_magic[8];
+    std::uint32_t _M_version;
+    std::uint32_t _M_byte_order;
+    // hash codes are mixed as std::size_t, see __hash_mix()
+    std::uint32_t _M_word_size;
+    std::uint32_t _M_value_align;
+    std::uint64_t _M_value_size;
+    std::uint64_t _M_size;
+    std::uint64_t _M_capacity;
+    // offsets from the start of the file
+    std::uint64_t _M_values;
+    std::uint64_t _M_index;
+    std::uint64_t _M_file_size;
+  };
+
+  constexpr std::uint64_t
+  __image_align(std::uint64_t __off, std::uint64_t __align) noexcept
+  { return (__off + __align - 1) / __align * __align; }
+
+  // The header of an image of __n elements of type _Tp, indexed by a
+  // table of __cap slots.  The elements are at least aligned on a group
+  // of control bytes, and so is the table.
+  template<typename _Tp>
+    _Image_header
+    __image_layout(std::uint64_t __n, std::uint64_t __cap) noexcept
+    {
+      constexpr std::uint64_t __group = _Flat_ctrl::_S_group_width;
+      _Image_header __h = { };
+      std::memcpy(__h._M_magic, _Image_header::_S_magic, sizeof(__h._M_magic));
+      __h._M_version = _Image_header::_S_version;
+      __h._M_byte_order = _Image_header::_S_byte_order;
+      __h._M_word_size = sizeof(std::size_t);
+      __h._M_value_align = alignof(_Tp);
+      __h._M_value_size = sizeof(_Tp);
+      __h._M_size = __n;
+      __h._M_capacity = __cap;
+      __h._M_values = __image_align(sizeof(_Image_header)
+                                  , std::max<std::uint64_t>(alignof(_Tp)
+                                                          , __group));
+      __h._M_index = __image_align(__h._M_values + __n * sizeof(_Tp), __group);
+      __h._M_file_size = __h._M_index + __cap * (1 + sizeof(__image_slot));
+      return __h;
+    }
+
+  // Writes a file under a temporary name, renamed over the target by
+  // _M_commit() only: a process mapping the previous image keeps a whole
+  // file, and a failed save leaves nothing behind.
+  struct _Image_writer
+  {
+    std::string   _M_tmp;
+    std::FILE*    _M_file;
+    std::uint64_t _M_pos = 0;
+
+    explicit
+    _Image_writer(const char* __path)
+    : _M_tmp(std::string(__path) + ".tmp")
+    , _M_file(std::fopen(_M_tmp.c_str(), "wb"))
+    {
+      if (!_M_file)
+        std::__throw_system_error(errno);
+    }
+
+    _Image_writer(const _Image_writer&) = delete;
+    _Image_writer& operator=(const _Image_writer&) = delete;
+
+    ~_Image_writer()
+    {
+      if (_M_file)
+        {
+          std::fclose(_M_file);
+          std::remove(_M_tmp.c_str());
+        }
+    }
+
+    void
+    _M_write(const void* __p, std::size_t __n)
+    {
+      if (std::fwrite(__p, 1, __n, _M_file) != __n)
+        std::__throw_system_error(errno ? errno : EIO);
+      _M_pos += __n;
+    }
+
+    void
+    _M_pad_to(std::uint64_t __off)
+    {
+      static const char __zeros[_Flat_ctrl::_S_group_width * 4] = { };
+      while (_M_pos < __off)
+        _M_write(__zeros, std::min<std::uint64_t>(__off - _M_pos
+                                                , sizeof(__zeros)));
+    }
+
+    void
+    _M_commit(const char* __path)
+    {
+      std::FILE* __f = std::__exchange(_M_file, nullptr);
+      if (std::fclose(__f) != 0 || std::rename(_M_tmp.c_str(), __path) != 0)
+        {
+          const int __err = errno ? errno : EIO;
+          std::remove(_M_tmp.c_str());
+          std::__throw_system_error(__err);
+        }
+    }
+  };
+
+  /**
+   * @brief __save_hashed_image
+   *    Writes the @a __n elements from @a __first, in order, and an index
+   *    of them hashed by @a __hf, to the file @a __path for hashed_image.
+   *    The elements are hashed and written in a single pass.
+   */
+  template<typename _ForwardIterator, typename _Hash>
+    void
+    __save_hashed_image(const char* __path, _ForwardIterator __first
+                      , std::size_t __n, const _Hash& __hf)
+    {
+      using _Tp = typename std::iterator_traits<_ForwardIterator>::value_type;
+      static_assert(std::is_trivially_copyable<_Tp>::value
+                    , "an image holds the bytes of the elements");
+
+      // Reserved ahead, the index is never rebuilt so never rehashes.
+      const auto __no_rehash = [](__image_slot) -> std::size_t
+                               { __builtin_unreachable(); };
+      _Flat_index<__image_slot> __index;
+      __index._M_reserve(__n, __no_rehash);
+      const _Image_header __h = __image_layout<_Tp>(__n, __index.bucket_count());
+
+      _Image_writer __out(__path);
+      __out._M_write(&__h, sizeof(__h));
+      __out._M_pad_to(__h._M_values);
+      for (__image_slot __i = 0; __i != __n; ++__i, ++__first)
+        {
+          const _Tp& __v = *__first;
+          __index._M_insert(__hf(__v), __i, __no_rehash);
+          __out._M_write(std::__addressof(__v), sizeof(_Tp));
+        }
+      __out._M_pad_to(__h._M_index);
+      __out._M_write(__index._M_data(), __index._M_allocated_bytes());
+      __out._M_commit(__path);
+    }
+
+  ///@} _ContainerHasher-detail
+} // namespace __detail
+    /// @endcond
+
+  /**
+   *  @brief A read-only view of a hashed container saved to a file.
+   *
+   *  The file written by hashed_queue::save() or hashed_stack::save() is
+   *  mapped in memory as it is: opening it validates its header and
+   *  nothing else, the pages are read in as lookups and iteration touch
+   *  them.  Iteration follows the order of the saved container.
+   *
+   *  The image holds the bytes of the elements, which must be trivially
+   *  copyable, and the hash codes they had when saved: @a _Hash must give
+   *  the same codes in the reading process.  The header records the size
+   *  and alignment of @a _Value, not its layout.
+   *
+   *  @tparam _Value  Type of the elements.
+   *  @tparam _Hash  Hashing function object type, defaults to
+   *                 hash<_Value>.
+   *  @tparam _Pred  Predicate function object type, defaults
+   *                 to equal_to<_Value>.
+   */
+  template<typename _Value
+          ,typename _Hash = std::hash<_Value>
+          ,typename _Pred = std::equal_to<_Value>>
+    class hashed_image
+    {
+      static_assert(std::is_trivially_copyable<_Value>::value
+                    , "an image holds the bytes of the elements");
+      // The elements are aligned in the file, and the file on a page.
+      static_assert(alignof(_Value) <= 4096
+                    , "elements of an image are at most page aligned");
+
+      using __ctrl_type = __detail::_Flat_ctrl::__ctrl_type;
+      using __slot_type = __detail::__image_slot;
+      using __index_table = __detail::_Flat_index<__slot_type>;
+
+      const void*        _M_map = nullptr;
+      std::size_t        _M_map_size = 0;
+      const _Value*      _M_values = nullptr;
+      const __ctrl_type* _M_ctrl = nullptr;
+      const __slot_type* _M_slots = nullptr;
+      std::size_t        _M_size = 0;
+      std::size_t        _M_capacity = 0;
+      _Hash              _M_hash;
+      _Pred              _M_eq;
+
+    public:
+      using key_type = _Value;
+      using value_type = _Value;
+      using hasher = _Hash;
+      using key_equal = _Pred;
+      using size_type = std::size_t;
+      using difference_type = std::ptrdiff_t;
+      using reference = const value_type&;
+      using const_reference = const value_type&;
+      using iterator = const value_type*;
+      using const_iterator = const value_type*;
+
+      hashed_image() = default;
+
+      /**
+       *  @brief Maps the image saved to the file @a __path.
+       *  @throw std::system_error if the file cannot be mapped, and
+       *  std::runtime_error if it is not an image of _Value elements
+       *  hashed by @a __hf.
+       */
+      explicit
+      hashed_image(const char* __path
+                 , const hasher& __hf = hasher()
+                 , const key_equal& __eql = key_equal())
+      : _M_hash(__hf), _M_eq(__eql)
+      { _M_map_file(__path); }
+
+      hashed_image(const hashed_image&) = delete;
+
+      hashed_image(hashed_image&& __x) noexcept
+      : _M_map(std::__exchange(__x._M_map, nullptr))
+      , _M_map_size(std::__exchange(__x._M_map_size, 0))
+      , _M_values(std::__exchange(__x._M_values, nullptr))
+      , _M_ctrl(std::__exchange(__x._M_ctrl, nullptr))
+      , _M_slots(std::__exchange(__x._M_slots, nullptr))
+      , _M_size(std::__exchange(__x._M_size, 0))
+      , _M_capacity(std::__exchange(__x._M_capacity, 0))
+      , _M_hash(__x._M_hash)
+      , _M_eq(__x._M_eq)
+      { }
+
+      hashed_image&
+      operator=(hashed_image __x) noexcept
+      {
+        swap(__x);
+        return *this;
+      }
+
+      ~hashed_image()
+      {
+        if (_M_map)
+          ::munmap(const_cast<void*>(_M_map), _M_map_size);
+      }
+
+      // iterators, in the order of the saved container
+      const_iterator
+      begin() const noexcept
+      { return _M_values; }
+
+      const_iterator
+      end() const noexcept
+      { return _M_values + _M_size; }
+
+      const_iterator
+      cbegin() const noexcept
+      { return begin(); }
+
+      const_iterator
+      cend() const noexcept
+      { return end(); }
+
+      // capacity
+      bool
+      empty() const noexcept
+      { return _M_size == 0; }
+
+      size_type
+      size() const noexcept
+      { return _M_size; }
+
+      // element access
+      const_reference
+      front() const noexcept
+      { return *begin(); }
+
+      const_reference
+      back() const noexcept
+      { return *(end() - 1); }
+
+      // lookup
+      const_iterator
+      find(const key_type& __k) const
+      {
+        // The stored positions are checked and the probing visits each
+        // group once at most: a damaged file can neither make a lookup
+        // read out of the mapping nor make it loop.
+        const __slot_type* __slot
+          = __index_table::_S_find(_M_ctrl, _M_slots, _M_capacity, _M_hash(__k)
+                                 , [this, &__k](__slot_type __i)
+                                   {
+                                     return __i < _M_size
+                                       && _M_eq(_M_values[__i], __k);
+                                   });
+        return __slot ? _M_values + *__slot : end();
+      }
+
+      size_type
+      count(const key_type& __k) const
+      { return contains(__k) ? 1 : 0; }
+
+      bool
+      contains(const key_type& __k) const
+      { return find(__k) != end(); }
+
+      void
+      swap(hashed_image& __x) noexcept
+      {
+        using std::swap;
+        swap(_M_map, __x._M_map);
+        swap(_M_map_size, __x._M_map_size);
+        swap(_M_values, __x._M_values);
+        swap(_M_ctrl, __x._M_ctrl);
+        swap(_M_slots, __x._M_slots);
+        swap(_M_size, __x._M_size);
+        swap(_M_capacity, __x._M_capacity);
+        swap(_M_hash, __x._M_hash);
+        swap(_M_eq, __x._M_eq);
+      }
+
+      // observers
+      hasher
+      hash_function() const
+      { return _M_hash; }
+
+      key_equal
+      key_eq() const
+      { return _M_eq; }
+
+    private:
+      void
+      _M_map_file(const char* __path)
+      {
+        const int __fd = ::open(__path, O_RDONLY | O_CLOEXEC);
+        if (__fd < 0)
+          std::__throw_system_error(errno);
+        struct ::stat __st;
+        if (::fstat(__fd, &__st) != 0)
+          {
+            const int __err = errno;
+            ::close(__fd);
+            std::__throw_system_error(__err);
+          }
+        const std::size_t __bytes = __st.st_size;
+        if (__bytes < sizeof(__detail::_Image_header))
+          {
+            ::close(__fd);
+            std::__throw_runtime_error("hashed_image: not an image file");
+          }
+        void* __p = ::mmap(nullptr, __bytes, PROT_READ, MAP_PRIVATE, __fd, 0);
+        const int __err = errno;
+        ::close(__fd);
+        if (__p == MAP_FAILED)
+          std::__throw_system_error(__err);
+
+        if (const char* __what = _M_attach(__p, __bytes))
+          {
+            ::munmap(__p, __bytes);
+            std::__throw_runtime_error(__what);
+          }
+      }
+
+      // Points the view into the mapping, or tells why it cannot.
+      const char*
+      _M_attach(const void* __p, std::size_t __bytes)
+      {
+        using __detail::_Image_header;
+        const auto* __base = static_cast<const unsigned char*>(__p);
+        _Image_header __h;
+        std::memcpy(&__h, __base, sizeof(__h));
+
+        // A capacity in range first, the layout is computed from it.
+        const std::uint64_t __cap = __h._M_capacity;
+        if (__cap < __detail::_Flat_ctrl::_S_group_width
+            || (__cap & (__cap - 1)) != 0 || __cap > __bytes
+            || __h._M_size > __cap)
+          return "hashed_image: not an image file";
+        const _Image_header __expected
+          = __detail::__image_layout<_Value>(__h._M_size, __cap);
+        if (std::memcmp(&__h, &__expected, sizeof(__h)) != 0
+            || __expected._M_file_size > __bytes)
+          return "hashed_image: not an image of this element type";
+
+        _M_map = __p;
+        _M_map_size = __bytes;
+        _M_values = reinterpret_cast<const _Value*>(__base + __h._M_values);
+        _M_ctrl = reinterpret_cast<const __ctrl_type*>(__base + __h._M_index);
+        _M_slots = reinterpret_cast<const __slot_type*>(_M_ctrl + __cap);
+        _M_size = __h._M_size;
+        _M_capacity = __cap;
+
+        // One lookup tells a different hash function with high odds.
+        if (_M_size && !contains(_M_values[0]))
+          return "hashed_image: elements not found with this hash function";
+        return nullptr;
+      }
+    };
+
+  template<typename _Value, typename _Hash, typename _Pred>
+    inline void
+    swap(hashed_image<_Value, _Hash, _Pred>& __x
+       , hashed_image<_Value, _Hash, _Pred>& __y) noexcept
+    { __x.swap(__y); }
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // HASHED_IMAGE_H
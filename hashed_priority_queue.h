@@ -0,0 +1,553 @@
+// hashed_priority_queue.h header -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file hashed_priority_queue.h
+ *  This is a Standard C++ Library style header.
+ */
+
+#ifndef HASHED_PRIORITY_QUEUE_H
+#define HASHED_PRIORITY_QUEUE_H 1
+
+#pragma GCC system_header
+
+#include <algorithm>         // for std::min
+#include <vector>
+#include "container_hasher.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+  /**
+   *  @brief A priority queue of unique keys, whose priorities can be
+   *  changed in place.
+   *
+   *  As std::priority_queue, top() is the entry of the greatest priority
+   *  under @a _Compare: std::greater<_Priority> makes it the least, as
+   *  shortest path searches want.  Pushing a key already in fails, and
+   *  the priority of a key is changed in logarithmic time by
+   *  update_priority() or decrease_key(), instead of pushing it again and
+   *  skipping the stale entries when they come out.  The queue thus
+   *  holds one entry a key, whatever the number of updates.
+   *
+   *  The entries are stored in slots, each with its hash code and its
+   *  position in a 4-ary heap whose nodes hold the slot and a copy of the
+   *  priority.  The hash index maps a key to its slot, which does not
+   *  move as the heap is reordered: a sift compares the priorities in
+   *  the heap, rewrites the heap positions of the entries it moves, and
+   *  never touches the index nor calls the hash function.  The slot of
+   *  a popped entry is reused by the next push.
+   *
+   *  @tparam _Key  Type of the keys.
+   *  @tparam _Priority  Type of the priorities, copyable.
+   *  @tparam _Compare  Ordering of the priorities, the greatest on top,
+   *                    defaults to less<_Priority>.
+   *  @tparam _Hash  Hashing function object type, defaults to hash<_Key>.
+   *  @tparam _Pred  Predicate function object type, defaults
+   *                 to equal_to<_Key>.
+   *  @tparam _Alloc  Allocator type, defaults to
+   *                  allocator<pair<_Key, _Priority>>.
+   *  @tparam _IndexPolicy  Lookup structure, node based by default, see
+   *                        __detail::_Flat_index_policy.
+   */
+  template<typename _Key, typename _Priority
+          ,typename _Compare = std::less<_Priority>
+          ,typename _Hash = std::hash<_Key>
+          ,typename _Pred = std::equal_to<_Key>
+          ,typename _Alloc = std::allocator<std::pair<_Key, _Priority>>
+          ,typename _IndexPolicy = __detail::_Chained_index_policy>
+    class hashed_priority_queue
+    {
+      // Entries are addressed as the elements of a random access
+      // container, by their position in _M_slots.
+      using __iterator_tag = std::random_access_iterator_tag;
+      using __handle = __detail::__node_index_t<__iterator_tag>;
+      using __index_table = typename _IndexPolicy::template
+        __index_table<__iterator_tag, _Alloc, _Key, _Hash>;
+
+    public:
+      using key_type = _Key;
+      using priority_type = _Priority;
+      using value_type = std::pair<_Key, _Priority>;
+      using priority_compare = _Compare;
+      using hasher = _Hash;
+      using key_equal = _Pred;
+      using allocator_type = _Alloc;
+      using size_type = std::size_t;
+      using difference_type = std::ptrdiff_t;
+      using const_reference = const value_type&;
+
+    private:
+      struct _Slot
+      {
+        value_type  _M_v;
+        std::size_t _M_code;
+        __handle    _M_pos;      // in _M_heap
+      };
+
+      // A heap node carries a copy of the priority of its entry, which
+      // the sifts compare without leaving the heap.
+      struct _Node
+      {
+        _Priority _M_p;
+        __handle  _M_h;
+      };
+
+      using _Slot_alloc = std::__alloc_rebind<_Alloc, _Slot>;
+      using _Heap_alloc = std::__alloc_rebind<_Alloc, _Node>;
+      using _Free_alloc = std::__alloc_rebind<_Alloc, __handle>;
+
+      // Children of a heap node: siblings are adjacent, mostly in one
+      // cache line, and the heap is half as deep as a binary one.
+      static constexpr size_type _S_arity = 4;
+
+      std::vector<_Slot, _Slot_alloc>     _M_slots;
+      std::vector<_Node, _Heap_alloc>     _M_heap;
+      std::vector<__handle, _Free_alloc>  _M_free;      // erased slots
+      __index_table                       _M_index;
+      _Compare                            _M_comp;
+      _Hash                               _M_hash;
+      _Pred                               _M_eq;
+
+    public:
+      hashed_priority_queue()
+      : hashed_priority_queue(_Compare())
+      { }
+
+      /**
+       * @brief Builds an empty queue.
+       * @param __comp  Ordering of the priorities.
+       * @param __a  Allocator of the entries, of the heap and of the index.
+       */
+      explicit
+      hashed_priority_queue(const _Compare& __comp
+                          , const hasher& __hf = hasher()
+                          , const key_equal& __eql = key_equal()
+                          , const allocator_type& __a = allocator_type())
+      : _M_slots(_Slot_alloc(__a)), _M_heap(_Heap_alloc(__a))
+      , _M_free(_Free_alloc(__a)), _M_index(__a)
+      , _M_comp(__comp), _M_hash(__hf), _M_eq(__eql)
+      { }
+
+      explicit
+      hashed_priority_queue(const allocator_type& __a)
+      : hashed_priority_queue(_Compare(), hasher(), key_equal(), __a)
+      { }
+
+      // Pushes the entries of [__first, __last) whose key is not in yet.
+      template<typename _InputIterator>
+        hashed_priority_queue(_InputIterator __first, _InputIterator __last
+                            , const _Compare& __comp = _Compare()
+                            , const hasher& __hf = hasher()
+                            , const key_equal& __eql = key_equal()
+                            , const allocator_type& __a = allocator_type())
+        : hashed_priority_queue(__comp, __hf, __eql, __a)
+        {
+          for (; __first != __last; ++__first)
+            push(*__first);
+        }
+
+      hashed_priority_queue(std::initializer_list<value_type> __l
+                          , const _Compare& __comp = _Compare()
+                          , const hasher& __hf = hasher()
+                          , const key_equal& __eql = key_equal()
+                          , const allocator_type& __a = allocator_type())
+      : hashed_priority_queue(__l.begin(), __l.end(), __comp, __hf, __eql
+                            , __a)
+      { }
+
+      hashed_priority_queue(const hashed_priority_queue& __x)
+      : _M_slots(__x._M_slots), _M_heap(__x._M_heap), _M_free(__x._M_free)
+      , _M_index(__x._M_index, __x._M_rehasher())
+      , _M_comp(__x._M_comp), _M_hash(__x._M_hash), _M_eq(__x._M_eq)
+      { _M_free.reserve(_M_slots.capacity()); }
+
+      hashed_priority_queue(hashed_priority_queue&&) = default;
+
+      hashed_priority_queue&
+      operator=(const hashed_priority_queue& __x)
+      {
+        if (this != std::__addressof(__x))
+          {
+            hashed_priority_queue __tmp(__x);
+            swap(__tmp);
+          }
+        return *this;
+      }
+
+      hashed_priority_queue&
+      operator=(hashed_priority_queue&& __x) noexcept
+      {
+        hashed_priority_queue __tmp(std::move(__x));
+        swap(__tmp);
+        return *this;
+      }
+
+      // capacity
+      [[__nodiscard__]] bool
+      empty() const noexcept
+      { return _M_heap.empty(); }
+
+      size_type
+      size() const noexcept
+      { return _M_heap.size(); }
+
+      /// Makes room for @a __n entries, without reallocation nor rehash.
+      void
+      reserve(size_type __n)
+      {
+        _M_slots.reserve(__n);
+        _M_free.reserve(_M_slots.capacity());
+        _M_heap.reserve(__n);
+        _M_index._M_reserve(__n, _M_rehasher());
+      }
+
+      // element access
+
+      /// The entry of the greatest priority.
+      const_reference
+      top() const noexcept
+      {
+        __glibcxx_assert(!empty());
+        return _M_slots[_M_heap.front()._M_h]._M_v;
+      }
+
+      // modifiers
+
+      /**
+       * @brief push
+       *    Inserts the entry @a __x, unless its key is in already.
+       * @return true if @a __x was inserted.
+       */
+      bool
+      push(const value_type& __x)
+      { return _M_push(value_type(__x)); }
+
+      bool
+      push(value_type&& __x)
+      { return _M_push(std::move(__x)); }
+
+      bool
+      push(const key_type& __k, const priority_type& __p)
+      { return _M_push(value_type(__k, __p)); }
+
+      template<typename... _Args>
+        bool
+        emplace(_Args&&... __args)
+        { return _M_push(value_type(std::forward<_Args>(__args)...)); }
+
+      /// Removes the entry of the greatest priority.
+      void
+      pop()
+      {
+        __glibcxx_assert(!empty());
+        _M_erase_at(0);
+      }
+
+      /**
+       * @brief update_priority
+       *    Sets the priority of @a __k to @a __p, moving its entry up or
+       *    down the heap.
+       * @return false if @a __k is not in the queue.
+       */
+      bool
+      update_priority(const key_type& __k, priority_type __p)
+      {
+        const __handle* __h = _M_find_slot(__k, _M_hash(__k));
+        if (!__h)
+          return false;
+        _Slot& __s = _M_slots[*__h];
+        __s._M_v.second = std::move(__p);
+        _M_heap[__s._M_pos]._M_p = __s._M_v.second;
+        _M_restore(__s._M_pos);
+        return true;
+      }
+
+      /**
+       * @brief decrease_key
+       *    Moves the entry of @a __k up the heap to the priority @a __p, if
+       *    @a __p ranks above its current priority: a decrease under
+       *    std::greater, the ordering of shortest path searches.
+       * @return true if the priority of @a __k was changed, false if @a __k
+       *         is not in the queue or @a __p does not rank above.
+       */
+      bool
+      decrease_key(const key_type& __k, priority_type __p)
+      {
+        const __handle* __h = _M_find_slot(__k, _M_hash(__k));
+        if (!__h)
+          return false;
+        _Slot& __s = _M_slots[*__h];
+        if (!_M_comp(__s._M_v.second, __p))
+          return false;
+        __s._M_v.second = std::move(__p);
+        _M_heap[__s._M_pos]._M_p = __s._M_v.second;
+        _M_sift_up(__s._M_pos);
+        return true;
+      }
+
+      size_type
+      erase(const key_type& __k)
+      {
+        const __handle* __h = _M_find_slot(__k, _M_hash(__k));
+        if (!__h)
+          return 0;
+        _M_erase_at(_M_slots[*__h]._M_pos);
+        return 1;
+      }
+
+      void
+      clear() noexcept
+      {
+        _M_index._M_clear();
+        _M_heap.clear();
+        _M_slots.clear();
+        _M_free.clear();
+      }
+
+      void
+      swap(hashed_priority_queue& __x) noexcept
+      {
+        using std::swap;
+        _M_slots.swap(__x._M_slots);
+        _M_heap.swap(__x._M_heap);
+        _M_free.swap(__x._M_free);
+        _M_index.swap(__x._M_index);
+        swap(_M_comp, __x._M_comp);
+        swap(_M_hash, __x._M_hash);
+        swap(_M_eq, __x._M_eq);
+      }
+
+      // lookup
+      bool
+      contains(const key_type& __k) const
+      { return _M_find_slot(__k, _M_hash(__k)) != nullptr; }
+
+      size_type
+      count(const key_type& __k) const
+      { return contains(__k); }
+
+      /// The priority of @a __k, or nullptr if @a __k is not in the queue.
+      const priority_type*
+      priority(const key_type& __k) const
+      {
+        const __handle* __h = _M_find_slot(__k, _M_hash(__k));
+        return __h ? std::__addressof(_M_slots[*__h]._M_v.second) : nullptr;
+      }
+
+      // observers
+      priority_compare
+      priority_comp() const
+      { return _M_comp; }
+
+      hasher
+      hash_function() const
+      { return _M_hash; }
+
+      key_equal
+      key_eq() const
+      { return _M_eq; }
+
+      allocator_type
+      get_allocator() const noexcept
+      { return allocator_type(_M_slots.get_allocator()); }
+
+    private:
+      // hash code of the entry at a handle, for the index rebuilds
+      auto
+      _M_rehasher() const noexcept
+      {
+        return [this](__handle __h) { return _M_slots[__h]._M_code; };
+      }
+
+      const __handle*
+      _M_find_slot(const key_type& __k, std::size_t __code) const
+      {
+        auto __eq = [this, &__k](__handle __h)
+                    { return _M_eq(_M_slots[__h]._M_v.first, __k); };
+        return _M_index._M_find(__code, __eq, _M_rehasher());
+      }
+
+      const priority_type&
+      _M_priority_at(size_type __pos) const noexcept
+      { return _M_heap[__pos]._M_p; }
+
+      // Puts the node __n at __pos of the heap, and tells its entry so.
+      void
+      _M_place(_Node&& __n, size_type __pos)
+      {
+        _M_slots[__n._M_h]._M_pos = __pos;
+        _M_heap[__pos] = std::move(__n);
+      }
+
+      bool
+      _M_push(value_type&& __x)
+      {
+        const std::size_t __code = _M_hash(__x.first);
+        if (_M_find_slot(__x.first, __code))
+          return false;
+
+        const size_type __pos = _M_heap.size();
+        _M_heap.push_back(_Node{ __x.second, __handle() });
+        const bool __reuse = !_M_free.empty();
+        bool __taken = false;
+        __handle __h;
+        __try
+          {
+            if (__reuse)
+              {
+                __h = _M_free.back();
+                _M_slots[__h] = _Slot{ std::move(__x), __code, __pos };
+                _M_free.pop_back();
+                __taken = true;
+              }
+            else
+              {
+                __h = _M_slots.size();
+                _M_slots.push_back(_Slot{ std::move(__x), __code, __pos });
+                __taken = true;
+                // room for every handle, so that erasing never allocates
+                if (_M_free.capacity() < _M_slots.capacity())
+                  _M_free.reserve(_M_slots.capacity());
+              }
+            _M_heap.back()._M_h = __h;
+            _M_index._M_insert(__code, __h, _M_rehasher());
+          }
+        __catch(...)
+          {
+            _M_heap.pop_back();
+            if (__taken)
+              {
+                if (__reuse)
+                  _M_free.push_back(__h);
+                else
+                  _M_slots.pop_back();
+              }
+            __throw_exception_again;
+          }
+        _M_sift_up(__pos);
+        return true;
+      }
+
+      // The entry at __pos moves up past the entries ranking below it,
+      // each of them moving down to the hole it leaves.
+      void
+      _M_sift_up(size_type __pos)
+      {
+        _Node __n = std::move(_M_heap[__pos]);
+        while (__pos != 0)
+          {
+            const size_type __parent = (__pos - 1) / _S_arity;
+            if (!_M_comp(_M_priority_at(__parent), __n._M_p))
+              break;
+            _M_place(std::move(_M_heap[__parent]), __pos);
+            __pos = __parent;
+          }
+        _M_place(std::move(__n), __pos);
+      }
+
+      // The entry at __pos moves down, its greatest child up, until no
+      // child ranks above it.
+      void
+      _M_sift_down(size_type __pos)
+      {
+        _Node __n = std::move(_M_heap[__pos]);
+        const size_type __size = _M_heap.size();
+        for (;;)
+          {
+            size_type __child = __pos * _S_arity + 1;
+            if (__child >= __size)
+              break;
+            const size_type __last = std::min(__child + _S_arity, __size);
+            size_type __best = __child;
+            for (++__child; __child < __last; ++__child)
+              if (_M_comp(_M_priority_at(__best), _M_priority_at(__child)))
+                __best = __child;
+            if (!_M_comp(__n._M_p, _M_priority_at(__best)))
+              break;
+            _M_place(std::move(_M_heap[__best]), __pos);
+            __pos = __best;
+          }
+        _M_place(std::move(__n), __pos);
+      }
+
+      // Reorders the heap around the entry at __pos, whose priority
+      // changed either way.
+      void
+      _M_restore(size_type __pos)
+      {
+        if (__pos != 0
+            && _M_comp(_M_priority_at((__pos - 1) / _S_arity)
+                     , _M_priority_at(__pos)))
+          _M_sift_up(__pos);
+        else
+          _M_sift_down(__pos);
+      }
+
+      // Removes the entry at __pos of the heap, the last node of the heap
+      // taking its place, then unindexes the entry and frees its slot.
+      // The key and the priority are moved out of the slot into a
+      // temporary and released with it: a free slot holds moved-from
+      // values only, until reused.
+      void
+      _M_erase_at(size_type __pos)
+      {
+        const __handle __h = _M_heap[__pos]._M_h;
+        _Node __moved = std::move(_M_heap.back());
+        _M_heap.pop_back();
+        if (__pos != _M_heap.size())
+          {
+            _M_place(std::move(__moved), __pos);
+            _M_restore(__pos);
+          }
+
+        _M_index._M_erase(_M_slots[__h]._M_code, __h, _M_rehasher());
+        if (_M_heap.empty())
+          {
+            _M_slots.clear();
+            _M_free.clear();
+          }
+        else
+          {
+            _M_free.push_back(__h);
+            value_type __released(std::move(_M_slots[__h]._M_v));
+          }
+      }
+    };
+
+  template<typename _Key, typename _Priority, typename _Compare
+          ,typename _Hash, typename _Pred, typename _Alloc
+          ,typename _IndexPolicy>
+    inline void
+    swap(hashed_priority_queue<_Key, _Priority, _Compare, _Hash, _Pred
+                             , _Alloc, _IndexPolicy>& __x
+       , hashed_priority_queue<_Key, _Priority, _Compare, _Hash, _Pred
+                             , _Alloc, _IndexPolicy>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // HASHED_PRIORITY_QUEUE_H
@@ -0,0 +1,425 @@
+// hashed_stack.h header -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file hashed_stack.h
+ *  This is a Standard C++ Library style header.
+ */
+
+#ifndef HASHED_STACK_H
+#define HASHED_STACK_H 1
+
+#pragma GCC system_header
+
+#include <memory_resource>   // for std::pmr::polymorphic_allocator
+#include "container_hasher.h"
+#include "segmented_revolver.h"
+#include "hashed_image.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+  /**
+   *  @brief A LIFO container of unique elements.
+   *
+   *  push() stacks an element unless an equivalent one is already stacked,
+   *  pop() removes the newest element, both in constant time. Lookup is
+   *  constant time on average, and an element can be extracted from the
+   *  middle of the stack without disturbing the order of the others.
+   *
+   *  Iteration visits the elements in push order, bottom of the stack
+   *  first.
+   *
+   *  @tparam _Value  Type of the elements.
+   *  @tparam _Hash  Hashing function object type, defaults to
+   *                 hash<_Value>.
+   *  @tparam _Pred  Predicate function object type, defaults
+   *                 to equal_to<_Value>.
+   *  @tparam _Alloc  Allocator type, defaults to allocator<_Value>.
+   *  @tparam _IndexPolicy  Lookup structure, node based by default, see
+   *                        __detail::_Flat_index_policy, and
+   *                        __detail::_Recording_index_policy to record
+   *                        statistics.
+   *  @tparam _Nm  Elements held without allocating, a power of two, none
+   *               by default. A table of that many elements or less is
+   *               not indexed either.
+   *  @tparam _Sequence  Inner container, revolver<_Value, _Alloc, _Nm> by
+   *                     default, see segmented_revolver for very large
+   *                     tables.
+   */
+  template<typename _Value
+          ,typename _Hash = std::hash<_Value>
+          ,typename _Pred = std::equal_to<_Value>
+          ,typename _Alloc = std::allocator<_Value>
+          ,typename _IndexPolicy = __detail::_Chained_index_policy
+          ,std::size_t _Nm = 0
+          ,typename _Sequence = revolver<_Value, _Alloc, _Nm>>
+    class hashed_stack
+    {
+      using _Hashtable = _ContainerHasher<_Value, _Alloc, _Value, _Sequence
+                                        , _Hash, _Pred
+                                        , _IndexPolicy>;
+      _Hashtable _M_h;
+
+    public:
+      using key_type = typename _Hashtable::key_type;
+      using value_type = typename _Hashtable::value_type;
+      using hasher = typename _Hashtable::hasher;
+      using key_equal = typename _Hashtable::key_equal;
+      using allocator_type = typename _Hashtable::allocator_type;
+      using container_type = typename _Hashtable::container_type;
+      using size_type = typename _Hashtable::size_type;
+      using difference_type = typename _Hashtable::difference_type;
+      using reference = typename _Hashtable::reference;
+      using const_reference = typename _Hashtable::const_reference;
+      using iterator = typename _Hashtable::iterator;
+      using const_iterator = typename _Hashtable::const_iterator;
+
+      hashed_stack() = default;
+
+      explicit
+      hashed_stack(size_type __n
+                 , const hasher& __hf = hasher()
+                 , const key_equal& __eql = key_equal()
+                 , const allocator_type& __a = allocator_type())
+      : _M_h(__n, __hf, __eql, __a)
+      { }
+
+      template<typename _InputIterator>
+        hashed_stack(_InputIterator __first, _InputIterator __last
+                   , size_type __n = 0
+                   , const hasher& __hf = hasher()
+                   , const key_equal& __eql = key_equal()
+                   , const allocator_type& __a = allocator_type())
+        : _M_h(__first, __last, __n, __hf, __eql, __a)
+        { }
+
+      // With std::execution::par, hashes and deduplicates the elements on
+      // all the cores, keeping the first of equivalent ones.
+      template<typename _ExecutionPolicy, typename _ForwardIterator
+              ,typename = std::enable_if_t<
+                 __detail::__is_execution_policy<_ExecutionPolicy>::value>>
+        hashed_stack(_ExecutionPolicy&& __policy
+                   , _ForwardIterator __first, _ForwardIterator __last
+                   , size_type __n = 0
+                   , const hasher& __hf = hasher()
+                   , const key_equal& __eql = key_equal()
+                   , const allocator_type& __a = allocator_type())
+        : _M_h(std::forward<_ExecutionPolicy>(__policy), __first, __last
+             , __n, __hf, __eql, __a)
+        { }
+
+      hashed_stack(std::initializer_list<value_type> __l
+                 , size_type __n = 0
+                 , const hasher& __hf = hasher()
+                 , const key_equal& __eql = key_equal()
+                 , const allocator_type& __a = allocator_type())
+      : _M_h(__l, __n, __hf, __eql, __a)
+      { }
+
+      hashed_stack(const hashed_stack&) = default;
+      hashed_stack(hashed_stack&&) = default;
+
+      // Every allocation of the container, elements, index nodes and
+      // buckets, goes through a copy of @a __a.
+      explicit
+      hashed_stack(const allocator_type& __a)
+      : _M_h(__a)
+      { }
+
+      hashed_stack(size_type __n, const allocator_type& __a)
+      : hashed_stack(__n, hasher(), key_equal(), __a)
+      { }
+
+      hashed_stack(size_type __n, const hasher& __hf
+                 , const allocator_type& __a)
+      : hashed_stack(__n, __hf, key_equal(), __a)
+      { }
+
+      hashed_stack(const hashed_stack& __x, const allocator_type& __a)
+      : _M_h(__x._M_h, __a)
+      { }
+
+      hashed_stack(hashed_stack&& __x, const allocator_type& __a)
+      : _M_h(std::move(__x._M_h), __a)
+      { }
+
+      hashed_stack&
+      operator=(const hashed_stack&) = default;
+
+      hashed_stack&
+      operator=(hashed_stack&&) = default;
+
+      // iterators, bottom of the stack first
+      const_iterator
+      begin() const
+      { return _M_h.begin(); }
+
+      const_iterator
+      end() const noexcept
+      { return _M_h.end(); }
+
+      const_iterator
+      cbegin() const
+      { return _M_h.begin(); }
+
+      const_iterator
+      cend() const noexcept
+      { return _M_h.end(); }
+
+      // capacity
+      [[__nodiscard__]] bool
+      empty() const noexcept
+      { return _M_h.empty(); }
+
+      size_type
+      size() const noexcept
+      { return _M_h.size(); }
+
+      // element access
+      const_reference
+      top() const noexcept
+      { return _M_h.back(); }
+
+      // modifiers
+      std::pair<iterator, bool>
+      push(const value_type& __x)
+      { return _M_h.push_back(__x); }
+
+      std::pair<iterator, bool>
+      push(value_type&& __x)
+      { return _M_h.push_back(std::move(__x)); }
+
+      template<typename... _Args>
+        std::pair<iterator, bool>
+        emplace(_Args&&... __args)
+        { return _M_h.emplace_back(std::forward<_Args>(__args)...); }
+
+      // Pushes the elements of [__first, __last) not already in, in order,
+      // hashing them by blocks. Returns the number pushed.
+      template<typename _InputIterator>
+        size_type
+        push_range(_InputIterator __first, _InputIterator __last)
+        { return _M_h.push_range(__first, __last); }
+
+      void
+      pop()
+      { _M_h.pop_back(); }
+
+      // Pops up to __n elements to __out, top first.
+      template<typename _OutputIterator>
+        _OutputIterator
+        pop_n(size_type __n, _OutputIterator __out)
+        { return _M_h.pop_back_n(__n, __out); }
+
+      std::optional<value_type>
+      extract(const key_type& __x)
+      { return _M_h.extract(__x); }
+
+      template<typename _Kt>
+        auto
+        extract(const _Kt& __x)
+        -> decltype(_M_h.extract(__x))
+        { return _M_h.extract(__x); }
+
+      size_type
+      erase(const key_type& __x)
+      { return _M_h.erase(__x); }
+
+      template<typename _Kt>
+        auto
+        erase(const _Kt& __x)
+        -> decltype(_M_h.erase(__x))
+        { return _M_h.erase(__x); }
+
+      void
+      clear() noexcept
+      { _M_h.clear(); }
+
+      void
+      swap(hashed_stack& __x) noexcept(noexcept(_M_h.swap(__x._M_h)))
+      { _M_h.swap(__x._M_h); }
+
+      // lookup
+      const_iterator
+      find(const key_type& __x) const
+      { return _M_h.find(__x); }
+
+      size_type
+      count(const key_type& __x) const
+      { return _M_h.count(__x); }
+
+      bool
+      contains(const key_type& __x) const
+      { return _M_h.contains(__x); }
+
+      // Heterogeneous lookup, with transparent hash and key equality types.
+      template<typename _Kt>
+        auto
+        find(const _Kt& __x) const
+        -> decltype(_M_h.find(__x))
+        { return _M_h.find(__x); }
+
+      template<typename _Kt>
+        auto
+        count(const _Kt& __x) const
+        -> decltype(_M_h.count(__x))
+        { return _M_h.count(__x); }
+
+      template<typename _Kt>
+        auto
+        contains(const _Kt& __x) const
+        -> decltype(_M_h.contains(__x))
+        { return _M_h.contains(__x); }
+
+      // Writes whether each key of [__first, __last) is in, to __out.
+      template<typename _ForwardIterator, typename _OutputIterator>
+        _OutputIterator
+        contains_batch(_ForwardIterator __first, _ForwardIterator __last
+                     , _OutputIterator __out) const
+        { return _M_h.contains_batch(__first, __last, __out); }
+
+      // traversal, bottom of the stack first
+      // Part __k of the elements cut in __parts runs, for a thread each.
+      std::pair<const_iterator, const_iterator>
+      chunk(size_type __k, size_type __parts) const
+      { return _M_h.chunk(__k, __parts); }
+
+      // With std::execution::par, on all the cores, a chunk a thread.
+      template<typename _ExecutionPolicy, typename _Function>
+        auto
+        for_each(_ExecutionPolicy&& __policy, _Function __f) const
+        -> decltype(_M_h.for_each(std::forward<_ExecutionPolicy>(__policy)
+                                , std::move(__f)))
+        {
+          _M_h.for_each(std::forward<_ExecutionPolicy>(__policy)
+                      , std::move(__f));
+        }
+
+      // The results of the chunks are combined in order: __reduce need
+      // only be associative.
+      template<typename _ExecutionPolicy, typename _Res
+              ,typename _BinaryOperation, typename _UnaryOperation>
+        auto
+        transform_reduce(_ExecutionPolicy&& __policy, _Res __init
+                       , _BinaryOperation __reduce
+                       , _UnaryOperation __transform) const
+        -> decltype(_M_h.transform_reduce(
+                      std::forward<_ExecutionPolicy>(__policy)
+                    , std::move(__init), std::move(__reduce)
+                    , std::move(__transform)))
+        {
+          return _M_h.transform_reduce(std::forward<_ExecutionPolicy>(__policy)
+                                     , std::move(__init), std::move(__reduce)
+                                     , std::move(__transform));
+        }
+
+      // hash policy
+      size_type
+      bucket_count() const noexcept
+      { return _M_h.bucket_count(); }
+
+      float
+      load_factor() const noexcept
+      { return _M_h.load_factor(); }
+
+      float
+      max_load_factor() const noexcept
+      { return _M_h.max_load_factor(); }
+
+      void
+      reserve(size_type __n)
+      { _M_h.reserve(__n); }
+
+      void
+      shrink_to_fit()
+      { _M_h.shrink_to_fit(); }
+
+      // With __detail::_Recording_index_policy only.
+      hashed_stats
+      stats() const noexcept
+      { return _M_h.stats(); }
+
+      // observers
+      allocator_type
+      get_allocator() const noexcept
+      { return _M_h.get_allocator(); }
+
+      hasher
+      hash_function() const
+      { return _M_h.hash_function(); }
+
+      key_equal
+      key_eq() const
+      { return _M_h.key_eq(); }
+
+      /**
+       * @brief save
+       *    Writes the elements, bottom of the stack first, and an index
+       *    of them to the file @a __path, for open_mapped().  The file is
+       *    replaced at once: a process still mapping the previous one
+       *    keeps reading it.  The elements must be trivially copyable.
+       */
+      void
+      save(const char* __path) const
+      {
+        __detail::__save_hashed_image(__path, begin(), size()
+                                    , hash_function());
+      }
+
+      // Maps the file written by save(), see hashed_image.
+      static hashed_image<_Value, _Hash, _Pred>
+      open_mapped(const char* __path
+                , const hasher& __hf = hasher()
+                , const key_equal& __eql = key_equal())
+      { return hashed_image<_Value, _Hash, _Pred>(__path, __hf, __eql); }
+    };
+
+  template<typename _Value, typename _Hash, typename _Pred, typename _Alloc
+          ,typename _IndexPolicy, std::size_t _Nm, typename _Sequence>
+    inline void
+    swap(hashed_stack<_Value, _Hash, _Pred, _Alloc, _IndexPolicy, _Nm
+                    , _Sequence>& __x
+       , hashed_stack<_Value, _Hash, _Pred, _Alloc, _IndexPolicy, _Nm
+                    , _Sequence>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+  namespace pmr
+  {
+    template<typename _Value
+            ,typename _Hash = std::hash<_Value>
+            ,typename _Pred = std::equal_to<_Value>
+            ,typename _IndexPolicy = __detail::_Chained_index_policy
+            ,std::size_t _Nm = 0>
+      using hashed_stack
+        = stl::hashed_stack<_Value, _Hash, _Pred
+                           , std::pmr::polymorphic_allocator<_Value>
+                           , _IndexPolicy, _Nm>;
+  } // namespace pmr
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // HASHED_STACK_H
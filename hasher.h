@@ -34,11 +34,14 @@
 #include <bits/functional_hash.h> // for __is_fast_hash
 #include <bits/stl_algobase.h>	  // for std::min, std::is_permutation.
 #include <bits/stl_pair.h>	      // for std::pair
+#include <bits/stl_function.h>    // for std::equal_to
 #include <ext/aligned_buffer.h>	  // for __gnu_cxx::__aligned_buffer
 #include <ext/alloc_traits.h>	  // for std::__alloc_rebind
 #include <ext/numeric_traits.h>	  // for __gnu_cxx::__int_traits
 #include <limits>                 // for std::numeric_limits
 #include <cstdint>                // for std::uintptr_t
+#include "flat_index.h"           // for __detail::_Flat_index
+#include "container_stats.h"      // for hashed_stats
 
 namespace std
 {
@@ -58,12 +61,40 @@ _GLIBCXX_BEGIN_NAMESPACE_VERSION
     /// @cond undocumented
 
   // default container forward declaration
-  template<typename _Tp, typename _Allocator = std::allocator<_Tp>>
+  template<typename _Tp, typename _Allocator = std::allocator<_Tp>
+         , std::size_t _Nm = 0>
     class revolver;
 
+namespace __detail
+{
+  // Elements of a segment of segmented_revolver by default: as many as
+  // fill 4 KiB, a power of two, at least 16.
+  constexpr std::size_t
+  __segment_size(std::size_t __elt_size) noexcept
+  {
+    std::size_t __n = 16;
+    while (__n * 2 * __elt_size <= 4096)
+      __n *= 2;
+    return __n;
+  }
+} // namespace __detail
+
+  template<typename _Tp, typename _Allocator = std::allocator<_Tp>
+         , std::size_t _Seg = __detail::__segment_size(sizeof(_Tp))>
+    class segmented_revolver;
+
+namespace __detail
+{
+  // index policies forward declaration
+  struct _Chained_index_policy;
+  struct _Flat_index_policy;
+}
+
   template<typename _Tp, typename _Alloc, typename _Key = _Tp
           ,typename _Container = stl::revolver<_Tp>
-          ,typename _Hash = std::hash<_Key>>
+          ,typename _Hash = std::hash<_Key>
+          ,typename _Equal = std::equal_to<_Key>
+          ,typename _IndexPolicy = __detail::_Chained_index_policy>
     class _ContainerHasher;
 
 namespace __detail
@@ -100,6 +131,10 @@ namespace __detail
       struct __1st_type<std::pair<_Tp, _Up>>
       { using __key_type = typename __1st_type<std::tuple<_Tp,_Up>>::__key_type; };
 
+    template<typename _Tp, typename _Up>
+      struct __1st_type<const std::pair<_Tp, _Up>>
+      { using __key_type = typename __1st_type<const std::tuple<_Tp,_Up>>::__key_type; };
+
     template<typename _Tp>
       constexpr
       typename __1st_type<_Tp>::__key_type&&
@@ -206,6 +241,15 @@ namespace __detail
       { return std::__is_fast_hash<_Hash>::value ? 0 : 20; }
     };
 
+  // Whether the nodes of the chained index cache the hash code of their
+  // element by default: unless hashing is cheap and cannot throw, as for
+  // the __cache_default of the unordered containers.
+  template<typename _Key, typename _Hash>
+    using __cache_default
+      = std::__not_<std::__and_<std::__is_fast_hash<_Hash>
+                              , std::__is_nothrow_invocable<const _Hash&
+                                                          , const _Key&>>>;
+
     /**
     *  struct _Hash_node_base
     *
@@ -231,7 +275,6 @@ namespace __detail
     struct _Hash_node_index_base
     {
         using __random_iterator = std::false_type;
-        std::size_t    _M_hash_code;
         std::uintptr_t _M_index;
     };
 
@@ -239,10 +282,30 @@ namespace __detail
     struct _Hash_node_index_base<std::random_access_iterator_tag>
     {
         using __random_iterator = std::true_type;
-        std::size_t _M_hash_code;
         std::size_t _M_index;
     };
 
+    /**
+    *  struct _Hash_node_code_cache
+    *
+    *  The hash code of the element, when the node caches it.  Without it
+    *  the index hashes the element again whenever it needs its bucket.
+    */
+  template<bool _Cache_hash_code>
+    struct _Hash_node_code_cache
+    {
+      _Hash_node_code_cache(std::size_t) noexcept { }
+    };
+
+  template<>
+    struct _Hash_node_code_cache<true>
+    {
+      std::size_t _M_hash_code;
+
+      _Hash_node_code_cache(std::size_t __hash_code) noexcept
+        : _M_hash_code(__hash_code) { }
+    };
+
   template<typename _Node_index_base>
     struct
       alignas(sizeof(_Node_index_base))
@@ -269,21 +332,46 @@ namespace __detail
   /**
    *  Primary template struct _Hash_node.
    */
-  template<typename _Iterator_tag>
+  template<typename _Iterator_tag, bool _Cache_hash_code>
     struct _Hash_node
       : _Hash_node_base
       , _Hash_node_index_base<_Iterator_tag>
+      , _Hash_node_code_cache<_Cache_hash_code>
     {
+      using __index_base = _Hash_node_index_base<_Iterator_tag>;
+      using __code_cache = _Hash_node_code_cache<_Cache_hash_code>;
+      using __value_type = decltype(__index_base::_M_index);
+
+      _Hash_node(__value_type __index, std::size_t __hash_code) noexcept
+        : _Hash_node_base(), __index_base{ __index }
+        , __code_cache(__hash_code) { }
+
+      __value_type&
+      _M_v() noexcept
+      { return this->_M_index; }
+
+      const __value_type&
+      _M_v() const noexcept
+      { return this->_M_index; }
+
+      __value_type*
+      _M_valptr() noexcept
+      { return std::__addressof(this->_M_index); }
+
+      const __value_type*
+      _M_valptr() const noexcept
+      { return std::__addressof(this->_M_index); }
+
       _Hash_node*
       _M_next() const noexcept
       { return static_cast<_Hash_node*>(this->_M_nxt); }
     };
 
     /// Base class for node iterators.
-  template<typename _Iterator_tag>
+  template<typename _Iterator_tag, bool _Cache_hash_code>
     struct _Node_iterator_base
     {
-      using __node_type = _Hash_node<_Iterator_tag>;
+      using __node_type = _Hash_node<_Iterator_tag, _Cache_hash_code>;
       using __value_type = typename __node_type::__value_type;
 
       __node_type* _M_cur;
@@ -310,12 +398,12 @@ namespace __detail
     };
 
     /// Node iterators, used to iterate through all the hashtable.
-  template<typename _Iterator_tag>
+  template<typename _Iterator_tag, bool _Cache_hash_code>
     struct _Node_iterator
-      : public _Node_iterator_base<_Iterator_tag>
+      : public _Node_iterator_base<_Iterator_tag, _Cache_hash_code>
     {
     private:
-      using __base_type = _Node_iterator_base<_Iterator_tag>;
+      using __base_type = _Node_iterator_base<_Iterator_tag, _Cache_hash_code>;
       using __node_type = typename __base_type::__node_type;
 
     public:
@@ -356,21 +444,20 @@ namespace __detail
     };
 
     /// Node const_iterators, used to iterate through all the hashtable.
-    template<typename _Iterator_tag>
+  template<typename _Iterator_tag, bool _Cache_hash_code>
     struct _Node_const_iterator
-        : public _Node_iterator_base<_Value, __cache>
+      : public _Node_iterator_base<_Iterator_tag, _Cache_hash_code>
     {
     private:
-        using __base_type = _Node_iterator_base<_Value, __cache>;
-        using __node_type = typename __base_type::__node_type;
+      using __base_type = _Node_iterator_base<_Iterator_tag, _Cache_hash_code>;
+      using __node_type = typename __base_type::__node_type;
 
     public:
-        typedef _Value					value_type;
-        typedef std::ptrdiff_t				difference_type;
-        typedef std::forward_iterator_tag			iterator_category;
-
-        typedef const value_type*				pointer;
-        typedef const value_type&				reference;
+      using value_type = typename __base_type::__value_type;
+      using difference_type = std::ptrdiff_t;
+      using iterator_category = std::forward_iterator_tag;
+      using pointer = const value_type*;
+      using reference = const value_type&;
 
         _Node_const_iterator() = default;
 
@@ -378,8 +465,9 @@ namespace __detail
             _Node_const_iterator(__node_type* __p) noexcept
             : __base_type(__p) { }
 
-        _Node_const_iterator(const _Node_iterator<_Value, __constant_iterators,
-                                                  __cache>& __x) noexcept
+        _Node_const_iterator(const _Node_iterator<_Iterator_tag
+                                                 , _Cache_hash_code>& __x)
+        noexcept
             : __base_type(__x._M_cur) { }
 
         reference
@@ -405,6 +493,1743 @@ namespace __detail
             return __tmp;
         }
     };
+
+  // Backends of the _ContainerHasher index, see _Chained_index_policy and
+  // _Flat_index_policy.
+  template<typename _Iterator_tag, typename _NodeAlloc, bool _Cache_hash_code>
+    class _Chained_index;
+
+  template<typename _Iterator_tag, typename _NodeAlloc, bool _Cache_hash_code>
+    class _Incremental_chained_index;
+
+  // Type of the index stored for an element of the inner container.
+  template<typename _Iterator_tag>
+    using __node_index_t = decltype(_Hash_node_index_base<_Iterator_tag>::_M_index);
+
+    /**
+    *  struct _Chained_index_caching_policy
+    *
+    *  Index policy of _ContainerHasher.  Every element is indexed through
+    *  a separately allocated _Hash_node chained in a bucket array, like in
+    *  std::unordered_set.  The nodes store the hash code of their element
+    *  if @a _Cache_hash_code is true, otherwise the element is hashed
+    *  again to find the bucket of a node.
+    */
+  template<bool _Cache_hash_code>
+    struct _Chained_index_caching_policy
+    {
+      template<typename _Iterator_tag, typename _Alloc
+              ,typename _Key, typename _Hash>
+        using __index_table
+          = _Chained_index<_Iterator_tag
+                          , std::__alloc_rebind<_Alloc
+                              , _Hash_node<_Iterator_tag, _Cache_hash_code>>
+                          , _Cache_hash_code>;
+    };
+
+    /**
+    *  struct _Chained_index_policy
+    *
+    *  Index policy of _ContainerHasher, the default.  The chained index,
+    *  caching the hash codes as decided by __cache_default.
+    */
+  struct _Chained_index_policy
+  {
+    template<typename _Iterator_tag, typename _Alloc
+            ,typename _Key, typename _Hash>
+      using __index_table
+        = typename _Chained_index_caching_policy<
+            __cache_default<_Key, _Hash>::value>::template
+              __index_table<_Iterator_tag, _Alloc, _Key, _Hash>;
+  };
+
+    /**
+    *  struct _Incremental_chained_index_policy
+    *
+    *  Index policy of _ContainerHasher, opt-in.  The chained index of
+    *  _Chained_index_policy, growing without a stop-the-world rehash: see
+    *  _Incremental_chained_index.
+    */
+  struct _Incremental_chained_index_policy
+  {
+    template<typename _Iterator_tag, typename _Alloc
+            ,typename _Key, typename _Hash>
+      using __index_table
+        = _Incremental_chained_index<_Iterator_tag
+            , std::__alloc_rebind<_Alloc
+                , _Hash_node<_Iterator_tag, __cache_default<_Key, _Hash>::value>>
+            , __cache_default<_Key, _Hash>::value>;
+  };
+
+    /**
+    *  struct _Recording_index_policy
+    *
+    *  Index policy of _ContainerHasher, opt-in.  The index of
+    *  @a _IndexPolicy, the container recording statistics of its use,
+    *  returned by its stats() member.  Any other policy records nothing,
+    *  and stores nothing for it.
+    */
+  template<typename _IndexPolicy = _Chained_index_policy>
+    struct _Recording_index_policy
+    {
+      using __recorded_policy = _IndexPolicy;
+
+      template<typename _Iterator_tag, typename _Alloc
+              ,typename _Key, typename _Hash>
+        using __index_table = typename _IndexPolicy::template
+          __index_table<_Iterator_tag, _Alloc, _Key, _Hash>;
+    };
+
+  // Whether the index of _Policy is embedded, with a fixed capacity.
+  template<typename _Policy, typename = void>
+    struct __fixed_index : std::false_type
+    { };
+
+  template<typename _Policy>
+    struct __fixed_index<_Policy, std::void_t<decltype(_Policy::__capacity)>>
+    : std::true_type
+    { };
+
+  // Whether a _ContainerHasher with index policy _Policy records stats.
+  template<typename _Policy, typename = void>
+    struct __records_stats : std::false_type
+    { };
+
+  template<typename _Policy>
+    struct __records_stats<_Policy
+                          , std::void_t<typename _Policy::__recorded_policy>>
+    : std::true_type
+    { };
+
+    /**
+    *  struct _Flat_index_policy
+    *
+    *  Index policy of _ContainerHasher selecting open addressing: 7-bit
+    *  hash fingerprints in a control byte array probed 16 slots at a time,
+    *  the slots holding indices into the inner container. No allocation
+    *  per element, and a lookup touches one or two cache lines.
+    */
+  struct _Flat_index_policy
+  {
+    template<typename _Iterator_tag, typename _Alloc
+            ,typename _Key, typename _Hash>
+      using __index_table
+        = _Flat_index<__node_index_t<_Iterator_tag>
+                     , std::__alloc_rebind<_Alloc, __node_index_t<_Iterator_tag>>>;
+  };
+
+  // Slots of the storage embedded by the static containers for __n
+  // elements: a power of two, at least __min and twice __n.
+  constexpr std::size_t
+  __static_capacity(std::size_t __n, std::size_t __min = 1) noexcept
+  {
+    std::size_t __cap = __min;
+    while (__cap < 2 * __n)
+      __cap <<= 1;
+    return __cap;
+  }
+
+    /**
+    *  struct _Static_flat_index_policy
+    *
+    *  Index policy of _ContainerHasher selecting the flat index embedded
+    *  in the container, with room for @a _Nm elements at half the load
+    *  at most.  It never allocates, and the container must never hold
+    *  more than @a _Nm elements, see static_hashed_queue.
+    */
+  template<std::size_t _Nm>
+    struct _Static_flat_index_policy
+    {
+      static constexpr std::size_t __capacity
+        = __static_capacity(_Nm, _Flat_ctrl::_S_group_width);
+
+      template<typename _Iterator_tag, typename _Alloc
+              ,typename _Key, typename _Hash>
+        using __index_table
+          = _Static_flat_index<__node_index_t<_Iterator_tag>, __capacity>;
+    };
+
+    /**
+    *  struct _Hashtable_alloc
+    *
+    *  Allocation of the nodes and of the bucket array of the chained index.
+    *  We inherit from the node allocator to benefit from the Zero size base
+    *  struct optimization.
+    *
+    *  The nodes come from a pool owned by the table: slabs of nodes taken
+    *  from the node allocator, and a free list of the released nodes.  A
+    *  released node is only given back to the allocator with its slab, by
+    *  _M_release_pool(), so a table cycling through the same number of
+    *  elements stops calling the allocator for its nodes.
+    */
+  template<typename _NodeAlloc>
+    struct _Hashtable_alloc : private _NodeAlloc
+    {
+      using __node_type = typename _NodeAlloc::value_type;
+      using __node_alloc_type = _NodeAlloc;
+      using __node_alloc_traits = __gnu_cxx::__alloc_traits<__node_alloc_type>;
+      using __node_ptr = __node_type*;
+      using __node_base = _Hash_node_base;
+      using __node_base_ptr = __node_base*;
+      using __buckets_alloc_type =
+        std::__alloc_rebind<__node_alloc_type, __node_base_ptr>;
+      using __buckets_alloc_traits = std::allocator_traits<__buckets_alloc_type>;
+      using __buckets_ptr = __node_base_ptr*;
+
+    private:
+      // Header of a slab, in its first node slot.
+      struct _Slab
+      {
+        __node_ptr  _M_next;
+        std::size_t _M_count;
+      };
+
+      static_assert(sizeof(_Slab) <= sizeof(__node_type)
+                    && alignof(_Slab) <= alignof(__node_type)
+                    , "a slab header fits in a node");
+
+      static constexpr std::size_t _S_min_slab = 16;
+
+      __node_ptr      _M_slabs = nullptr;
+      __node_base_ptr _M_free = nullptr;
+      // never used slots of the newest slab
+      __node_ptr      _M_carve = nullptr;
+      __node_ptr      _M_carve_end = nullptr;
+      std::size_t     _M_pool_capacity = 0;
+      std::size_t     _M_pool_used = 0;
+
+    public:
+      _Hashtable_alloc() = default;
+
+      // The pool stays with the table it belongs to.
+      _Hashtable_alloc(const _Hashtable_alloc& __x)
+        : __node_alloc_type(__x._M_node_allocator())
+      { }
+
+      _Hashtable_alloc(_Hashtable_alloc&& __x) noexcept
+        : __node_alloc_type(std::move(__x._M_node_allocator()))
+      { _M_swap_pool(__x); }
+
+      template<typename _Alloc>
+        _Hashtable_alloc(_Alloc&& __a)
+          : __node_alloc_type(std::forward<_Alloc>(__a))
+        { }
+
+      ~_Hashtable_alloc()
+      { _M_release_pool(); }
+
+      __node_alloc_type&
+      _M_node_allocator() noexcept
+      { return *this; }
+
+      const __node_alloc_type&
+      _M_node_allocator() const noexcept
+      { return *this; }
+
+      // Allocate a node and construct an element within it.
+      template<typename... _Args>
+        __node_ptr
+        _M_allocate_node(_Args&&... __args);
+
+      // Destroy the element within a node and deallocate the node.
+      void
+      _M_deallocate_node(__node_ptr __n);
+
+      // Return a node to the pool.
+      void
+      _M_deallocate_node_ptr(__node_ptr __n) noexcept;
+
+      // Deallocate the linked list of nodes pointed to by __n.
+      // The elements within the nodes are destroyed.
+      void
+      _M_deallocate_nodes(__node_ptr __n);
+
+      __buckets_ptr
+      _M_allocate_buckets(std::size_t __bkt_count);
+
+      void
+      _M_deallocate_buckets(__buckets_ptr, std::size_t __bkt_count);
+
+      // Make room in the pool for @a __n more nodes, in one slab.
+      void
+      _M_reserve_nodes(std::size_t __n);
+
+      // Node slots held by the pool, in use or not.
+      std::size_t
+      _M_pool_capacity_nodes() const noexcept
+      { return _M_pool_capacity; }
+
+      // Give all the slabs back to the allocator.  No node may be in use.
+      void
+      _M_release_pool() noexcept;
+
+      // Swaps the pools, the allocators must be equal.
+      void
+      _M_swap_pool(_Hashtable_alloc& __x) noexcept
+      {
+        std::swap(_M_slabs, __x._M_slabs);
+        std::swap(_M_free, __x._M_free);
+        std::swap(_M_carve, __x._M_carve);
+        std::swap(_M_carve_end, __x._M_carve_end);
+        std::swap(_M_pool_capacity, __x._M_pool_capacity);
+        std::swap(_M_pool_used, __x._M_pool_used);
+      }
+
+    private:
+      // Storage for one node, from the free list, the newest slab or a
+      // new slab.
+      __node_ptr
+      _M_get_node();
+
+      void
+      _M_allocate_slab(std::size_t __count);
+    };
+
+  // Definitions of class template _Hashtable_alloc's out-of-line member
+  // functions.
+  template<typename _NodeAlloc>
+    template<typename... _Args>
+      auto
+      _Hashtable_alloc<_NodeAlloc>::_M_allocate_node(_Args&&... __args)
+      -> __node_ptr
+      {
+        __node_ptr __n = _M_get_node();
+        __try
+          {
+            __node_alloc_traits::construct(_M_node_allocator(), __n
+                                         , std::forward<_Args>(__args)...);
+            return __n;
+          }
+        __catch(...)
+          {
+            _M_deallocate_node_ptr(__n);
+            __throw_exception_again;
+          }
+      }
+
+  template<typename _NodeAlloc>
+    void
+    _Hashtable_alloc<_NodeAlloc>::_M_deallocate_node(__node_ptr __n)
+    {
+      __node_alloc_traits::destroy(_M_node_allocator(), __n);
+      _M_deallocate_node_ptr(__n);
+    }
+
+  template<typename _NodeAlloc>
+    void
+    _Hashtable_alloc<_NodeAlloc>::_M_deallocate_node_ptr(__node_ptr __n)
+    noexcept
+    {
+      _M_free = ::new (static_cast<void*>(__n)) __node_base(_M_free);
+      --_M_pool_used;
+    }
+
+  template<typename _NodeAlloc>
+    auto
+    _Hashtable_alloc<_NodeAlloc>::_M_get_node()
+    -> __node_ptr
+    {
+      if (!_M_free && _M_carve == _M_carve_end)
+        // Grow the pool geometrically.
+        _M_allocate_slab(std::max(_S_min_slab, _M_pool_capacity + 1));
+
+      __node_ptr __n;
+      if (_M_free)
+        {
+          __n = static_cast<__node_ptr>(static_cast<void*>(_M_free));
+          _M_free = _M_free->_M_nxt;
+        }
+      else
+        __n = _M_carve++;
+      ++_M_pool_used;
+      return __n;
+    }
+
+  template<typename _NodeAlloc>
+    void
+    _Hashtable_alloc<_NodeAlloc>::_M_reserve_nodes(std::size_t __n)
+    {
+      const std::size_t __avail = _M_pool_capacity - _M_pool_used;
+      if (__n > __avail)
+        _M_allocate_slab(__n - __avail + 1);
+    }
+
+  template<typename _NodeAlloc>
+    void
+    _Hashtable_alloc<_NodeAlloc>::_M_allocate_slab(std::size_t __count)
+    {
+      auto __ptr = __node_alloc_traits::allocate(_M_node_allocator(), __count);
+      __node_ptr __slab = std::__to_address(__ptr);
+      ::new (static_cast<void*>(__slab)) _Slab{ _M_slabs, __count };
+      _M_slabs = __slab;
+
+      // The slots left in the former newest slab go to the free list.
+      while (_M_carve != _M_carve_end)
+        _M_free = ::new (static_cast<void*>(_M_carve++)) __node_base(_M_free);
+      _M_carve = __slab + 1;
+      _M_carve_end = __slab + __count;
+      _M_pool_capacity += __count - 1;
+    }
+
+  template<typename _NodeAlloc>
+    void
+    _Hashtable_alloc<_NodeAlloc>::_M_release_pool() noexcept
+    {
+      __glibcxx_assert(_M_pool_used == 0);
+      using _Ptr = typename __node_alloc_traits::pointer;
+      while (__node_ptr __slab = _M_slabs)
+        {
+          const _Slab& __header = *static_cast<_Slab*>(static_cast<void*>(__slab));
+          _M_slabs = __header._M_next;
+          const std::size_t __count = __header._M_count;
+          __node_alloc_traits::deallocate(_M_node_allocator()
+                                        , std::pointer_traits<_Ptr>::
+                                            pointer_to(*__slab)
+                                        , __count);
+        }
+      _M_free = nullptr;
+      _M_carve = _M_carve_end = nullptr;
+      _M_pool_capacity = 0;
+    }
+
+  template<typename _NodeAlloc>
+    void
+    _Hashtable_alloc<_NodeAlloc>::_M_deallocate_nodes(__node_ptr __n)
+    {
+      while (__n)
+        {
+          __node_ptr __tmp = __n;
+          __n = __n->_M_next();
+          _M_deallocate_node(__tmp);
+        }
+    }
+
+  template<typename _NodeAlloc>
+    auto
+    _Hashtable_alloc<_NodeAlloc>::_M_allocate_buckets(std::size_t __bkt_count)
+    -> __buckets_ptr
+    {
+      __buckets_alloc_type __alloc(_M_node_allocator());
+
+      auto __ptr = __buckets_alloc_traits::allocate(__alloc, __bkt_count);
+      __buckets_ptr __p = std::__to_address(__ptr);
+      __builtin_memset(__p, 0, __bkt_count * sizeof(__node_base_ptr));
+      return __p;
+    }
+
+  template<typename _NodeAlloc>
+    void
+    _Hashtable_alloc<_NodeAlloc>::
+    _M_deallocate_buckets(__buckets_ptr __bkts, std::size_t __bkt_count)
+    {
+      using _Ptr = typename __buckets_alloc_traits::pointer;
+      auto __ptr = std::pointer_traits<_Ptr>::pointer_to(*__bkts);
+      __buckets_alloc_type __alloc(_M_node_allocator());
+      __buckets_alloc_traits::deallocate(__alloc, __ptr, __bkt_count);
+    }
+
+    /**
+    *  class _Chained_index
+    *
+    *  Node based index of _ContainerHasher, following the layout of the
+    *  libstdc++ _Hashtable: all the nodes form a single forward list, and
+    *  a bucket holds a pointer to the node *before* its first node, so that
+    *  any node can be unlinked from its bucket.  The bucket count is a power
+    *  of two.
+    *
+    *  The index never sees the keys: callers hand over the hash code and
+    *  a predicate on stored indices (see _Flat_index for the same
+    *  interface).  Unless the nodes cache the hash code, the bucket of a
+    *  node is found with the _Rehash functor, mapping a stored index to
+    *  the hash code of its element.
+    */
+  template<typename _Iterator_tag, typename _NodeAlloc, bool _Cache_hash_code>
+    class _Chained_index
+      : public _Hashtable_alloc<_NodeAlloc>
+    {
+      using __hashtable_alloc = _Hashtable_alloc<_NodeAlloc>;
+      using __node_type = _Hash_node<_Iterator_tag, _Cache_hash_code>;
+      using __node_ptr = __node_type*;
+      using __node_base = _Hash_node_base;
+      using __node_base_ptr = __node_base*;
+      using __buckets_ptr = __node_base_ptr*;
+
+    public:
+      using size_type = std::size_t;
+      using index_type = typename __node_type::__value_type;
+      using allocator_type = _NodeAlloc;
+      using iterator = _Node_iterator<_Iterator_tag, _Cache_hash_code>;
+      using const_iterator
+        = _Node_const_iterator<_Iterator_tag, _Cache_hash_code>;
+
+    private:
+      __buckets_ptr   _M_buckets = &_M_single_bucket;
+      size_type       _M_bucket_count = 1;
+      __node_base     _M_before_begin;
+      size_type       _M_element_count = 0;
+      float           _M_max_load_factor = 1.0f;
+      size_type       _M_next_resize = 0;
+      __node_base_ptr _M_single_bucket = nullptr;
+      // bucket pointing to _M_before_begin, i.e. holding the first node
+      size_type       _M_bbegin_bkt = 0;
+
+    public:
+      _Chained_index() = default;
+
+      template<typename _Alloc>
+        explicit
+        _Chained_index(const _Alloc& __a)
+          : __hashtable_alloc(__node_alloc_type(__a))
+        { }
+
+      // The copies take the _Rehash functor of the copied elements.
+      _Chained_index(const _Chained_index&) = delete;
+
+      template<typename _Rehash>
+        _Chained_index(const _Chained_index& __ht, _Rehash&& __rehash)
+          : _Chained_index(__ht, __rehash, __node_alloc_traits::
+              _S_select_on_copy(__ht._M_node_allocator()))
+        { }
+
+      template<typename _Rehash>
+        _Chained_index(const _Chained_index& __ht, _Rehash&& __rehash
+                     , const allocator_type& __a)
+          : __hashtable_alloc(__a)
+          , _M_max_load_factor(__ht._M_max_load_factor)
+          , _M_next_resize(__ht._M_next_resize)
+          , _M_bbegin_bkt(__ht._M_bbegin_bkt)
+        {
+          _M_bucket_count = __ht._M_bucket_count;
+          _M_buckets = _M_allocate_buckets(_M_bucket_count);
+          this->_M_reserve_nodes(__ht._M_element_count);
+          _M_element_count = __ht._M_element_count;
+          _AllocNode<_NodeAlloc> __alloc_node_gen(*this);
+          _M_assign(__ht, __alloc_node_gen, __rehash);
+        }
+
+      _Chained_index(_Chained_index&& __ht) noexcept
+        : __hashtable_alloc(std::move(__ht._M_node_allocator()))
+        , _M_buckets(__ht._M_buckets)
+        , _M_bucket_count(__ht._M_bucket_count)
+        , _M_before_begin(__ht._M_before_begin._M_nxt)
+        , _M_element_count(__ht._M_element_count)
+        , _M_max_load_factor(__ht._M_max_load_factor)
+        , _M_next_resize(__ht._M_next_resize)
+        , _M_bbegin_bkt(__ht._M_bbegin_bkt)
+      {
+        this->_M_swap_pool(__ht);
+
+        // Update buckets if __ht is using its single bucket.
+        if (__ht._M_uses_single_bucket())
+          {
+            _M_buckets = &_M_single_bucket;
+            _M_single_bucket = __ht._M_single_bucket;
+          }
+
+        // Fix bucket containing the _M_before_begin pointer that can't be
+        // moved.
+        _M_update_bbegin();
+        __ht._M_reset();
+      }
+
+      _Chained_index&
+      operator=(const _Chained_index&) = delete;
+
+      /// Copy assignment, recycling the nodes of this index.
+      template<typename _Rehash>
+        void
+        _M_copy_assign(const _Chained_index& __ht, _Rehash&& __rehash);
+
+      _Chained_index&
+      operator=(_Chained_index&& __ht) noexcept
+      {
+        _Chained_index __tmp(std::move(__ht));
+        swap(__tmp);
+        return *this;
+      }
+
+      ~_Chained_index()
+      {
+        _M_clear();
+        _M_deallocate_buckets();
+      }
+
+      void
+      swap(_Chained_index& __x) noexcept;
+
+      iterator
+      begin() noexcept
+      { return iterator(_M_begin()); }
+
+      const_iterator
+      begin() const noexcept
+      { return const_iterator(_M_begin()); }
+
+      iterator
+      end() noexcept
+      { return iterator(nullptr); }
+
+      const_iterator
+      end() const noexcept
+      { return const_iterator(nullptr); }
+
+      size_type
+      size() const noexcept
+      { return _M_element_count; }
+
+      bool
+      empty() const noexcept
+      { return size() == 0; }
+
+      size_type
+      bucket_count() const noexcept
+      { return _M_bucket_count; }
+
+      float
+      load_factor() const noexcept
+      { return static_cast<float>(size()) / static_cast<float>(bucket_count()); }
+
+      float
+      max_load_factor() const noexcept
+      { return _M_max_load_factor; }
+
+      // The new factor applies at the next insertion.
+      void
+      max_load_factor(float __z) noexcept
+      {
+        _M_max_load_factor = __z;
+        _M_next_resize = _M_bkt_resize_threshold(_M_bucket_count);
+      }
+
+      allocator_type
+      get_allocator() const noexcept
+      { return this->_M_node_allocator(); }
+
+      /**
+       * @brief _M_find
+       *    Looks up the node of the element hashed to @a __code for which
+       *    @a __eq returns true.
+       * @return a pointer to the index stored in the node, or nullptr.
+       */
+      template<typename _Pred, typename _Rehash>
+        index_type*
+        _M_find(std::size_t __code, _Pred&& __eq, _Rehash&& __rehash) const
+        {
+          __node_base_ptr __prev = _M_find_before_node(_M_bucket_index(__code)
+                                                     , __code, __eq, __rehash);
+          return __prev
+            ? std::__addressof(static_cast<__node_ptr>(__prev->_M_nxt)->_M_v())
+            : nullptr;
+        }
+
+      /**
+       * @brief _M_insert
+       *    Stores @a __idx under @a __code. The caller must have checked
+       *    that no equivalent element is indexed already.
+       * @param __rehash
+       *    Functor returning the hash code of a stored index, unused when
+       *    the nodes cache their hash code.
+       * @return a pointer to the index stored in the new node.
+       */
+      template<typename _Rehash>
+        index_type*
+        _M_insert(std::size_t __code, index_type __idx, _Rehash&& __rehash)
+        {
+          if (size_type __n = _M_need_rehash(1))
+            _M_rehash(__n, __rehash);
+          __node_ptr __node = this->_M_allocate_node(__idx, __code);
+          _M_insert_bucket_begin(_M_bucket_index(__code), __node);
+          ++_M_element_count;
+          return std::__addressof(__node->_M_v());
+        }
+
+      /**
+       * @brief _M_erase
+       *    Removes the node hashed to @a __code whose index is @a __idx.
+       * @return true if such a node was found.
+       */
+      template<typename _Rehash>
+        bool
+        _M_erase(std::size_t __code, index_type __idx, _Rehash&& __rehash)
+        noexcept(_Cache_hash_code)
+        {
+          const size_type __bkt = _M_bucket_index(__code);
+          auto __same = [__idx](index_type __i) { return __i == __idx; };
+          __node_base_ptr __prev
+            = _M_find_before_node(__bkt, __code, __same, __rehash);
+          if (!__prev)
+            return false;
+          _M_erase(__bkt, __prev, static_cast<__node_ptr>(__prev->_M_nxt)
+                 , __rehash);
+          return true;
+        }
+
+      /**
+       * @brief _M_replace
+       *    Rewrites the index of the node hashed to @a __code from
+       *    @a __old to @a __new.
+       * @return true if such a node was found.
+       */
+      template<typename _Rehash>
+        bool
+        _M_replace(std::size_t __code, index_type __old, index_type __new
+                 , _Rehash&& __rehash) noexcept(_Cache_hash_code)
+        {
+          index_type* __p
+            = _M_find(__code, [__old](index_type __i) { return __i == __old; }
+                    , __rehash);
+          if (!__p)
+            return false;
+          *__p = __new;
+          return true;
+        }
+
+      /**
+       * @brief _M_prefetch
+       *    Starts loading the bucket of @a __code ahead of a batch of
+       *    lookups. The nodes hang off it, they cannot be fetched before
+       *    the bucket is.
+       */
+      void
+      _M_prefetch(std::size_t __code) const noexcept
+      { __builtin_prefetch(_M_buckets + _M_bucket_index(__code)); }
+
+      /// Count of nodes _M_find(@a __code, @a __eq) visits: those of the
+      /// bucket up to the match, all of them on a miss.
+      template<typename _Pred, typename _Rehash>
+        size_type
+        _M_probe_length(std::size_t __code, _Pred&& __eq
+                       , _Rehash&& __rehash) const
+        {
+          const size_type __bkt = _M_bucket_index(__code);
+          __node_base_ptr __prev = _M_buckets[__bkt];
+          if (!__prev)
+            return 0;
+
+          size_type __n = 0;
+          for (__node_ptr __p = static_cast<__node_ptr>(__prev->_M_nxt);
+               __p && (__n == 0 || _M_bucket_index(*__p, __rehash) == __bkt);
+               __p = __p->_M_next())
+            {
+              ++__n;
+              if (_S_hash_code(*__p, __rehash) == __code && __eq(__p->_M_v()))
+                break;
+            }
+          return __n;
+        }
+
+      /// Bytes held by the node pool and the bucket array.
+      std::size_t
+      _M_allocated_bytes() const noexcept
+      {
+        return this->_M_pool_capacity_nodes() * sizeof(__node_type)
+          + (_M_uses_single_bucket() ? 0
+             : _M_bucket_count * sizeof(__node_base_ptr));
+      }
+
+      /// Makes room for @a __n elements without further rehashing, nor
+      /// allocating nodes.
+      template<typename _Rehash>
+        void
+        _M_reserve(size_type __n, _Rehash&& __rehash)
+        {
+          const size_type __bkts = _M_bkt_for_elements(__n);
+          if (__bkts > _M_bucket_count)
+            _M_rehash(__bkts, __rehash);
+          if (__n > size())
+            this->_M_reserve_nodes(__n - size());
+        }
+
+      /// As _M_reserve, while the nodes of @a __old, handed over by
+      /// _M_start_migration, are not all relinked yet: they count in
+      /// @a __n, and stay where they are.
+      template<typename _Rehash>
+        void
+        _M_reserve_migrating(const _Chained_index& __old, size_type __n
+                           , _Rehash&& __rehash)
+        {
+          const size_type __bkts = _M_bkt_for_elements(__n);
+          if (__bkts > _M_bucket_count)
+            _M_rehash(__bkts, __rehash);
+          const size_type __size = size() + __old.size();
+          if (__n > __size)
+            this->_M_reserve_nodes(__n - __size);
+        }
+
+      /**
+       * @brief _M_shrink_to_fit
+       *    Gives the unused nodes back to the allocator, moving the used
+       *    ones to a single slab, and shrinks the bucket array to the
+       *    element count.
+       */
+      template<typename _Rehash>
+        void
+        _M_shrink_to_fit(_Rehash&& __rehash)
+        {
+          if (empty())
+            {
+              _M_clear();
+              this->_M_release_pool();
+              _M_deallocate_buckets();
+              _M_reset();
+              return;
+            }
+          if (this->_M_pool_capacity_nodes() == size()
+              && _M_bkt_for_elements(size()) == _M_bucket_count)
+            return;
+
+          _Chained_index __tmp(this->_M_node_allocator());
+          __tmp._M_max_load_factor = _M_max_load_factor;
+          __tmp._M_reserve(size(), __rehash);
+          for (__node_ptr __p = _M_begin(); __p; __p = __p->_M_next())
+            __tmp._M_insert(_S_hash_code(*__p, __rehash), __p->_M_v()
+                          , __rehash);
+          swap(__tmp);
+        }
+
+      /**
+       * @brief _M_start_migration
+       *    If inserting @a __n_ins elements would go over the maximum load
+       *    factor, hands all the nodes over to @a __old, an empty index,
+       *    and starts over with the bucket array _M_insert would have
+       *    rehashed to.  The nodes stay in the pool of this index, they
+       *    come back with _M_migrate.
+       * @return whether the nodes were handed over.
+       */
+      bool
+      _M_start_migration(_Chained_index& __old, size_type __n_ins)
+      {
+        const size_type __bkt_count = _M_need_rehash(__n_ins);
+        if (!__bkt_count)
+          return false;
+        __buckets_ptr __new_buckets
+          = __hashtable_alloc::_M_allocate_buckets(__bkt_count);
+        swap(__old);
+        this->_M_swap_pool(__old);
+        _M_max_load_factor = __old._M_max_load_factor;
+        _M_buckets = __new_buckets;
+        _M_bucket_count = __bkt_count;
+        _M_next_resize = _M_bkt_resize_threshold(__bkt_count);
+        return true;
+      }
+
+      /**
+       * @brief _M_migrate
+       *    Relinks up to @a __n nodes of @a __old, in its list order, into
+       *    the buckets of this index.  The bucket array of @a __old is
+       *    released once it is empty.
+       * @return whether @a __old is empty.
+       */
+      template<typename _Rehash>
+        bool
+        _M_migrate(_Chained_index& __old, size_type __n, _Rehash&& __rehash)
+        noexcept(_Cache_hash_code)
+        {
+          for (; __n != 0 && __old._M_begin(); --__n)
+            {
+              __node_ptr __p = __old._M_begin();
+              __old._M_unlink(__old._M_bbegin_bkt, &__old._M_before_begin
+                            , __p, __rehash);
+              _M_insert_bucket_begin(_M_bucket_index(*__p, __rehash), __p);
+              ++_M_element_count;
+            }
+          if (__old._M_begin())
+            return false;
+          __old._M_deallocate_buckets();
+          __old._M_reset();
+          return true;
+        }
+
+      /// As _M_erase, for a node of @a __old, handed over by
+      /// _M_start_migration.
+      template<typename _Rehash>
+        bool
+        _M_erase_migrating(_Chained_index& __old, std::size_t __code
+                         , index_type __idx, _Rehash&& __rehash)
+        noexcept(_Cache_hash_code)
+        {
+          const size_type __bkt = __old._M_bucket_index(__code);
+          auto __same = [__idx](index_type __i) { return __i == __idx; };
+          __node_base_ptr __prev
+            = __old._M_find_before_node(__bkt, __code, __same, __rehash);
+          if (!__prev)
+            return false;
+          __node_ptr __n = static_cast<__node_ptr>(__prev->_M_nxt);
+          __old._M_unlink(__bkt, __prev, __n, __rehash);
+          this->_M_deallocate_node(__n);
+          return true;
+        }
+
+      /// Deallocates the nodes left in @a __old, and its bucket array.
+      void
+      _M_clear_migrating(_Chained_index& __old) noexcept
+      {
+        this->_M_deallocate_nodes(__old._M_begin());
+        __old._M_deallocate_buckets();
+        __old._M_reset();
+      }
+
+      void
+      _M_clear() noexcept
+      {
+        this->_M_deallocate_nodes(_M_begin());
+        __builtin_memset(_M_buckets, 0
+                         , _M_bucket_count * sizeof(__node_base_ptr));
+        _M_element_count = 0;
+        _M_before_begin._M_nxt = nullptr;
+      }
+
+    private:
+      using __node_alloc_type = _NodeAlloc;
+      using __node_alloc_traits = typename __hashtable_alloc::__node_alloc_traits;
+
+      __node_ptr
+      _M_begin() const noexcept
+      { return static_cast<__node_ptr>(_M_before_begin._M_nxt); }
+
+      bool
+      _M_uses_single_bucket(__buckets_ptr __bkts) const noexcept
+      { return __builtin_expect(__bkts == &_M_single_bucket, false); }
+
+      bool
+      _M_uses_single_bucket() const noexcept
+      { return _M_uses_single_bucket(_M_buckets); }
+
+      size_type
+      _M_bucket_index(std::size_t __code, size_type __bkt_count) const noexcept
+      { return __hash_mix(__code) & (__bkt_count - 1); }
+
+      size_type
+      _M_bucket_index(std::size_t __code) const noexcept
+      { return _M_bucket_index(__code, _M_bucket_count); }
+
+      template<typename _Rehash>
+        static std::size_t
+        _S_hash_code(const __node_type& __n, _Rehash& __rehash)
+        noexcept(_Cache_hash_code)
+        {
+          if constexpr (_Cache_hash_code)
+            return __n._M_hash_code;
+          else
+            return __rehash(__n._M_v());
+        }
+
+      template<typename _Rehash>
+        size_type
+        _M_bucket_index(const __node_type& __n, _Rehash& __rehash) const
+        noexcept(_Cache_hash_code)
+        { return _M_bucket_index(_S_hash_code(__n, __rehash)); }
+
+      // Hash code to hand over to a copy of node @a __n.
+      static std::size_t
+      _S_cached_code(const __node_type& __n) noexcept
+      {
+        if constexpr (_Cache_hash_code)
+          return __n._M_hash_code;
+        else
+          return 0;
+      }
+
+      __buckets_ptr
+      _M_allocate_buckets(size_type __bkt_count)
+      {
+        if (__builtin_expect(__bkt_count == 1, false))
+          {
+            _M_single_bucket = nullptr;
+            return &_M_single_bucket;
+          }
+
+        return __hashtable_alloc::_M_allocate_buckets(__bkt_count);
+      }
+
+      void
+      _M_deallocate_buckets(__buckets_ptr __bkts, size_type __bkt_count)
+      {
+        if (_M_uses_single_bucket(__bkts))
+          return;
+
+        __hashtable_alloc::_M_deallocate_buckets(__bkts, __bkt_count);
+      }
+
+      void
+      _M_deallocate_buckets()
+      { _M_deallocate_buckets(_M_buckets, _M_bucket_count); }
+
+      void
+      _M_update_bbegin() noexcept
+      {
+        if (_M_begin())
+          _M_buckets[_M_bbegin_bkt] = &_M_before_begin;
+      }
+
+      void
+      _M_reset() noexcept
+      {
+        _M_bucket_count = 1;
+        _M_single_bucket = nullptr;
+        _M_buckets = &_M_single_bucket;
+        _M_before_begin._M_nxt = nullptr;
+        _M_element_count = 0;
+        _M_next_resize = 0;
+        _M_bbegin_bkt = 0;
+      }
+
+      size_type
+      _M_bkt_resize_threshold(size_type __bkt_count) const noexcept
+      {
+        return static_cast<size_type>(__builtin_floor(__bkt_count
+                                                      * _M_max_load_factor));
+      }
+
+      // Smallest power of two bucket count holding @a __n elements under
+      // the maximum load factor.
+      size_type
+      _M_bkt_for_elements(size_type __n) const noexcept
+      {
+        size_type __bkts = 1;
+        while (_M_bkt_resize_threshold(__bkts) < __n)
+          __bkts <<= 1;
+        return __bkts;
+      }
+
+      // Returns the new bucket count if inserting @a __n_ins elements goes
+      // over the maximum load factor, 0 otherwise.  Grows at least twofold.
+      size_type
+      _M_need_rehash(size_type __n_ins) const noexcept
+      {
+        if (_M_element_count + __n_ins <= _M_next_resize)
+          return 0;
+        return std::max(_M_bkt_for_elements(_M_element_count + __n_ins)
+                      , _M_bucket_count * 2);
+      }
+
+      // Find the node before the one matching the criteria.
+      template<typename _Pred, typename _Rehash>
+        __node_base_ptr
+        _M_find_before_node(size_type __bkt, std::size_t __code
+                          , _Pred& __eq, _Rehash& __rehash) const
+        {
+          __node_base_ptr __prev_p = _M_buckets[__bkt];
+          if (!__prev_p)
+            return nullptr;
+
+          const __node_base_ptr __first = __prev_p->_M_nxt;
+          for (__node_ptr __p = static_cast<__node_ptr>(__first);;
+               __p = __p->_M_next())
+            {
+              if constexpr (_Cache_hash_code)
+                {
+                  if (__p->_M_hash_code == __code && __eq(__p->_M_v()))
+                    return __prev_p;
+
+                  if (!__p->_M_nxt || _M_bucket_index(*__p->_M_next()
+                                                      , __rehash) != __bkt)
+                    break;
+                }
+              else
+                {
+                  // Hashing each node once, rather than its successor to
+                  // find the end of the bucket, compares an element that
+                  // is loaded already.
+                  const std::size_t __p_code = __rehash(__p->_M_v());
+                  if (__p != __first && _M_bucket_index(__p_code) != __bkt)
+                    break;
+                  if (__p_code == __code && __eq(__p->_M_v()))
+                    return __prev_p;
+
+                  if (!__p->_M_nxt)
+                    break;
+                }
+              __prev_p = __p;
+            }
+
+          return nullptr;
+        }
+
+      // Insert a node at the beginning of a bucket.
+      void
+      _M_insert_bucket_begin(size_type __bkt, __node_ptr __node) noexcept
+      {
+        if (_M_buckets[__bkt])
+          {
+            // Bucket is not empty, we just need to insert the new node
+            // after the bucket before begin.
+            __node->_M_nxt = _M_buckets[__bkt]->_M_nxt;
+            _M_buckets[__bkt]->_M_nxt = __node;
+          }
+        else
+          {
+            // The bucket is empty, the new node is inserted at the
+            // beginning of the singly-linked list and the bucket will
+            // contain _M_before_begin pointer.
+            __node->_M_nxt = _M_before_begin._M_nxt;
+            _M_before_begin._M_nxt = __node;
+
+            if (__node->_M_nxt)
+              // We must update former begin bucket that is pointing to
+              // _M_before_begin.
+              _M_buckets[_M_bbegin_bkt] = __node;
+
+            _M_buckets[__bkt] = &_M_before_begin;
+            _M_bbegin_bkt = __bkt;
+          }
+      }
+
+      // Remove the bucket first node
+      void
+      _M_remove_bucket_begin(size_type __bkt, __node_ptr __next_n
+                           , size_type __next_bkt) noexcept
+      {
+        if (!__next_n || __next_bkt != __bkt)
+          {
+            // Bucket is now empty
+            // First update next bucket if any
+            if (__next_n)
+              _M_buckets[__next_bkt] = _M_buckets[__bkt];
+
+            // Second update before begin node if necessary
+            if (&_M_before_begin == _M_buckets[__bkt])
+              {
+                _M_before_begin._M_nxt = __next_n;
+                _M_bbegin_bkt = __next_bkt;
+              }
+            _M_buckets[__bkt] = nullptr;
+          }
+      }
+
+      template<typename _Rehash>
+        void
+        _M_erase(size_type __bkt, __node_base_ptr __prev_n, __node_ptr __n
+               , _Rehash& __rehash) noexcept(_Cache_hash_code)
+        {
+          _M_unlink(__bkt, __prev_n, __n, __rehash);
+          this->_M_deallocate_node(__n);
+        }
+
+      // Takes node @a __n, following @a __prev_n in bucket @a __bkt, out
+      // of the index without deallocating it.
+      template<typename _Rehash>
+        void
+        _M_unlink(size_type __bkt, __node_base_ptr __prev_n, __node_ptr __n
+                , _Rehash& __rehash) noexcept(_Cache_hash_code)
+        {
+          if (__prev_n == _M_buckets[__bkt])
+            _M_remove_bucket_begin(__bkt, __n->_M_next()
+               , __n->_M_nxt ? _M_bucket_index(*__n->_M_next(), __rehash) : 0);
+          else if (__n->_M_nxt)
+            {
+              size_type __next_bkt = _M_bucket_index(*__n->_M_next(), __rehash);
+              if (__next_bkt != __bkt)
+                _M_buckets[__next_bkt] = __prev_n;
+            }
+
+          __prev_n->_M_nxt = __n->_M_nxt;
+          --_M_element_count;
+        }
+
+      // Rehash to @a __bkt_count buckets, nodes keep their order within a
+      // bucket.
+      template<typename _Rehash>
+        void
+        _M_rehash(size_type __bkt_count, _Rehash& __rehash)
+        {
+          __buckets_ptr __new_buckets = _M_allocate_buckets(__bkt_count);
+          __node_ptr __p = _M_begin();
+          _M_before_begin._M_nxt = nullptr;
+          size_type __bbegin_bkt = 0;
+          while (__p)
+            {
+              __node_ptr __next = __p->_M_next();
+              size_type __bkt
+                = _M_bucket_index(_S_hash_code(*__p, __rehash), __bkt_count);
+              if (!__new_buckets[__bkt])
+                {
+                  __p->_M_nxt = _M_before_begin._M_nxt;
+                  _M_before_begin._M_nxt = __p;
+                  __new_buckets[__bkt] = &_M_before_begin;
+                  if (__p->_M_nxt)
+                    __new_buckets[__bbegin_bkt] = __p;
+                  __bbegin_bkt = __bkt;
+                }
+              else
+                {
+                  __p->_M_nxt = __new_buckets[__bkt]->_M_nxt;
+                  __new_buckets[__bkt]->_M_nxt = __p;
+                }
+
+              __p = __next;
+            }
+
+          _M_deallocate_buckets();
+          _M_bucket_count = __bkt_count;
+          _M_buckets = __new_buckets;
+          _M_bbegin_bkt = __bbegin_bkt;
+          _M_next_resize = _M_bkt_resize_threshold(__bkt_count);
+        }
+
+      // Copy the nodes of @a __ht, which has the same bucket count, in the
+      // same order.
+      template<typename _NodeGenerator, typename _Rehash>
+        void
+        _M_assign(const _Chained_index& __ht, _NodeGenerator& __node_gen
+                , _Rehash& __rehash)
+        {
+          __try
+            {
+              __node_ptr __ht_n = __ht._M_begin();
+              if (!__ht_n)
+                return;
+
+              // First deal with the special first node pointed to by
+              // _M_before_begin, in the same bucket as in __ht.
+              __node_ptr __this_n
+                = __node_gen(__ht_n->_M_v(), _S_cached_code(*__ht_n));
+              _M_before_begin._M_nxt = __this_n;
+              _M_update_bbegin();
+
+              // Then deal with other nodes.
+              __node_ptr __prev_n = __this_n;
+              for (__ht_n = __ht_n->_M_next(); __ht_n; __ht_n = __ht_n->_M_next())
+                {
+                  __this_n = __node_gen(__ht_n->_M_v(), _S_cached_code(*__ht_n));
+                  __prev_n->_M_nxt = __this_n;
+                  size_type __bkt = _M_bucket_index(*__this_n, __rehash);
+                  if (!_M_buckets[__bkt])
+                    _M_buckets[__bkt] = __prev_n;
+                  __prev_n = __this_n;
+                }
+            }
+          __catch(...)
+            {
+              _M_clear();
+              __throw_exception_again;
+            }
+        }
+    };
+
+  template<typename _Iterator_tag, typename _NodeAlloc, bool _Cache_hash_code>
+    template<typename _Rehash>
+      void
+      _Chained_index<_Iterator_tag, _NodeAlloc, _Cache_hash_code>::
+      _M_copy_assign(const _Chained_index& __ht, _Rehash&& __rehash)
+    {
+      if (&__ht == this)
+        return;
+
+      if (__node_alloc_traits::_S_propagate_on_copy_assign()
+          && this->_M_node_allocator() != __ht._M_node_allocator())
+        {
+          // Replacement allocator cannot free existing storage, we need
+          // to erase nodes first.
+          _M_clear();
+          this->_M_release_pool();
+          _M_deallocate_buckets();
+          _M_reset();
+        }
+      std::__alloc_on_copy(this->_M_node_allocator(), __ht._M_node_allocator());
+
+      __buckets_ptr __former_buckets = nullptr;
+      const size_type __former_bucket_count = _M_bucket_count;
+      if (_M_bucket_count != __ht._M_bucket_count)
+        {
+          __former_buckets = _M_buckets;
+          _M_buckets = _M_allocate_buckets(__ht._M_bucket_count);
+          _M_bucket_count = __ht._M_bucket_count;
+        }
+      else
+        __builtin_memset(_M_buckets, 0
+                         , _M_bucket_count * sizeof(__node_base_ptr));
+
+      // Reuse the nodes of this index while copying.
+      _ReuseOrAllocNode<_NodeAlloc> __roan(_M_begin(), *this);
+      _M_before_begin._M_nxt = nullptr;
+      _M_element_count = __ht._M_element_count;
+      _M_max_load_factor = __ht._M_max_load_factor;
+      _M_next_resize = __ht._M_next_resize;
+      _M_bbegin_bkt = __ht._M_bbegin_bkt;
+      __try
+        {
+          _M_assign(__ht, __roan, __rehash);
+        }
+      __catch(...)
+        {
+          if (__former_buckets)
+            {
+              _M_deallocate_buckets();
+              _M_buckets = __former_buckets;
+              _M_bucket_count = __former_bucket_count;
+              __builtin_memset(_M_buckets, 0
+                               , _M_bucket_count * sizeof(__node_base_ptr));
+            }
+          _M_next_resize = _M_bkt_resize_threshold(_M_bucket_count);
+          __throw_exception_again;
+        }
+
+      if (__former_buckets)
+        _M_deallocate_buckets(__former_buckets, __former_bucket_count);
+    }
+
+  template<typename _Iterator_tag, typename _NodeAlloc, bool _Cache_hash_code>
+    void
+    _Chained_index<_Iterator_tag, _NodeAlloc, _Cache_hash_code>::
+    swap(_Chained_index& __x) noexcept
+    {
+      std::__alloc_on_swap(this->_M_node_allocator(), __x._M_node_allocator());
+      std::swap(_M_max_load_factor, __x._M_max_load_factor);
+      std::swap(_M_next_resize, __x._M_next_resize);
+
+      // Deal properly with potentially moved instances.
+      if (this->_M_uses_single_bucket())
+        {
+          if (!__x._M_uses_single_bucket())
+            {
+              _M_buckets = __x._M_buckets;
+              __x._M_buckets = &__x._M_single_bucket;
+            }
+        }
+      else if (__x._M_uses_single_bucket())
+        {
+          __x._M_buckets = _M_buckets;
+          _M_buckets = &_M_single_bucket;
+        }
+      else
+        std::swap(_M_buckets, __x._M_buckets);
+
+      std::swap(_M_bucket_count, __x._M_bucket_count);
+      std::swap(_M_before_begin._M_nxt, __x._M_before_begin._M_nxt);
+      std::swap(_M_element_count, __x._M_element_count);
+      std::swap(_M_single_bucket, __x._M_single_bucket);
+      std::swap(_M_bbegin_bkt, __x._M_bbegin_bkt);
+      this->_M_swap_pool(__x);
+
+      // Fix buckets containing the _M_before_begin pointers that can't be
+      // swapped.
+      _M_update_bbegin();
+      __x._M_update_bbegin();
+    }
+
+    /**
+    *  class _Incremental_chained_index
+    *
+    *  Chained index spreading its growth over the following operations.
+    *  When an insertion crosses the maximum load factor, the nodes are
+    *  handed over to a second table, _M_old, and the index starts over
+    *  with a bucket array twice as large.  Each insertion or erasure then
+    *  relinks _S_migrate_step nodes of _M_old into the new buckets, and
+    *  lookups search both tables until _M_old is empty.  No operation
+    *  touches more than a few nodes, whatever the size of the index; the
+    *  nodes are relinked, neither copied nor reallocated.
+    *
+    *  All the nodes belong to the pool of _M_cur, _M_old never allocates
+    *  nor deallocates one.
+    */
+  template<typename _Iterator_tag, typename _NodeAlloc, bool _Cache_hash_code>
+    class _Incremental_chained_index
+    {
+      using __table = _Chained_index<_Iterator_tag, _NodeAlloc, _Cache_hash_code>;
+
+      // Nodes relinked by each insertion or erasure while migrating.
+      static constexpr std::size_t _S_migrate_step = 8;
+
+    public:
+      using size_type = typename __table::size_type;
+      using index_type = typename __table::index_type;
+      using allocator_type = typename __table::allocator_type;
+
+    private:
+      __table _M_cur;
+      // nodes not relinked into the buckets of _M_cur yet
+      __table _M_old;
+
+    public:
+      _Incremental_chained_index() = default;
+
+      template<typename _Alloc>
+        explicit
+        _Incremental_chained_index(const _Alloc& __a)
+          : _M_cur(__a), _M_old(__a)
+        { }
+
+      _Incremental_chained_index(const _Incremental_chained_index&) = delete;
+
+      // The copy is not migrating, the nodes of _M_old are inserted.
+      template<typename _Rehash>
+        _Incremental_chained_index(const _Incremental_chained_index& __x
+                                 , _Rehash&& __rehash)
+          : _M_cur(__x._M_cur, __rehash), _M_old(_M_cur.get_allocator())
+        { _M_insert_all(__x._M_old, __rehash); }
+
+      template<typename _Rehash>
+        _Incremental_chained_index(const _Incremental_chained_index& __x
+                                 , _Rehash&& __rehash
+                                 , const allocator_type& __a)
+          : _M_cur(__x._M_cur, __rehash, __a), _M_old(__a)
+        { _M_insert_all(__x._M_old, __rehash); }
+
+      _Incremental_chained_index(_Incremental_chained_index&&) = default;
+
+      // The nodes of _M_old go back to the pool of _M_cur.
+      ~_Incremental_chained_index()
+      { _M_cur._M_clear_migrating(_M_old); }
+
+      _Incremental_chained_index&
+      operator=(const _Incremental_chained_index&) = delete;
+
+      template<typename _Rehash>
+        void
+        _M_copy_assign(const _Incremental_chained_index& __x
+                     , _Rehash&& __rehash)
+        {
+          if (&__x == this)
+            return;
+          _M_cur._M_clear_migrating(_M_old);
+          _M_cur._M_copy_assign(__x._M_cur, __rehash);
+          std::__alloc_on_copy(_M_old._M_node_allocator()
+                             , __x._M_old._M_node_allocator());
+          _M_insert_all(__x._M_old, __rehash);
+        }
+
+      _Incremental_chained_index&
+      operator=(_Incremental_chained_index&& __x) noexcept
+      {
+        _Incremental_chained_index __tmp(std::move(__x));
+        swap(__tmp);
+        return *this;
+      }
+
+      void
+      swap(_Incremental_chained_index& __x) noexcept
+      {
+        _M_cur.swap(__x._M_cur);
+        _M_old.swap(__x._M_old);
+      }
+
+      size_type
+      size() const noexcept
+      { return _M_cur.size() + _M_old.size(); }
+
+      bool
+      empty() const noexcept
+      { return size() == 0; }
+
+      size_type
+      bucket_count() const noexcept
+      { return _M_cur.bucket_count(); }
+
+      float
+      load_factor() const noexcept
+      { return static_cast<float>(size()) / static_cast<float>(bucket_count()); }
+
+      float
+      max_load_factor() const noexcept
+      { return _M_cur.max_load_factor(); }
+
+      void
+      max_load_factor(float __z) noexcept
+      { _M_cur.max_load_factor(__z); }
+
+      allocator_type
+      get_allocator() const noexcept
+      { return _M_cur.get_allocator(); }
+
+      // Whether nodes are left to relink into the current buckets.
+      bool
+      _M_migrating() const noexcept
+      { return !_M_old.empty(); }
+
+      template<typename _Pred, typename _Rehash>
+        index_type*
+        _M_find(std::size_t __code, _Pred&& __eq, _Rehash&& __rehash) const
+        {
+          if (index_type* __p = _M_cur._M_find(__code, __eq, __rehash))
+            return __p;
+          return _M_migrating() ? _M_old._M_find(__code, __eq, __rehash)
+                                : nullptr;
+        }
+
+      // Starts a migration rather than rehashing the nodes at once.
+      template<typename _Rehash>
+        index_type*
+        _M_insert(std::size_t __code, index_type __idx, _Rehash&& __rehash)
+        {
+          if (_M_migrating())
+            _M_cur._M_migrate(_M_old, _S_migrate_step, __rehash);
+          else
+            _M_cur._M_start_migration(_M_old, 1);
+          return _M_cur._M_insert(__code, __idx, __rehash);
+        }
+
+      template<typename _Rehash>
+        bool
+        _M_erase(std::size_t __code, index_type __idx, _Rehash&& __rehash)
+        noexcept(_Cache_hash_code)
+        {
+          if (_M_migrating())
+            _M_cur._M_migrate(_M_old, _S_migrate_step, __rehash);
+          return _M_cur._M_erase(__code, __idx, __rehash)
+                 || (_M_migrating()
+                     && _M_cur._M_erase_migrating(_M_old, __code, __idx
+                                                , __rehash));
+        }
+
+      template<typename _Rehash>
+        bool
+        _M_replace(std::size_t __code, index_type __old, index_type __new
+                 , _Rehash&& __rehash) noexcept(_Cache_hash_code)
+        {
+          index_type* __p
+            = _M_find(__code, [__old](index_type __i) { return __i == __old; }
+                    , __rehash);
+          if (!__p)
+            return false;
+          *__p = __new;
+          return true;
+        }
+
+      void
+      _M_prefetch(std::size_t __code) const noexcept
+      {
+        _M_cur._M_prefetch(__code);
+        if (_M_migrating())
+          _M_old._M_prefetch(__code);
+      }
+
+      template<typename _Pred, typename _Rehash>
+        size_type
+        _M_probe_length(std::size_t __code, _Pred&& __eq
+                       , _Rehash&& __rehash) const
+        {
+          size_type __n = _M_cur._M_probe_length(__code, __eq, __rehash);
+          if (_M_migrating() && !_M_cur._M_find(__code, __eq, __rehash))
+            __n += _M_old._M_probe_length(__code, __eq, __rehash);
+          return __n;
+        }
+
+      std::size_t
+      _M_allocated_bytes() const noexcept
+      { return _M_cur._M_allocated_bytes() + _M_old._M_allocated_bytes(); }
+
+      // The migration goes on at its own pace: the buckets of _M_cur grow
+      // for all the nodes when they are too few, those of _M_old are left
+      // alone, and the nodes already reserved are not reserved again.
+      template<typename _Rehash>
+        void
+        _M_reserve(size_type __n, _Rehash&& __rehash)
+        {
+          if (_M_migrating())
+            _M_cur._M_reserve_migrating(_M_old, __n, __rehash);
+          else
+            _M_cur._M_reserve(__n, __rehash);
+        }
+
+      template<typename _Rehash>
+        void
+        _M_shrink_to_fit(_Rehash&& __rehash)
+        {
+          _M_cur._M_migrate(_M_old, size_type(-1), __rehash);
+          _M_cur._M_shrink_to_fit(__rehash);
+        }
+
+      void
+      _M_clear() noexcept
+      {
+        _M_cur._M_clear_migrating(_M_old);
+        _M_cur._M_clear();
+      }
+
+    private:
+      template<typename _Rehash>
+        void
+        _M_insert_all(const __table& __from, _Rehash& __rehash)
+        {
+          for (auto __it = __from.begin(); __it != __from.end(); ++__it)
+            _M_cur._M_insert(__rehash(*__it), *__it, __rehash);
+        }
+    };
+
+  // Whether the inner container stores its elements in one array.
+  template<typename _Container, typename = void>
+    struct __has_data : std::false_type
+    { };
+
+  template<typename _Container>
+    struct __has_data<_Container
+      , std::void_t<decltype(std::declval<const _Container&>().data())>>
+    : std::true_type
+    { };
+
+    /**
+    *  struct _Sequence_traits
+    *
+    *  How _ContainerHasher addresses the elements of its inner container.
+    *  The primary template handles random access containers, e.g.
+    *  std::vector, through the position of the element: removing the
+    *  front element would shift all the others, so pop_front() is not
+    *  available on top of them.
+    */
+  template<typename _Container>
+    struct _Sequence_traits
+    {
+      using __index_type = std::size_t;
+
+      static constexpr bool __stable_front = false;
+
+      // elements held without allocating
+      static constexpr std::size_t __inline_capacity = 0;
+
+      // whether growing moves the elements to a new buffer
+      static constexpr bool __relocates = true;
+
+      static __index_type
+      _S_front_index(const _Container&) noexcept
+      { return 0; }
+
+      static __index_type
+      _S_end_index(const _Container& __c) noexcept
+      { return __c.size(); }
+
+      // Elements from __i on, before __end, adjacent in memory.
+      static std::size_t
+      _S_contiguous(const _Container&, __index_type __i
+                  , __index_type __end) noexcept
+      {
+        if constexpr (__has_data<_Container>::value)
+          return __end - __i;
+        else
+          return 1;
+      }
+
+      template<typename _Cont>
+        static decltype(auto)
+        _S_at(_Cont& __c, __index_type __i) noexcept
+        { return __c[__i]; }
+    };
+
+    /**
+    *  The revolver keeps the index of an element for as long as the
+    *  element is in it, pops at the front included.
+    */
+  template<typename _Tp, typename _Allocator, std::size_t _Nm>
+    struct _Sequence_traits<revolver<_Tp, _Allocator, _Nm>>
+    {
+      using __index_type = std::size_t;
+
+      static constexpr bool __stable_front = true;
+
+      static constexpr std::size_t __inline_capacity = _Nm;
+
+      static constexpr bool __relocates = true;
+
+      static __index_type
+      _S_front_index(const revolver<_Tp, _Allocator, _Nm>& __c) noexcept
+      { return __c.front_index(); }
+
+      static __index_type
+      _S_end_index(const revolver<_Tp, _Allocator, _Nm>& __c) noexcept
+      { return __c.end_index(); }
+
+      // up to the end of the buffer, where the ring wraps around
+      static std::size_t
+      _S_contiguous(const revolver<_Tp, _Allocator, _Nm>& __c
+                  , __index_type __i, __index_type __end) noexcept
+      {
+        const std::size_t __cap = __c.capacity();
+        return std::min<std::size_t>(__end - __i, __cap - (__i & (__cap - 1)));
+      }
+
+      template<typename _Cont>
+        static decltype(auto)
+        _S_at(_Cont& __c, __index_type __i) noexcept
+        { return __c.at_index(__i); }
+    };
+
+    /**
+    *  The segmented_revolver keeps the indices as the revolver does, and
+    *  never moves its elements: it grows a segment at a time.
+    */
+  template<typename _Tp, typename _Allocator, std::size_t _Seg>
+    struct _Sequence_traits<segmented_revolver<_Tp, _Allocator, _Seg>>
+    {
+      using __index_type = std::size_t;
+
+      static constexpr bool __stable_front = true;
+
+      static constexpr std::size_t __inline_capacity = 0;
+
+      static constexpr bool __relocates = false;
+
+      static __index_type
+      _S_front_index(const segmented_revolver<_Tp, _Allocator, _Seg>& __c)
+      noexcept
+      { return __c.front_index(); }
+
+      static __index_type
+      _S_end_index(const segmented_revolver<_Tp, _Allocator, _Seg>& __c)
+      noexcept
+      { return __c.end_index(); }
+
+      // up to the end of the segment
+      static std::size_t
+      _S_contiguous(const segmented_revolver<_Tp, _Allocator, _Seg>&
+                  , __index_type __i, __index_type __end) noexcept
+      { return std::min<std::size_t>(__end - __i, _Seg - __i % _Seg); }
+
+      template<typename _Cont>
+        static decltype(auto)
+        _S_at(_Cont& __c, __index_type __i) noexcept
+        { return __c.at_index(__i); }
+    };
+
+  // Whether the inner container can reserve storage ahead of insertions.
+  template<typename _Container, typename = void>
+    struct __has_reserve : std::false_type
+    { };
+
+  template<typename _Container>
+    struct __has_reserve<_Container
+      , std::void_t<decltype(std::declval<_Container&>().reserve(0))>>
+    : std::true_type
+    { };
+
+  template<typename _Container, typename = void>
+    struct __has_shrink_to_fit : std::false_type
+    { };
+
+  template<typename _Container>
+    struct __has_shrink_to_fit<_Container
+      , std::void_t<decltype(std::declval<_Container&>().shrink_to_fit())>>
+    : std::true_type
+    { };
+
+  template<typename _Container, typename = void>
+    struct __has_capacity : std::false_type
+    { };
+
+  template<typename _Container>
+    struct __has_capacity<_Container
+      , std::void_t<decltype(std::declval<const _Container&>().capacity())>>
+    : std::true_type
+    { };
+
+  // Whether the inner container keeps a mapped value beside each element,
+  // in a column of its own at the same index, see mapped_revolver.
+  // __taken_type is what taking an element out of the container yields.
+  template<typename _Container, typename = void>
+    struct __mapped_column : std::false_type
+    {
+      using __mapped_type = void;
+      using __taken_type = typename _Container::value_type;
+    };
+
+  template<typename _Container>
+    struct __mapped_column<_Container
+      , std::void_t<typename _Container::mapped_type>>
+    : std::true_type
+    {
+      using __mapped_type = typename _Container::mapped_type;
+      using __taken_type
+        = std::pair<typename _Container::value_type, __mapped_type>;
+    };
    ///@} _ContainerHasher-detail
 } // namespace __detail
     /// @endcond
@@ -0,0 +1,589 @@
+// lockfree_hashed_queue.h header -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file lockfree_hashed_queue.h
+ *  This is a Standard C++ Library style header.
+ */
+
+#ifndef LOCKFREE_HASHED_QUEUE_H
+#define LOCKFREE_HASHED_QUEUE_H 1
+
+#pragma GCC system_header
+
+#include <algorithm>         // for std::max
+#include <atomic>
+#include <cstdint>
+#include <cstring>           // for std::memcpy
+#include <memory>            // for std::unique_ptr
+#include <optional>
+#include <bits/functional_hash.h> // for std::hash
+#include "flat_index.h"      // for __detail::__hash_mix
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+namespace __detail
+{
+  /**
+   * @addtogroup _ContainerHasher-detail
+   * @{
+   */
+
+  inline constexpr std::size_t __lockfree_cache_line = 64;
+
+  // Smallest power of two at least __n.
+  constexpr std::size_t
+  __lockfree_pow2(std::size_t __n) noexcept
+  {
+    std::size_t __p = 1;
+    while (__p < __n)
+      __p <<= 1;
+    return __p;
+  }
+
+  /**
+   * @brief The _Lockfree_ring class
+   *    Bounded multi producer, multi consumer FIFO of trivially copyable
+   *    values. Each cell carries a sequence number telling whether it is
+   *    ready for the push or the pop of a given turn, producers and
+   *    consumers only meet on a CAS of their own position counter.
+   */
+  template<typename _Tp>
+    class _Lockfree_ring
+    {
+      struct _Cell
+      {
+        std::atomic<std::size_t> _M_seq;
+        _Tp                      _M_val;
+      };
+
+      std::unique_ptr<_Cell[]> _M_cells;
+      std::size_t              _M_mask;
+      alignas(__lockfree_cache_line) std::atomic<std::size_t> _M_tail{0};
+      alignas(__lockfree_cache_line) std::atomic<std::size_t> _M_head{0};
+
+    public:
+      explicit
+      _Lockfree_ring(std::size_t __capacity)
+      : _M_cells(new _Cell[__capacity]), _M_mask(__capacity - 1)
+      {
+        for (std::size_t __i = 0; __i != __capacity; ++__i)
+          _M_cells[__i]._M_seq.store(__i, std::memory_order_relaxed);
+      }
+
+      std::size_t
+      capacity() const noexcept
+      { return _M_mask + 1; }
+
+      // Approximate, the counters are read one after the other.
+      std::size_t
+      size() const noexcept
+      {
+        const std::size_t __h = _M_head.load(std::memory_order_relaxed);
+        const std::size_t __t = _M_tail.load(std::memory_order_relaxed);
+        return __t > __h ? __t - __h : 0;
+      }
+
+      bool
+      _M_try_push(const _Tp& __v) noexcept
+      {
+        std::size_t __pos = _M_tail.load(std::memory_order_relaxed);
+        for (;;)
+          {
+            _Cell& __c = _M_cells[__pos & _M_mask];
+            const std::size_t __seq
+              = __c._M_seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t __dif = std::ptrdiff_t(__seq - __pos);
+            if (__dif == 0)
+              {
+                if (_M_tail.compare_exchange_weak(__pos, __pos + 1
+                                                , std::memory_order_relaxed))
+                  {
+                    __c._M_val = __v;
+                    __c._M_seq.store(__pos + 1, std::memory_order_release);
+                    return true;
+                  }
+              }
+            else if (__dif < 0)
+              return false; // full
+            else
+              __pos = _M_tail.load(std::memory_order_relaxed);
+          }
+      }
+
+      bool
+      _M_try_pop(_Tp& __v) noexcept
+      {
+        std::size_t __pos = _M_head.load(std::memory_order_relaxed);
+        for (;;)
+          {
+            _Cell& __c = _M_cells[__pos & _M_mask];
+            const std::size_t __seq
+              = __c._M_seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t __dif = std::ptrdiff_t(__seq - (__pos + 1));
+            if (__dif == 0)
+              {
+                if (_M_head.compare_exchange_weak(__pos, __pos + 1
+                                                , std::memory_order_relaxed))
+                  {
+                    __v = __c._M_val;
+                    __c._M_seq.store(__pos + _M_mask + 1
+                                   , std::memory_order_release);
+                    return true;
+                  }
+              }
+            else if (__dif < 0)
+              return false; // empty
+            else
+              __pos = _M_head.load(std::memory_order_relaxed);
+          }
+      }
+    };
+
+  /**
+   * @brief The _Lockfree_index class
+   *    Open addressing set of 64 bits words, the membership index of
+   *    lockfree_hashed_queue.
+   *
+   *    A word lives within _S_window slots of its home slot. Each slot has
+   *    a state word, the state in its low bits and a version bumped on
+   *    every claim above them, and the key word.
+   *
+   *    Insertion claims a free slot (_S_empty or _S_tomb) with a CAS, to
+   *    _S_busy, writes the key then publishes it as _S_pending. It then
+   *    scans the window for other claims of the same key: a committed one
+   *    (_S_present) makes it back out as a duplicate, a pending one closer
+   *    to home makes it back out and try again once that one is settled,
+   *    a pending one farther from home is waited for. Of two racing claims
+   *    at least one sees the other, so exactly one commits. Waits only
+   *    ever happen between claims of the same key, and always toward the
+   *    claim farther from home, they cannot form a cycle.
+   *
+   *    Slots being claimed (_S_busy) are skipped: their claimant publishes
+   *    after our own claim and will see it.
+   *
+   *    Slots never go back to _S_empty, so after some churn the windows
+   *    are full of tombstones. Each home slot keeps its reach instead, one
+   *    past the farthest slot that may hold a claim for it, and scans stop
+   *    there. A claim raises the reach of its home before it is published.
+   *    An erasure lowers it past the trailing free slots of the window,
+   *    unless a claim touched the reach meanwhile: the reach word carries
+   *    a version bumped by every claim and every trim.
+   */
+  class _Lockfree_index
+  {
+  public:
+    using __word_type = std::uint64_t;
+
+    enum class _Insert_result { _S_inserted, _S_duplicate, _S_full };
+
+    static constexpr std::size_t _S_window = 32;
+
+  private:
+    using __state_type = std::uint32_t;
+
+    static constexpr __state_type _S_empty   = 0;
+    static constexpr __state_type _S_busy    = 1;
+    static constexpr __state_type _S_pending = 2;
+    static constexpr __state_type _S_present = 3;
+    static constexpr __state_type _S_tomb    = 4;
+    static constexpr unsigned     _S_state_bits = 3;
+    static constexpr __state_type _S_state_mask = (1u << _S_state_bits) - 1;
+
+    // The reach lives in the padding after the state.
+    struct _Slot
+    {
+      std::atomic<__state_type> _M_state{_S_empty};
+      std::atomic<__state_type> _M_reach{0};
+      std::atomic<__word_type>  _M_key{0};
+    };
+
+    std::unique_ptr<_Slot[]> _M_slots;
+    std::size_t              _M_mask;
+
+    static __state_type
+    _S_st(__state_type __s) noexcept
+    { return __s & _S_state_mask; }
+
+    static __state_type
+    _S_with(__state_type __s, __state_type __st) noexcept
+    { return (__s & ~_S_state_mask) | __st; }
+
+    _Slot&
+    _M_slot(std::size_t __home, std::size_t __d) const noexcept
+    { return _M_slots[(__home + __d) & _M_mask]; }
+
+    // The reach word: the reach in its low bits, a version above them.
+    static constexpr unsigned     _S_reach_bits = 8;
+    static constexpr __state_type _S_reach_mask = (1u << _S_reach_bits) - 1;
+
+    static bool
+    _S_free(__state_type __s) noexcept
+    { return _S_st(__s) == _S_empty || _S_st(__s) == _S_tomb; }
+
+    std::size_t
+    _M_reach(std::size_t __home) const noexcept
+    { return _M_slots[__home]._M_reach.load() & _S_reach_mask; }
+
+    // Raises the reach of __home to cover the slot at distance __d, and
+    // bumps its version even when it covers it already.
+    void
+    _M_extend_reach(std::size_t __home, std::size_t __d) noexcept
+    {
+      std::atomic<__state_type>& __r = _M_slots[__home]._M_reach;
+      __state_type __old = __r.load();
+      for (;;)
+        {
+          const __state_type __reach
+            = std::max<__state_type>(__old & _S_reach_mask, __d + 1);
+          if (__r.compare_exchange_weak(__old
+                , ((__old & ~_S_reach_mask) + (1u << _S_reach_bits))
+                  | __reach))
+            return;
+        }
+    }
+
+    // Lowers the reach of __home past the free slots at its end. Any claim
+    // made since the reach was read bumped its version, the CAS fails.
+    void
+    _M_trim_reach(std::size_t __home) noexcept
+    {
+      std::atomic<__state_type>& __r = _M_slots[__home]._M_reach;
+      __state_type __old = __r.load();
+      std::size_t __reach = __old & _S_reach_mask;
+      while (__reach && _S_free(_M_slot(__home, __reach - 1)._M_state.load()))
+        --__reach;
+      if (__reach != (__old & _S_reach_mask))
+        __r.compare_exchange_strong(__old
+          , ((__old & ~_S_reach_mask) + (1u << _S_reach_bits)) | __reach);
+    }
+
+    // Consistent snapshot of a published slot: its state and, if pending
+    // or present, its key.
+    static __state_type
+    _S_read(const _Slot& __s, __word_type& __key) noexcept
+    {
+      for (;;)
+        {
+          const __state_type __s1 = __s._M_state.load();
+          const __state_type __st = _S_st(__s1);
+          if (__st != _S_pending && __st != _S_present)
+            return __s1;
+          __key = __s._M_key.load(std::memory_order_relaxed);
+          if (__s._M_state.load() == __s1)
+            return __s1;
+        }
+    }
+
+    // Waits until the pending claim of __k seen as __s1 is settled.
+    static __state_type
+    _S_wait_settled(const _Slot& __s, __state_type __s1
+                  , __word_type __k) noexcept
+    {
+      __word_type __key = __k;
+      for (;;)
+        {
+          _S_relax();
+          const __state_type __s2 = _S_read(__s, __key);
+          if (__s2 != __s1 || _S_st(__s2) != _S_pending || __key != __k)
+            return (__key == __k) ? __s2 : _S_with(__s2, _S_tomb);
+        }
+    }
+
+    static void
+    _S_relax() noexcept
+    {
+#if defined(__i386__) || defined(__x86_64__)
+      __builtin_ia32_pause();
+#endif
+    }
+
+  public:
+    explicit
+    _Lockfree_index(std::size_t __capacity)
+    : _M_slots(new _Slot[__capacity]), _M_mask(__capacity - 1)
+    { }
+
+    /// Inserts __k hashed to __code, unless it is already in.
+    _Insert_result
+    _M_insert(std::size_t __code, __word_type __k) noexcept
+    {
+      const std::size_t __home = __hash_mix(__code) & _M_mask;
+      for (;;)
+        {
+          // fast path: committed already? Past the reach, only look for
+          // a free slot.
+          const std::size_t __reach = _M_reach(__home);
+          std::size_t __free = _S_window;
+          for (std::size_t __d = 0; __d != _S_window; ++__d)
+            {
+              if (__d >= __reach && __free != _S_window)
+                break;
+              __word_type __key = 0;
+              const __state_type __s = _S_read(_M_slot(__home, __d), __key);
+              const __state_type __st = _S_st(__s);
+              if (__st == _S_present && __key == __k)
+                return _Insert_result::_S_duplicate;
+              if (__free == _S_window && _S_free(__s))
+                __free = __d;
+              if (__st == _S_empty)
+                break;
+            }
+          if (__free == _S_window)
+            return _Insert_result::_S_full;
+
+          // claim
+          _Slot& __mine = _M_slot(__home, __free);
+          __state_type __s = __mine._M_state.load();
+          if (!_S_free(__s)
+              || !__mine._M_state.compare_exchange_strong(
+                    __s, _S_with(__s + (1u << _S_state_bits), _S_busy)))
+            continue;
+          __s = _S_with(__s + (1u << _S_state_bits), _S_busy);
+          __mine._M_key.store(__k, std::memory_order_relaxed);
+          _M_extend_reach(__home, __free);
+          __s = _S_with(__s, _S_pending);
+          __mine._M_state.store(__s);
+
+          // resolve against the other claims of __k, each raised the reach
+          // before publishing.
+          const std::size_t __last = _M_reach(__home);
+          bool __retry = false;
+          for (std::size_t __d = 0; __d != __last && !__retry; ++__d)
+            {
+              if (__d == __free)
+                continue;
+              const _Slot& __other = _M_slot(__home, __d);
+              __word_type __key = 0;
+              __state_type __o = _S_read(__other, __key);
+              if (_S_st(__o) == _S_pending && __key == __k && __d > __free)
+                __o = _S_wait_settled(__other, __o, __k);
+              if ((_S_st(__o) != _S_pending && _S_st(__o) != _S_present)
+                  || __key != __k)
+                continue;
+
+              // back out, then settle as a duplicate or try again
+              __mine._M_state.store(_S_with(__s, _S_tomb));
+              if (_S_st(__o) == _S_pending)
+                __o = _S_wait_settled(__other, __o, __k);
+              if (_S_st(__o) == _S_present)
+                return _Insert_result::_S_duplicate;
+              __retry = true;
+            }
+          if (__retry)
+            continue;
+
+          __mine._M_state.store(_S_with(__s, _S_present));
+          return _Insert_result::_S_inserted;
+        }
+    }
+
+    /// Removes the committed __k hashed to __code.
+    bool
+    _M_erase(std::size_t __code, __word_type __k) noexcept
+    {
+      const std::size_t __home = __hash_mix(__code) & _M_mask;
+      const std::size_t __reach = _M_reach(__home);
+      for (std::size_t __d = 0; __d != __reach; ++__d)
+        {
+          _Slot& __slot = _M_slot(__home, __d);
+          __word_type __key = 0;
+          __state_type __s = _S_read(__slot, __key);
+          if (_S_st(__s) == _S_empty)
+            return false;
+          // only the owner of __k releases it, the slot cannot change
+          if (_S_st(__s) == _S_present && __key == __k)
+            {
+              __slot._M_state.store(_S_with(__s, _S_tomb));
+              _M_trim_reach(__home);
+              return true;
+            }
+        }
+      return false;
+    }
+
+    bool
+    _M_contains(std::size_t __code, __word_type __k) const noexcept
+    {
+      const std::size_t __home = __hash_mix(__code) & _M_mask;
+      const std::size_t __reach = _M_reach(__home);
+      for (std::size_t __d = 0; __d != __reach; ++__d)
+        {
+          __word_type __key = 0;
+          const __state_type __s = _S_read(_M_slot(__home, __d), __key);
+          if (_S_st(__s) == _S_empty)
+            return false;
+          if (_S_st(__s) == _S_present && __key == __k)
+            return true;
+        }
+      return false;
+    }
+  };
+
+  /// @} _ContainerHasher-detail
+} // namespace __detail
+
+  /**
+   *  @brief A lock-free, bounded, multi producer multi consumer FIFO of
+   *  unique elements.
+   *
+   *  The elements go through a bounded ring, like a revolver of fixed
+   *  capacity, and their keys through a membership index claimed with
+   *  CAS. try_push() fails fast when an equal element is queued, try_pop()
+   *  releases the element from the index as it hands it out.
+   *
+   *  Pushes and pops of distinct elements never wait on each other.
+   *  Pushes of the same element racing each other may briefly wait on
+   *  one another, only one of them succeeds. Between the time an element
+   *  leaves the ring and the time its key is released, pushing it again
+   *  fails as a duplicate.
+   *
+   *  The index has four slots per element, and a key must be held within
+   *  32 slots of its home slot. When those 32 slots are all taken, by
+   *  queued elements or pushes in flight, try_push() fails although the
+   *  ring has room, and succeeds again once some of them are popped. With
+   *  a hash function that spreads the keys this is vanishingly rare. With
+   *  one that gives the same code to many keys, the 33rd of them queued at
+   *  once is refused.
+   *
+   *  Elements are compared bitwise.
+   *
+   *  @tparam _Tp  Type of the elements, trivially copyable and at most 8
+   *               bytes: integers, enums, pointers, small handles.
+   *  @tparam _Hash  Hashing function object type, defaults to hash<_Tp>.
+   */
+  template<typename _Tp, typename _Hash = std::hash<_Tp>>
+    class lockfree_hashed_queue
+    {
+      static_assert(std::is_trivially_copyable<_Tp>::value
+                    , "lockfree_hashed_queue needs trivially copyable"
+                      " elements");
+      static_assert(sizeof(_Tp) <= sizeof(std::uint64_t)
+                    , "lockfree_hashed_queue elements are at most 8 bytes");
+
+      using _Index = __detail::_Lockfree_index;
+      using _Result = typename _Index::_Insert_result;
+
+    public:
+      using value_type = _Tp;
+      using key_type = _Tp;
+      using hasher = _Hash;
+      using size_type = std::size_t;
+
+    private:
+      __detail::_Lockfree_ring<_Tp> _M_ring;
+      _Index                        _M_index;
+      _Hash                         _M_hash;
+
+    public:
+      /**
+       * @brief Builds an empty queue.
+       * @param __capacity  Maximum count of queued elements, rounded up to
+       *                    a power of two. The index has four slots per
+       *                    element.
+       */
+      explicit
+      lockfree_hashed_queue(size_type __capacity
+                          , const hasher& __hf = hasher())
+      : _M_ring(__detail::__lockfree_pow2(__capacity ? __capacity : 1))
+      , _M_index(std::max(__detail::__lockfree_pow2(__capacity) * 4
+                        , _Index::_S_window))
+      , _M_hash(__hf)
+      { }
+
+      lockfree_hashed_queue(const lockfree_hashed_queue&) = delete;
+      lockfree_hashed_queue&
+      operator=(const lockfree_hashed_queue&) = delete;
+
+      size_type
+      capacity() const noexcept
+      { return _M_ring.capacity(); }
+
+      // Approximate under concurrent use.
+      size_type
+      size() const noexcept
+      { return _M_ring.size(); }
+
+      [[__nodiscard__]] bool
+      empty() const noexcept
+      { return size() == 0; }
+
+      /**
+       * @brief try_push
+       *    Queues @a __x unless an equal element is queued or the queue is
+       *    full. Also fails, with room left, when the 32 index slots near
+       *    the home of @a __x are all taken (see the class notes).
+       * @return whether @a __x was queued.
+       */
+      bool
+      try_push(const value_type& __x) noexcept
+      {
+        const std::size_t __code = _M_hash(__x);
+        const std::uint64_t __w = _S_word(__x);
+        if (_M_index._M_insert(__code, __w) != _Result::_S_inserted)
+          return false;
+        if (_M_ring._M_try_push(__x))
+          return true;
+        _M_index._M_erase(__code, __w);
+        return false;
+      }
+
+      /**
+       * @brief try_pop
+       *    Pops the oldest element and releases its key.
+       * @return the element, or an empty optional if the queue was empty.
+       */
+      std::optional<value_type>
+      try_pop() noexcept
+      {
+        value_type __v;
+        if (!_M_ring._M_try_pop(__v))
+          return std::nullopt;
+        _M_index._M_erase(_M_hash(__v), _S_word(__v));
+        return __v;
+      }
+
+      bool
+      contains(const key_type& __x) const noexcept
+      { return _M_index._M_contains(_M_hash(__x), _S_word(__x)); }
+
+      hasher
+      hash_function() const
+      { return _M_hash; }
+
+    private:
+      static std::uint64_t
+      _S_word(const value_type& __x) noexcept
+      {
+        std::uint64_t __w = 0;
+        std::memcpy(&__w, std::__addressof(__x), sizeof(value_type));
+        return __w;
+      }
+    };
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // LOCKFREE_HASHED_QUEUE_H
@@ -0,0 +1,421 @@
+// lru_cache.h header -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file lru_cache.h
+ *  This is a Standard C++ Library style header.
+ */
+
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H 1
+
+#pragma GCC system_header
+
+#include <functional>        // for std::function
+#include <memory_resource>   // for std::pmr::polymorphic_allocator
+#include <tuple>             // for std::forward_as_tuple
+#include "container_hasher.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+  /**
+   *  @brief A bounded key/value cache evicting the least recently used
+   *  entry.
+   *
+   *  The entries live in a single revolver, least recently used first,
+   *  indexed by one hash index: no list node and no set node per entry.
+   *  Using an entry moves it to the back of the sequence in constant time,
+   *  inserting past the capacity evicts the front entry, handing it to
+   *  the eviction callback.
+   *
+   *  Iteration visits the entries from the least to the most recently
+   *  used, without touching them.
+   *
+   *  @tparam _Key  Type of the keys.
+   *  @tparam _Tp  Type of the mapped values.
+   *  @tparam _Hash  Hashing function object type, defaults to hash<_Key>.
+   *  @tparam _Pred  Predicate function object type, defaults
+   *                 to equal_to<_Key>.
+   *  @tparam _Alloc  Allocator type, defaults to
+   *                  allocator<pair<_Key, _Tp>>.
+   *  @tparam _IndexPolicy  Lookup structure, node based by default, see
+   *                        __detail::_Flat_index_policy, and
+   *                        __detail::_Recording_index_policy to record
+   *                        statistics.
+   */
+  template<typename _Key, typename _Tp
+          ,typename _Hash = std::hash<_Key>
+          ,typename _Pred = std::equal_to<_Key>
+          ,typename _Alloc = std::allocator<std::pair<_Key, _Tp>>
+          ,typename _IndexPolicy = __detail::_Chained_index_policy>
+    class lru_cache
+    {
+      // The key is not const in the inner container, it moves with the
+      // entry. It is only ever handed out through const references.
+      using _Hashtable = _ContainerHasher<std::pair<_Key, _Tp>, _Alloc, _Key
+                                        , revolver<std::pair<_Key, _Tp>, _Alloc>
+                                        , _Hash, _Pred, _IndexPolicy>;
+      _Hashtable _M_h;
+
+    public:
+      using key_type = _Key;
+      using mapped_type = _Tp;
+      using value_type = typename _Hashtable::value_type;
+      using hasher = typename _Hashtable::hasher;
+      using key_equal = typename _Hashtable::key_equal;
+      using allocator_type = typename _Hashtable::allocator_type;
+      using size_type = typename _Hashtable::size_type;
+      using difference_type = typename _Hashtable::difference_type;
+      using reference = typename _Hashtable::reference;
+      using const_reference = typename _Hashtable::const_reference;
+      using iterator = typename _Hashtable::iterator;
+      using const_iterator = typename _Hashtable::const_iterator;
+
+      /// Called with each evicted entry, which it may move from.
+      using eviction_callback = std::function<void(value_type&&)>;
+
+    private:
+      size_type         _M_capacity;
+      eviction_callback _M_on_evict;
+
+    public:
+      /**
+       * @brief Builds an empty cache.
+       * @param __capacity  Maximum number of entries, at least one.
+       * @param __on_evict  Called with every entry evicted to make room,
+       *                    may be empty.
+       * @param __a  Allocator of the entries and of the index.
+       */
+      explicit
+      lru_cache(size_type __capacity
+              , eviction_callback __on_evict = eviction_callback()
+              , const hasher& __hf = hasher()
+              , const key_equal& __eql = key_equal()
+              , const allocator_type& __a = allocator_type())
+      : _M_h(__capacity + 1, __hf, __eql, __a)
+      , _M_capacity(__capacity)
+      , _M_on_evict(std::move(__on_evict))
+      { __glibcxx_assert(__capacity != 0); }
+
+      // iterators, least recently used first
+      const_iterator
+      begin() const
+      { return _M_h.begin(); }
+
+      const_iterator
+      end() const noexcept
+      { return _M_h.end(); }
+
+      const_iterator
+      cbegin() const
+      { return _M_h.begin(); }
+
+      const_iterator
+      cend() const noexcept
+      { return _M_h.end(); }
+
+      // capacity
+      [[__nodiscard__]] bool
+      empty() const noexcept
+      { return _M_h.empty(); }
+
+      size_type
+      size() const noexcept
+      { return _M_h.size(); }
+
+      size_type
+      capacity() const noexcept
+      { return _M_capacity; }
+
+      /// Changes the capacity, evicting the entries above it.
+      void
+      set_capacity(size_type __capacity)
+      {
+        __glibcxx_assert(__capacity != 0);
+        _M_capacity = __capacity;
+        _M_evict_excess();
+      }
+
+      // element access
+
+      /// The least recently used entry, the next one evicted.
+      const_reference
+      front() const
+      { return _M_h.front(); }
+
+      /// The most recently used entry.
+      const_reference
+      back() const noexcept
+      { return _M_h.back(); }
+
+      // lookup, marking the entry as the most recently used
+
+      /**
+       * @brief touch
+       *    Marks the entry of @a __k as the most recently used.
+       * @return false if @a __k is not in the cache.
+       */
+      bool
+      touch(const key_type& __k)
+      {
+        // end() moves with the element, read it afterwards.
+        const_iterator __it = _M_h.move_to_back(__k);
+        return __it != _M_h.end();
+      }
+
+      /**
+       * @brief get
+       *    Looks up @a __k and marks its entry as the most recently used.
+       * @return a pointer to the mapped value, or nullptr on a miss.
+       */
+      mapped_type*
+      get(const key_type& __k)
+      {
+        const_iterator __it = _M_h.move_to_back(__k);
+        return __it != _M_h.end() ? std::__addressof(_S_mapped(__it)) : nullptr;
+      }
+
+      /**
+       * @brief get_or_insert
+       *    Looks up @a __k, on a miss inserts a value constructed from
+       *    @a __args, evicting the least recently used entry if the cache
+       *    is full. Either way the entry becomes the most recently used.
+       * @return the mapped value of @a __k.
+       */
+      template<typename... _Args>
+        mapped_type&
+        get_or_insert(const key_type& __k, _Args&&... __args)
+        { return _M_get_or_insert(__k, std::forward<_Args>(__args)...); }
+
+      template<typename... _Args>
+        mapped_type&
+        get_or_insert(key_type&& __k, _Args&&... __args)
+        {
+          return _M_get_or_insert(std::move(__k)
+                                , std::forward<_Args>(__args)...);
+        }
+
+      /**
+       * @brief insert_or_assign
+       *    Assigns @a __obj to the value of @a __k, or inserts it, and marks
+       *    the entry as the most recently used.
+       * @return true if the entry was inserted.
+       */
+      template<typename _Obj>
+        bool
+        insert_or_assign(const key_type& __k, _Obj&& __obj)
+        {
+          const_iterator __it = _M_h.move_to_back(__k);
+          if (__it != _M_h.end())
+            {
+              _S_mapped(__it) = std::forward<_Obj>(__obj);
+              return false;
+            }
+          _M_insert(__k, std::forward<_Obj>(__obj));
+          return true;
+        }
+
+      // lookup, leaving the recency order alone
+      const mapped_type*
+      peek(const key_type& __k) const
+      {
+        const_iterator __it = _M_h.find(__k);
+        return __it != _M_h.end() ? std::__addressof(__it->second) : nullptr;
+      }
+
+      const_iterator
+      find(const key_type& __k) const
+      { return _M_h.find(__k); }
+
+      size_type
+      count(const key_type& __k) const
+      { return _M_h.count(__k); }
+
+      bool
+      contains(const key_type& __k) const
+      { return _M_h.contains(__k); }
+
+      // Heterogeneous lookup, with transparent hash and key equality types.
+      template<typename _Kt>
+        auto
+        find(const _Kt& __k) const
+        -> decltype(_M_h.find(__k))
+        { return _M_h.find(__k); }
+
+      template<typename _Kt>
+        auto
+        count(const _Kt& __k) const
+        -> decltype(_M_h.count(__k))
+        { return _M_h.count(__k); }
+
+      template<typename _Kt>
+        auto
+        contains(const _Kt& __k) const
+        -> decltype(_M_h.contains(__k))
+        { return _M_h.contains(__k); }
+
+      // modifiers
+
+      /// Evicts the least recently used entry, through the callback.
+      void
+      evict()
+      {
+        __glibcxx_assert(!empty());
+        // Moved out of the front and unindexed by its hash code, without
+        // a lookup or a compaction step.
+        std::optional<value_type> __v;
+        _M_h.pop_front_n(1, &__v);
+        if (_M_on_evict)
+          _M_on_evict(std::move(*__v));
+      }
+
+      /// Removes the entry of @a __k, without calling the callback.
+      std::optional<value_type>
+      extract(const key_type& __k)
+      { return _M_h.extract(__k); }
+
+      size_type
+      erase(const key_type& __k)
+      { return _M_h.erase(__k); }
+
+      template<typename _Kt>
+        auto
+        erase(const _Kt& __k)
+        -> decltype(_M_h.erase(__k))
+        { return _M_h.erase(__k); }
+
+      /// Removes all the entries, without calling the callback.
+      void
+      clear() noexcept
+      { _M_h.clear(); }
+
+      void
+      swap(lru_cache& __x) noexcept
+      {
+        using std::swap;
+        _M_h.swap(__x._M_h);
+        swap(_M_capacity, __x._M_capacity);
+        _M_on_evict.swap(__x._M_on_evict);
+      }
+
+      // hash policy
+      size_type
+      bucket_count() const noexcept
+      { return _M_h.bucket_count(); }
+
+      float
+      load_factor() const noexcept
+      { return _M_h.load_factor(); }
+
+      float
+      max_load_factor() const noexcept
+      { return _M_h.max_load_factor(); }
+
+      // With __detail::_Recording_index_policy only.
+      hashed_stats
+      stats() const noexcept
+      { return _M_h.stats(); }
+
+      // observers
+      allocator_type
+      get_allocator() const noexcept
+      { return _M_h.get_allocator(); }
+
+      hasher
+      hash_function() const
+      { return _M_h.hash_function(); }
+
+      key_equal
+      key_eq() const
+      { return _M_h.key_eq(); }
+
+      const eviction_callback&
+      get_eviction_callback() const noexcept
+      { return _M_on_evict; }
+
+    private:
+      // The entries are not const objects, only the key must not change.
+      static mapped_type&
+      _S_mapped(const_iterator __it) noexcept
+      { return const_cast<mapped_type&>(__it->second); }
+
+      template<typename _Kt, typename... _Args>
+        mapped_type&
+        _M_get_or_insert(_Kt&& __k, _Args&&... __args)
+        {
+          const_iterator __it = _M_h.move_to_back(__k);
+          if (__it != _M_h.end())
+            return _S_mapped(__it);
+          return _M_insert(std::forward<_Kt>(__k)
+                         , std::forward<_Args>(__args)...);
+        }
+
+      // The caller checked that __k is not in the cache.
+      template<typename _Kt, typename... _Args>
+        mapped_type&
+        _M_insert(_Kt&& __k, _Args&&... __args)
+        {
+          _M_h.emplace_back(std::piecewise_construct
+                          , std::forward_as_tuple(std::forward<_Kt>(__k))
+                          , std::forward_as_tuple(
+                              std::forward<_Args>(__args)...));
+          // The new entry is at the back, the capacity being at least one
+          // it is never the evicted one: find it there after the eviction.
+          _M_evict_excess();
+          return const_cast<mapped_type&>(_M_h.back().second);
+        }
+
+      void
+      _M_evict_excess()
+      {
+        while (size() > _M_capacity)
+          evict();
+      }
+    };
+
+  template<typename _Key, typename _Tp, typename _Hash, typename _Pred
+          ,typename _Alloc, typename _IndexPolicy>
+    inline void
+    swap(lru_cache<_Key, _Tp, _Hash, _Pred, _Alloc, _IndexPolicy>& __x
+       , lru_cache<_Key, _Tp, _Hash, _Pred, _Alloc, _IndexPolicy>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+  namespace pmr
+  {
+    template<typename _Key, typename _Tp
+            ,typename _Hash = std::hash<_Key>
+            ,typename _Pred = std::equal_to<_Key>
+            ,typename _IndexPolicy = __detail::_Chained_index_policy>
+      using lru_cache
+        = stl::lru_cache<_Key, _Tp, _Hash, _Pred
+                        , std::pmr::polymorphic_allocator<std::pair<_Key, _Tp>>
+                        , _IndexPolicy>;
+  } // namespace pmr
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // LRU_CACHE_H
@@ -0,0 +1,451 @@
+// mapped_revolver.h -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * @file bits/mapped_revolver.h
+ * This is an internal header file, included by other headers.
+ * Do not attempt to use it directly.
+ * @headername{mapped_stack, mapped_queue}
+ */
+
+#ifndef MAPPED_REVOLVER_H
+#define MAPPED_REVOLVER_H 1
+
+#pragma GCC system_header
+
+#include <tuple>             // apply, forward_as_tuple
+#include <utility>           // pair, piecewise_construct
+#include "hasher.h"
+#include "revolver.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+  /**
+   * @brief The mapped_revolver class
+   *    The inner container of mapped_queue and mapped_stack: a revolver
+   *    of keys and a revolver of mapped values, the two columns of a
+   *    table, kept in step.  Every modifier applies to both, so an
+   *    absolute index addresses a key and its mapped value for as long
+   *    as they are in the container.
+   *    value_type is the key: _ContainerHasher hashes and compares the
+   *    keys column only, a lookup never touches the mapped values, and
+   *    moves a mapped value along with its key, see mapped_at_index().
+   *    The mapped values lie in a buffer of their own, read at memory
+   *    speed by a scan of the values alone.
+   */
+  template<typename _Key, typename _Tp
+          ,typename _Allocator = std::allocator<std::pair<_Key, _Tp>>
+          ,std::size_t _Nm = 0>
+  class mapped_revolver
+  {
+  public:
+    using key_column = revolver<_Key, _Allocator, _Nm>;
+    using mapped_column = revolver<_Tp, _Allocator, _Nm>;
+
+    using value_type = _Key;
+    using mapped_type = _Tp;
+    using allocator_type = _Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using iterator = typename key_column::iterator;
+    using const_iterator = typename key_column::const_iterator;
+    using index_type = typename key_column::index_type;
+
+  private:
+    key_column    _M_keys;
+    mapped_column _M_vals;
+
+  public:
+    mapped_revolver() = default;
+
+    explicit
+    mapped_revolver(const allocator_type& __a) noexcept
+    : _M_keys(__a), _M_vals(__a)
+    { }
+
+    // The copies keep the indices of the source elements, the same in
+    // both columns.
+    mapped_revolver(const mapped_revolver&) = default;
+
+    mapped_revolver(const mapped_revolver& __x, const allocator_type& __a)
+    : _M_keys(__x._M_keys, __a), _M_vals(__x._M_vals, __a)
+    { }
+
+    mapped_revolver(mapped_revolver&&) = default;
+
+    mapped_revolver(mapped_revolver&& __x, const allocator_type& __a)
+    : _M_keys(std::move(__x._M_keys), __a), _M_vals(__a)
+    {
+      __try
+        {
+          _M_vals = mapped_column(std::move(__x._M_vals), __a);
+        }
+      __catch(...)
+        {
+          __x._M_reset();
+          __throw_exception_again;
+        }
+    }
+
+    // Should the mapped values fail to follow the keys, both columns of
+    // the table are left empty.
+    mapped_revolver&
+    operator=(const mapped_revolver& __x)
+    {
+      _M_keys = __x._M_keys;
+      __try
+        {
+          _M_vals = __x._M_vals;
+        }
+      __catch(...)
+        {
+          _M_reset();
+          __throw_exception_again;
+        }
+      return *this;
+    }
+
+    mapped_revolver&
+    operator=(mapped_revolver&& __x)
+    noexcept(std::is_nothrow_move_assignable<key_column>::value
+             && std::is_nothrow_move_assignable<mapped_column>::value)
+    {
+      _M_keys = std::move(__x._M_keys);
+      __try
+        {
+          _M_vals = std::move(__x._M_vals);
+        }
+      __catch(...)
+        {
+          _M_reset();
+          __x._M_reset();
+          __throw_exception_again;
+        }
+      return *this;
+    }
+
+    allocator_type
+    get_allocator() const noexcept
+    { return _M_keys.get_allocator(); }
+
+    // iterators, over the keys
+    iterator
+    begin() noexcept
+    { return _M_keys.begin(); }
+
+    const_iterator
+    begin() const noexcept
+    { return _M_keys.begin(); }
+
+    iterator
+    end() noexcept
+    { return _M_keys.end(); }
+
+    const_iterator
+    end() const noexcept
+    { return _M_keys.end(); }
+
+    // capacity
+    bool
+    empty() const noexcept
+    { return _M_keys.empty(); }
+
+    size_type
+    size() const noexcept
+    { return _M_keys.size(); }
+
+    size_type
+    capacity() const noexcept
+    { return _M_keys.capacity(); }
+
+    void
+    reserve(size_type __n)
+    {
+      _M_keys.reserve(__n);
+      _M_vals.reserve(__n);
+    }
+
+    void
+    shrink_to_fit()
+    {
+      _M_keys.shrink_to_fit();
+      _M_vals.shrink_to_fit();
+    }
+
+    // element access through absolute indices
+    index_type
+    front_index() const noexcept
+    { return _M_keys.front_index(); }
+
+    index_type
+    end_index() const noexcept
+    { return _M_keys.end_index(); }
+
+    reference
+    at_index(index_type __i) noexcept
+    { return _M_keys.at_index(__i); }
+
+    const_reference
+    at_index(index_type __i) const noexcept
+    { return _M_keys.at_index(__i); }
+
+    // the mapped value of the key at __i
+    mapped_type&
+    mapped_at_index(index_type __i) noexcept
+    { return _M_vals.at_index(__i); }
+
+    const mapped_type&
+    mapped_at_index(index_type __i) const noexcept
+    { return _M_vals.at_index(__i); }
+
+    // the columns
+    const key_column&
+    keys() const noexcept
+    { return _M_keys; }
+
+    const mapped_column&
+    values() const noexcept
+    { return _M_vals; }
+
+    // modifiers
+
+    // Constructs the key from the arguments of @a __k and the mapped value
+    // from those of @a __m.  Should the mapped value throw, the key is
+    // popped again.
+    template<typename... _KArgs, typename... _MArgs>
+      void
+      emplace_back(std::piecewise_construct_t
+                 , std::tuple<_KArgs...> __k, std::tuple<_MArgs...> __m)
+      {
+        std::apply([this](auto&&... __args)
+                   { _M_keys.emplace_back(
+                       std::forward<decltype(__args)>(__args)...); }
+                 , std::move(__k));
+        __try
+          {
+            std::apply([this](auto&&... __args)
+                       { _M_vals.emplace_back(
+                           std::forward<decltype(__args)>(__args)...); }
+                     , std::move(__m));
+          }
+        __catch(...)
+          {
+            _M_keys.pop_back();
+            __throw_exception_again;
+          }
+      }
+
+    void
+    pop_back() noexcept
+    {
+      _M_keys.pop_back();
+      _M_vals.pop_back();
+    }
+
+    void
+    pop_front() noexcept
+    {
+      _M_keys.pop_front();
+      _M_vals.pop_front();
+    }
+
+    // Keeps the capacity, and the indices keep counting from where they
+    // were, in both columns.
+    void
+    clear() noexcept
+    {
+      _M_keys.clear();
+      _M_vals.clear();
+    }
+
+    void
+    swap(mapped_revolver& __x)
+    noexcept(noexcept(std::declval<key_column&>().swap(
+                        std::declval<key_column&>()))
+             && noexcept(std::declval<mapped_column&>().swap(
+                           std::declval<mapped_column&>())))
+    {
+      _M_keys.swap(__x._M_keys);
+      __try
+        {
+          _M_vals.swap(__x._M_vals);
+        }
+      __catch(...)
+        {
+          _M_reset();
+          __x._M_reset();
+          __throw_exception_again;
+        }
+    }
+
+  private:
+    // Empties both columns, their indices starting over at 0: the columns
+    // of a table that could not be kept in step are dropped together.
+    void
+    _M_reset() noexcept
+    {
+      _M_keys = key_column(_M_keys.get_allocator());
+      _M_vals = mapped_column(_M_vals.get_allocator());
+    }
+  };
+
+  template<typename _Key, typename _Tp, typename _Alloc, std::size_t _Nm>
+    inline void
+    swap(mapped_revolver<_Key, _Tp, _Alloc, _Nm>& __x
+       , mapped_revolver<_Key, _Tp, _Alloc, _Nm>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+namespace __detail
+{
+    /**
+    *  The mapped_revolver is addressed as the revolver of its keys, the
+    *  mapped values being at the same indices.
+    */
+  template<typename _Key, typename _Tp, typename _Allocator, std::size_t _Nm>
+    struct _Sequence_traits<mapped_revolver<_Key, _Tp, _Allocator, _Nm>>
+    : _Sequence_traits<revolver<_Key, _Allocator, _Nm>>
+    {
+    private:
+      using __container = mapped_revolver<_Key, _Tp, _Allocator, _Nm>;
+      using __keys_traits = _Sequence_traits<revolver<_Key, _Allocator, _Nm>>;
+
+    public:
+      using typename __keys_traits::__index_type;
+
+      static __index_type
+      _S_front_index(const __container& __c) noexcept
+      { return __c.front_index(); }
+
+      static __index_type
+      _S_end_index(const __container& __c) noexcept
+      { return __c.end_index(); }
+
+      static std::size_t
+      _S_contiguous(const __container& __c
+                  , __index_type __i, __index_type __end) noexcept
+      { return __keys_traits::_S_contiguous(__c.keys(), __i, __end); }
+    };
+
+  /**
+   * @brief The _Mapped_iterator class
+   *    Forward iterator of mapped_queue and mapped_stack, stepping as the
+   *    iterator of their _ContainerHasher over the keys.  It yields a key
+   *    and its mapped value, read from their own columns, as a pair of
+   *    references.
+   */
+  template<typename _Hashtable, bool _Const>
+    class _Mapped_iterator
+    {
+      template<typename, bool>
+        friend class _Mapped_iterator;
+
+      using __table = std::conditional_t<_Const, const _Hashtable, _Hashtable>;
+      using __key = typename _Hashtable::key_type;
+      using __mapped = typename _Hashtable::container_type::mapped_type;
+      using __base = typename _Hashtable::const_iterator;
+
+      __table* _M_h = nullptr;
+      __base   _M_it;
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::pair<__key, __mapped>;
+      using difference_type = std::ptrdiff_t;
+      using reference
+        = std::pair<const __key&
+                  , std::conditional_t<_Const, const __mapped&, __mapped&>>;
+
+      // The pair of references, held for operator->().
+      struct pointer
+      {
+        reference _M_ref;
+
+        const reference*
+        operator->() const noexcept
+        { return std::__addressof(_M_ref); }
+      };
+
+      _Mapped_iterator() = default;
+
+      _Mapped_iterator(__table* __h, __base __it) noexcept
+      : _M_h(__h), _M_it(__it)
+      { }
+
+      // iterator to const_iterator
+      template<bool _OtherConst
+              ,typename = std::enable_if_t<_Const && !_OtherConst>>
+        _Mapped_iterator(const _Mapped_iterator<_Hashtable, _OtherConst>& __x)
+        noexcept
+        : _M_h(__x._M_h), _M_it(__x._M_it)
+        { }
+
+      reference
+      operator*() const noexcept
+      { return reference(*_M_it, _M_h->mapped(_M_it)); }
+
+      pointer
+      operator->() const noexcept
+      { return pointer{ **this }; }
+
+      _Mapped_iterator&
+      operator++()
+      {
+        ++_M_it;
+        return *this;
+      }
+
+      _Mapped_iterator
+      operator++(int)
+      {
+        _Mapped_iterator __tmp(*this);
+        ++*this;
+        return __tmp;
+      }
+
+      // the iterator over the keys
+      __base
+      base() const noexcept
+      { return _M_it; }
+
+      friend bool
+      operator==(const _Mapped_iterator& __x
+               , const _Mapped_iterator& __y) noexcept
+      { return __x._M_it == __y._M_it; }
+
+      friend bool
+      operator!=(const _Mapped_iterator& __x
+               , const _Mapped_iterator& __y) noexcept
+      { return __x._M_it != __y._M_it; }
+    };
+} // namespace __detail
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // MAPPED_REVOLVER_H
@@ -0,0 +1,434 @@
+// mapped_stack.h header -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file mapped_stack.h
+ *  This is a Standard C++ Library style header.
+ */
+
+#ifndef MAPPED_STACK_H
+#define MAPPED_STACK_H 1
+
+#pragma GCC system_header
+
+#include <memory_resource>   // for std::pmr::polymorphic_allocator
+#include "container_hasher.h"
+#include "mapped_revolver.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+  /**
+   *  @brief A LIFO container of unique keys, each with a mapped value.
+   *
+   *  The dictionary counterpart of hashed_stack: push() stacks a key and
+   *  its value unless the key is already stacked, pop() removes the
+   *  newest one, both in constant time.  Lookup is constant time on
+   *  average, and an entry can be extracted from the middle of the stack
+   *  without disturbing the order of the others.
+   *
+   *  The keys and the mapped values are stored in two parallel columns,
+   *  addressed by the same index, see mapped_revolver: a lookup touches
+   *  the keys only, and values() hands out the column of the values, for
+   *  a walk that reads them alone, densely.
+   *
+   *  Iteration visits the entries in push order, bottom of the stack
+   *  first, as pairs
+   *  of a reference to the key and one to the mapped value, which can
+   *  be modified in place.
+   *
+   *  @tparam _Key  Type of the keys.
+   *  @tparam _Tp  Type of the mapped values.
+   *  @tparam _Hash  Hashing function object type, defaults to
+   *                 hash<_Key>.
+   *  @tparam _Pred  Predicate function object type, defaults
+   *                 to equal_to<_Key>.
+   *  @tparam _Alloc  Allocator type, defaults to
+   *                  allocator<pair<_Key, _Tp>>, rebound for each column.
+   *  @tparam _IndexPolicy  Lookup structure, node based by default, see
+   *                        __detail::_Flat_index_policy, and
+   *                        __detail::_Recording_index_policy to record
+   *                        statistics.
+   *  @tparam _Nm  Entries held without allocating, a power of two, none
+   *               by default. A table of that many entries or less is
+   *               not indexed either.
+   */
+  template<typename _Key, typename _Tp
+          ,typename _Hash = std::hash<_Key>
+          ,typename _Pred = std::equal_to<_Key>
+          ,typename _Alloc = std::allocator<std::pair<_Key, _Tp>>
+          ,typename _IndexPolicy = __detail::_Chained_index_policy
+          ,std::size_t _Nm = 0>
+    class mapped_stack
+    {
+      using _Hashtable
+        = _ContainerHasher<_Key, _Alloc, _Key
+                         , mapped_revolver<_Key, _Tp, _Alloc, _Nm>
+                         , _Hash, _Pred, _IndexPolicy>;
+      _Hashtable _M_h;
+
+    public:
+      using key_type = _Key;
+      using mapped_type = _Tp;
+      using value_type = std::pair<_Key, _Tp>;
+      using hasher = typename _Hashtable::hasher;
+      using key_equal = typename _Hashtable::key_equal;
+      using allocator_type = typename _Hashtable::allocator_type;
+      using container_type = typename _Hashtable::container_type;
+      using size_type = typename _Hashtable::size_type;
+      using difference_type = typename _Hashtable::difference_type;
+      using iterator = __detail::_Mapped_iterator<_Hashtable, false>;
+      using const_iterator = __detail::_Mapped_iterator<_Hashtable, true>;
+      using reference = typename iterator::reference;
+      using const_reference = typename const_iterator::reference;
+
+      mapped_stack() = default;
+
+      explicit
+      mapped_stack(size_type __n
+                 , const hasher& __hf = hasher()
+                 , const key_equal& __eql = key_equal()
+                 , const allocator_type& __a = allocator_type())
+      : _M_h(__n, __hf, __eql, __a)
+      { }
+
+      // Pushes the pairs of [__first, __last), the first of equivalent
+      // keys only.
+      template<typename _InputIterator>
+        mapped_stack(_InputIterator __first, _InputIterator __last
+                   , size_type __n = 0
+                   , const hasher& __hf = hasher()
+                   , const key_equal& __eql = key_equal()
+                   , const allocator_type& __a = allocator_type())
+        : _M_h(__n, __hf, __eql, __a)
+        {
+          for (; __first != __last; ++__first)
+            _M_h.try_emplace_back((*__first).first, (*__first).second);
+        }
+
+      mapped_stack(std::initializer_list<value_type> __l
+                 , size_type __n = 0
+                 , const hasher& __hf = hasher()
+                 , const key_equal& __eql = key_equal()
+                 , const allocator_type& __a = allocator_type())
+      : mapped_stack(__l.begin(), __l.end(), __n, __hf, __eql, __a)
+      { }
+
+      mapped_stack(const mapped_stack&) = default;
+      mapped_stack(mapped_stack&&) = default;
+
+      // Every allocation of the container, both columns, index nodes and
+      // buckets, goes through a copy of @a __a.
+      explicit
+      mapped_stack(const allocator_type& __a)
+      : _M_h(__a)
+      { }
+
+      mapped_stack(size_type __n, const allocator_type& __a)
+      : mapped_stack(__n, hasher(), key_equal(), __a)
+      { }
+
+      mapped_stack(size_type __n, const hasher& __hf
+                 , const allocator_type& __a)
+      : mapped_stack(__n, __hf, key_equal(), __a)
+      { }
+
+      mapped_stack(const mapped_stack& __x, const allocator_type& __a)
+      : _M_h(__x._M_h, __a)
+      { }
+
+      mapped_stack(mapped_stack&& __x, const allocator_type& __a)
+      : _M_h(std::move(__x._M_h), __a)
+      { }
+
+      mapped_stack&
+      operator=(const mapped_stack&) = default;
+
+      mapped_stack&
+      operator=(mapped_stack&&) = default;
+
+      // iterators, bottom of the stack first
+      iterator
+      begin()
+      { return iterator(&_M_h, _M_h.begin()); }
+
+      const_iterator
+      begin() const
+      { return const_iterator(&_M_h, _M_h.begin()); }
+
+      iterator
+      end() noexcept
+      { return iterator(&_M_h, _M_h.end()); }
+
+      const_iterator
+      end() const noexcept
+      { return const_iterator(&_M_h, _M_h.end()); }
+
+      const_iterator
+      cbegin() const
+      { return begin(); }
+
+      const_iterator
+      cend() const noexcept
+      { return end(); }
+
+      // capacity
+      [[__nodiscard__]] bool
+      empty() const noexcept
+      { return _M_h.empty(); }
+
+      size_type
+      size() const noexcept
+      { return _M_h.size(); }
+
+      // element access
+      reference
+      top() noexcept
+      { return reference(_M_h.back(), _M_h.mapped_back()); }
+
+      const_reference
+      top() const noexcept
+      { return const_reference(_M_h.back(), _M_h.mapped_back()); }
+
+      // The mapped values alone, bottom of the stack first, as the column
+      // they lie in: a scan reads them densely and never touches the keys.
+      // Drops the holes first, which invalidates the iterators if there
+      // were any.
+      const typename container_type::mapped_column&
+      values()
+      { return _M_h.mapped_values(); }
+
+      // The mapped value of @a __k, throws std::out_of_range if @a __k is
+      // not stacked.
+      mapped_type&
+      at(const key_type& __k)
+      { return _M_h.mapped(_M_find_or_throw(__k)); }
+
+      const mapped_type&
+      at(const key_type& __k) const
+      { return _M_h.mapped(_M_find_or_throw(__k)); }
+
+      // modifiers
+      std::pair<iterator, bool>
+      push(const value_type& __x)
+      { return _M_wrap(_M_h.try_emplace_back(__x.first, __x.second)); }
+
+      std::pair<iterator, bool>
+      push(value_type&& __x)
+      {
+        return _M_wrap(_M_h.try_emplace_back(std::move(__x.first)
+                                           , std::move(__x.second)));
+      }
+
+      // The mapped value is constructed from __args only if __k is pushed.
+      template<typename... _Args>
+        std::pair<iterator, bool>
+        try_emplace(const key_type& __k, _Args&&... __args)
+        {
+          return _M_wrap(_M_h.try_emplace_back(__k
+                                             , std::forward<_Args>(__args)...));
+        }
+
+      template<typename... _Args>
+        std::pair<iterator, bool>
+        try_emplace(key_type&& __k, _Args&&... __args)
+        {
+          return _M_wrap(_M_h.try_emplace_back(std::move(__k)
+                                             , std::forward<_Args>(__args)...));
+        }
+
+      void
+      pop()
+      { _M_h.pop_back(); }
+
+      // Pops up to __n entries to __out, as value_type, top first.
+      template<typename _OutputIterator>
+        _OutputIterator
+        pop_n(size_type __n, _OutputIterator __out)
+        { return _M_h.pop_back_n(__n, __out); }
+
+      // Stacks the entry of __k again, on the top, with a single lookup.
+      // Returns end() if __k is not stacked.
+      iterator
+      move_to_top(const key_type& __k)
+      { return iterator(&_M_h, _M_h.move_to_back(__k)); }
+
+      std::optional<value_type>
+      extract(const key_type& __x)
+      { return _M_h.extract(__x); }
+
+      template<typename _Kt>
+        auto
+        extract(const _Kt& __x)
+        -> decltype(_M_h.extract(__x))
+        { return _M_h.extract(__x); }
+
+      size_type
+      erase(const key_type& __x)
+      { return _M_h.erase(__x); }
+
+      template<typename _Kt>
+        auto
+        erase(const _Kt& __x)
+        -> decltype(_M_h.erase(__x))
+        { return _M_h.erase(__x); }
+
+      void
+      clear() noexcept
+      { _M_h.clear(); }
+
+      void
+      swap(mapped_stack& __x) noexcept(noexcept(_M_h.swap(__x._M_h)))
+      { _M_h.swap(__x._M_h); }
+
+      // lookup, through the keys column only
+      iterator
+      find(const key_type& __x)
+      { return iterator(&_M_h, _M_h.find(__x)); }
+
+      const_iterator
+      find(const key_type& __x) const
+      { return const_iterator(&_M_h, _M_h.find(__x)); }
+
+      size_type
+      count(const key_type& __x) const
+      { return _M_h.count(__x); }
+
+      bool
+      contains(const key_type& __x) const
+      { return _M_h.contains(__x); }
+
+      // Heterogeneous lookup, with transparent hash and key equality types.
+      template<typename _Kt>
+        auto
+        find(const _Kt& __x)
+        -> decltype(_M_h.find(__x), iterator())
+        { return iterator(&_M_h, _M_h.find(__x)); }
+
+      template<typename _Kt>
+        auto
+        find(const _Kt& __x) const
+        -> decltype(_M_h.find(__x), const_iterator())
+        { return const_iterator(&_M_h, _M_h.find(__x)); }
+
+      template<typename _Kt>
+        auto
+        count(const _Kt& __x) const
+        -> decltype(_M_h.count(__x))
+        { return _M_h.count(__x); }
+
+      template<typename _Kt>
+        auto
+        contains(const _Kt& __x) const
+        -> decltype(_M_h.contains(__x))
+        { return _M_h.contains(__x); }
+
+      // Writes whether each key of [__first, __last) is in, to __out.
+      template<typename _ForwardIterator, typename _OutputIterator>
+        _OutputIterator
+        contains_batch(_ForwardIterator __first, _ForwardIterator __last
+                     , _OutputIterator __out) const
+        { return _M_h.contains_batch(__first, __last, __out); }
+
+      // hash policy
+      size_type
+      bucket_count() const noexcept
+      { return _M_h.bucket_count(); }
+
+      float
+      load_factor() const noexcept
+      { return _M_h.load_factor(); }
+
+      float
+      max_load_factor() const noexcept
+      { return _M_h.max_load_factor(); }
+
+      void
+      reserve(size_type __n)
+      { _M_h.reserve(__n); }
+
+      void
+      shrink_to_fit()
+      { _M_h.shrink_to_fit(); }
+
+      // With __detail::_Recording_index_policy only.  element_bytes counts
+      // both columns.
+      hashed_stats
+      stats() const noexcept
+      { return _M_h.stats(); }
+
+      // observers
+      allocator_type
+      get_allocator() const noexcept
+      { return _M_h.get_allocator(); }
+
+      hasher
+      hash_function() const
+      { return _M_h.hash_function(); }
+
+      key_equal
+      key_eq() const
+      { return _M_h.key_eq(); }
+
+    private:
+      std::pair<iterator, bool>
+      _M_wrap(std::pair<typename _Hashtable::iterator, bool> __r)
+      { return { iterator(&_M_h, __r.first), __r.second }; }
+
+      typename _Hashtable::const_iterator
+      _M_find_or_throw(const key_type& __k) const
+      {
+        const auto __it = _M_h.find(__k);
+        if (__it == _M_h.end())
+          std::__throw_out_of_range(__N("mapped_stack::at"));
+        return __it;
+      }
+    };
+
+  template<typename _Key, typename _Tp, typename _Hash, typename _Pred
+          ,typename _Alloc, typename _IndexPolicy, std::size_t _Nm>
+    inline void
+    swap(mapped_stack<_Key, _Tp, _Hash, _Pred, _Alloc, _IndexPolicy, _Nm>& __x
+       , mapped_stack<_Key, _Tp, _Hash, _Pred, _Alloc, _IndexPolicy, _Nm>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+  namespace pmr
+  {
+    template<typename _Key, typename _Tp
+            ,typename _Hash = std::hash<_Key>
+            ,typename _Pred = std::equal_to<_Key>
+            ,typename _IndexPolicy = __detail::_Chained_index_policy
+            ,std::size_t _Nm = 0>
+      using mapped_stack
+        = stl::mapped_stack<_Key, _Tp, _Hash, _Pred
+                           , std::pmr::polymorphic_allocator<
+                               std::pair<_Key, _Tp>>
+                           , _IndexPolicy, _Nm>;
+  } // namespace pmr
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // MAPPED_STACK_H
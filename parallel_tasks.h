@@ -0,0 +1,145 @@
+// Work split across threads for the hashed containers -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file bits/parallel_tasks.h
+ *  This is an internal header file, included by other library headers.
+ *  Do not attempt to use it directly.
+ *  @headername{hashed_stack, hashed_queue}
+ */
+
+#ifndef PARALLEL_TASKS_H
+#define PARALLEL_TASKS_H 1
+
+#pragma GCC system_header
+
+#include <algorithm>               // for std::min, std::max
+#include <cstddef>
+#include <exception>               // for std::exception_ptr
+#include <thread>
+#include <type_traits>
+#include <utility>                 // for std::pair
+#include <vector>
+// The execution policy types only: <execution> would pull in the
+// parallel algorithms and their backend.
+#include <pstl/execution_defs.h>
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+    /// @cond undocumented
+
+namespace __detail
+{
+/**
+  *  @addtogroup _ContainerHasher-detail
+  *  @{
+  */
+
+  // Whether _Policy is one of the std::execution policy types.
+  template<typename _Policy>
+    using __is_execution_policy
+      = __pstl::execution::is_execution_policy<std::decay_t<_Policy>>;
+
+  // Whether the execution policy _Policy lets the work run on several
+  // threads: par and par_unseq, not seq nor unseq.
+  template<typename _Policy>
+    using __allows_parallel
+      = decltype(std::decay_t<_Policy>::__allow_parallel());
+
+  /**
+   *  Threads worth starting for @a __n items, each taking @a __grain
+   *  items at least, up to one a core.  One means the caller does all
+   *  the work.
+   */
+  inline unsigned
+  __parallel_workers(std::size_t __n, std::size_t __grain) noexcept
+  {
+    const std::size_t __hw = std::max(1u, std::thread::hardware_concurrency());
+    return unsigned(std::min(__hw, std::max<std::size_t>(1, __n / __grain)));
+  }
+
+  // The part @a __t of @a __n items split evenly in @a __parts.
+  inline std::pair<std::size_t, std::size_t>
+  __parallel_chunk(std::size_t __n, std::size_t __parts
+                 , std::size_t __t) noexcept
+  { return { __n * __t / __parts, __n * (__t + 1) / __parts }; }
+
+  /**
+   *  @brief __parallel_run
+   *    Calls @a __f(t) for each t in [0, @a __workers), each on a thread
+   *    of its own, the caller running t = 0, and returns once they have
+   *    all returned.  The first exception thrown by a call, by order of
+   *    t, is rethrown then.
+   */
+  template<typename _Fn>
+    void
+    __parallel_run(unsigned __workers, _Fn&& __f)
+    {
+      if (__workers <= 1)
+        {
+          __f(0u);
+          return;
+        }
+
+      std::vector<std::exception_ptr> __errors(__workers);
+      auto __task = [&__f, &__errors](unsigned __t)
+        {
+          __try
+            {
+              __f(__t);
+            }
+          __catch(...)
+            {
+              __errors[__t] = std::current_exception();
+            }
+        };
+
+      std::vector<std::thread> __threads;
+      __threads.reserve(__workers - 1);
+      __try
+        {
+          for (unsigned __t = 1; __t != __workers; ++__t)
+            __threads.emplace_back(__task, __t);
+        }
+      __catch(...)
+        {
+          for (std::thread& __th : __threads)
+            __th.join();
+          __throw_exception_again;
+        }
+      __task(0);
+      for (std::thread& __th : __threads)
+        __th.join();
+      for (std::exception_ptr& __e : __errors)
+        if (__e)
+          std::rethrow_exception(__e);
+    }
+
+  ///@} _ContainerHasher-detail
+} // namespace __detail
+    /// @endcond
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // PARALLEL_TASKS_H
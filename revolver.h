@@ -0,0 +1,926 @@
+// revolver.h header -*- C++ -*-
+
+// Copyright (C) 2007-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * @file bits/revolver.h
+ * This is an internal header file, included by other headers.
+ * Do not attempt to use it directly.
+ * @headername{hashed_stack, hashed_queue}
+ */
+
+#ifndef REVOLVER_H
+#define REVOLVER_H 1
+
+#pragma GCC system_header
+
+#include <memory>            // allocator_traits, uninitialized algorithms
+#include <algorithm>         // min, equal
+#include <initializer_list>
+#include <iterator>          // reverse_iterator
+#include <stdexcept>         // out_of_range
+#include <cstring>           // memcpy
+#include <ext/alloc_traits.h>
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+namespace __detail
+{
+  /**
+   * @brief The _Revolver_iterator class
+   *    Random access iterator of the revolver. It holds the absolute index
+   *    of the element, the slot is found by masking it with the capacity.
+   */
+  template<typename _Tp, typename _Ref, typename _Ptr>
+  struct _Revolver_iterator
+  {
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = _Tp;
+    using difference_type = std::ptrdiff_t;
+    using pointer = _Ptr;
+    using reference = _Ref;
+
+    using __iterator = _Revolver_iterator<_Tp, _Tp&, _Tp*>;
+    using __index_type = std::size_t;
+
+    _Tp*         _M_buf = nullptr;
+    __index_type _M_mask = 0;
+    __index_type _M_idx = 0;
+
+    constexpr
+    _Revolver_iterator() noexcept = default;
+
+    constexpr
+    _Revolver_iterator(_Tp* __buf, __index_type __mask
+                     , __index_type __idx) noexcept
+    : _M_buf(__buf), _M_mask(__mask), _M_idx(__idx)
+    { }
+
+    // conversion from iterator to const_iterator
+    constexpr
+    _Revolver_iterator(const __iterator& __x) noexcept
+    : _M_buf(__x._M_buf), _M_mask(__x._M_mask), _M_idx(__x._M_idx)
+    { }
+
+    constexpr
+    reference
+    operator*() const noexcept
+    { return _M_buf[_M_idx & _M_mask]; }
+
+    constexpr
+    pointer
+    operator->() const noexcept
+    { return _M_buf + (_M_idx & _M_mask); }
+
+    constexpr
+    reference
+    operator[](difference_type __n) const noexcept
+    { return _M_buf[(_M_idx + __n) & _M_mask]; }
+
+    constexpr
+    _Revolver_iterator&
+    operator++() noexcept
+    {
+      ++_M_idx;
+      return *this;
+    }
+
+    constexpr
+    _Revolver_iterator
+    operator++(int) noexcept
+    {
+      auto __tmp = *this;
+      ++_M_idx;
+      return __tmp;
+    }
+
+    constexpr
+    _Revolver_iterator&
+    operator--() noexcept
+    {
+      --_M_idx;
+      return *this;
+    }
+
+    constexpr
+    _Revolver_iterator
+    operator--(int) noexcept
+    {
+      auto __tmp = *this;
+      --_M_idx;
+      return __tmp;
+    }
+
+    constexpr
+    _Revolver_iterator&
+    operator+=(difference_type __n) noexcept
+    {
+      _M_idx += __n;
+      return *this;
+    }
+
+    constexpr
+    _Revolver_iterator&
+    operator-=(difference_type __n) noexcept
+    {
+      _M_idx -= __n;
+      return *this;
+    }
+
+    friend constexpr
+    _Revolver_iterator
+    operator+(_Revolver_iterator __x, difference_type __n) noexcept
+    { return __x += __n; }
+
+    friend constexpr
+    _Revolver_iterator
+    operator+(difference_type __n, _Revolver_iterator __x) noexcept
+    { return __x += __n; }
+
+    friend constexpr
+    _Revolver_iterator
+    operator-(_Revolver_iterator __x, difference_type __n) noexcept
+    { return __x -= __n; }
+
+    // indices wrap around, only their distance is meaningful.
+    friend constexpr
+    difference_type
+    operator-(const _Revolver_iterator& __x
+            , const _Revolver_iterator& __y) noexcept
+    { return difference_type(__x._M_idx - __y._M_idx); }
+
+    friend constexpr
+    bool
+    operator==(const _Revolver_iterator& __x
+             , const _Revolver_iterator& __y) noexcept
+    { return __x._M_idx == __y._M_idx; }
+
+    friend constexpr
+    bool
+    operator!=(const _Revolver_iterator& __x
+             , const _Revolver_iterator& __y) noexcept
+    { return __x._M_idx != __y._M_idx; }
+
+    friend constexpr
+    bool
+    operator<(const _Revolver_iterator& __x
+            , const _Revolver_iterator& __y) noexcept
+    { return (__x - __y) < 0; }
+
+    friend constexpr
+    bool
+    operator>(const _Revolver_iterator& __x
+            , const _Revolver_iterator& __y) noexcept
+    { return __y < __x; }
+
+    friend constexpr
+    bool
+    operator<=(const _Revolver_iterator& __x
+             , const _Revolver_iterator& __y) noexcept
+    { return !(__y < __x); }
+
+    friend constexpr
+    bool
+    operator>=(const _Revolver_iterator& __x
+             , const _Revolver_iterator& __y) noexcept
+    { return !(__x < __y); }
+  };
+
+  // Inline slots of a revolver, where its elements live until they
+  // outgrow them. None by default.
+  template<typename _Tp, std::size_t _Nm>
+  struct _Revolver_local
+  {
+    alignas(_Tp) unsigned char _M_storage[_Nm * sizeof(_Tp)];
+
+    _Tp*
+    _M_local_buf() noexcept
+    { return reinterpret_cast<_Tp*>(_M_storage); }
+
+    const _Tp*
+    _M_local_buf() const noexcept
+    { return reinterpret_cast<const _Tp*>(_M_storage); }
+  };
+
+  template<typename _Tp>
+  struct _Revolver_local<_Tp, 0>
+  {
+    _Tp*
+    _M_local_buf() const noexcept
+    { return nullptr; }
+  };
+} // namespace __detail
+
+  /**
+   * @brief The revolver class
+   *    A circular buffer, the default inner container of _ContainerHasher.
+   *    capacity is 2^k (or 0 before the first insertion)
+   *    elements live in one contiguous allocation, and are addressed by an
+   *    absolute index: the slot of index i is (i & (capacity - 1)).
+   *    push_back(), push_front(), pop_back() and pop_front() are O(1) and
+   *    never move the other elements.
+   *    The index of an element never changes while it is in the
+   *    container, neither on pops nor when the buffer grows, so indices
+   *    can be stored in place of iterators (see _Hash_node_index_base).
+   *    operator[] counts from the front, like std::deque.
+   *    With _Nm inline slots, a power of two, the first _Nm elements need
+   *    no allocation: the capacity starts at _Nm, and moving or swapping
+   *    such a revolver moves its elements one by one.
+   */
+  template<typename _Tp, typename _Allocator, std::size_t _Nm>
+  class revolver
+  {
+    static_assert((_Nm & (_Nm - 1)) == 0
+                  , "revolver inline slots must be a power of two");
+
+    using _Tp_alloc_type =
+          typename __gnu_cxx::__alloc_traits<_Allocator>::template rebind<_Tp>::other;
+    using _Alloc_traits = __gnu_cxx::__alloc_traits<_Tp_alloc_type>;
+
+    // Whether moving the elements of the inline slots cannot throw.
+    static constexpr bool _S_nothrow_steal
+      = _Nm == 0 || std::is_nothrow_move_constructible<_Tp>::value;
+
+  public:
+    using value_type = _Tp;
+    using allocator_type = _Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = typename _Alloc_traits::pointer;
+    using const_pointer = typename _Alloc_traits::const_pointer;
+    using iterator = __detail::_Revolver_iterator<_Tp, _Tp&, _Tp*>;
+    using const_iterator =
+          __detail::_Revolver_iterator<_Tp, const _Tp&, const _Tp*>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using index_type = std::size_t;
+
+  private:
+    // We inherit from the allocator to benefit from the Zero size base
+    // struct optimization.
+    struct _Revolver_impl
+    : public _Tp_alloc_type
+    , public __detail::_Revolver_local<_Tp, _Nm>
+    {
+      _Tp*       _M_buf = this->_M_local_buf();
+      size_type  _M_cap = _Nm;
+      index_type _M_head = 0;   // index of the front element
+      index_type _M_tail = 0;   // index one past the back element
+
+      _Revolver_impl() = default;
+
+      _Revolver_impl(const _Tp_alloc_type& __a) noexcept
+      : _Tp_alloc_type(__a)
+      { }
+
+      _Revolver_impl(_Tp_alloc_type&& __a) noexcept
+      : _Tp_alloc_type(std::move(__a))
+      { }
+
+      void
+      _M_swap_data(_Revolver_impl& __x) noexcept
+      {
+        std::swap(_M_buf, __x._M_buf);
+        std::swap(_M_cap, __x._M_cap);
+        std::swap(_M_head, __x._M_head);
+        std::swap(_M_tail, __x._M_tail);
+      }
+    };
+
+    _Revolver_impl _M_impl;
+
+  public:
+    revolver() = default;
+
+    explicit
+    revolver(const allocator_type& __a) noexcept
+    : _M_impl(_Tp_alloc_type(__a))
+    { }
+
+    revolver(std::initializer_list<value_type> __l
+           , const allocator_type& __a = allocator_type())
+    : revolver(__a)
+    {
+      reserve(__l.size());
+      for (const value_type& __v : __l)
+        emplace_back(__v);
+    }
+
+    // The copy keeps the indices of the source elements.
+    revolver(const revolver& __x)
+    : _M_impl(_Alloc_traits::_S_select_on_copy(__x._M_get_Tp_allocator()))
+    { _M_copy_from(__x); }
+
+    revolver(const revolver& __x, const allocator_type& __a)
+    : _M_impl(_Tp_alloc_type(__a))
+    { _M_copy_from(__x); }
+
+    revolver(revolver&& __x) noexcept(_S_nothrow_steal)
+    : _M_impl(std::move(__x._M_get_Tp_allocator()))
+    { _M_steal(__x); }
+
+    revolver(revolver&& __x, const allocator_type& __a)
+    : _M_impl(_Tp_alloc_type(__a))
+    {
+      if (__x._M_get_Tp_allocator() == _M_get_Tp_allocator())
+        _M_steal(__x);
+      else
+        _M_move_from(__x);
+    }
+
+    ~revolver()
+    {
+      _M_destroy_elements();
+      _M_deallocate(_M_impl._M_buf, _M_impl._M_cap);
+    }
+
+    revolver&
+    operator=(const revolver& __x)
+    {
+      if (this == std::__addressof(__x))
+        return *this;
+      revolver __tmp(__x, _Alloc_traits::_S_propagate_on_copy_assign()
+                          ? __x._M_get_Tp_allocator()
+                          : _M_get_Tp_allocator());
+      _M_release();
+      std::__alloc_on_copy(_M_get_Tp_allocator(), __x._M_get_Tp_allocator());
+      _M_steal(__tmp);
+      return *this;
+    }
+
+    revolver&
+    operator=(revolver&& __x)
+    noexcept(_Alloc_traits::_S_nothrow_move() && _S_nothrow_steal)
+    {
+      if (_Alloc_traits::_S_propagate_on_move_assign()
+          || __x._M_get_Tp_allocator() == _M_get_Tp_allocator())
+        {
+          _M_release();
+          std::__alloc_on_move(_M_get_Tp_allocator()
+                             , __x._M_get_Tp_allocator());
+          _M_steal(__x);
+        }
+      else
+        {
+          revolver __tmp(std::move(__x), _M_get_Tp_allocator());
+          _M_release();
+          _M_steal(__tmp);
+        }
+      return *this;
+    }
+
+    allocator_type
+    get_allocator() const noexcept
+    { return allocator_type(_M_get_Tp_allocator()); }
+
+    // iterators
+    iterator
+    begin() noexcept
+    { return iterator(_M_impl._M_buf, _M_mask(), _M_impl._M_head); }
+
+    const_iterator
+    begin() const noexcept
+    { return const_iterator(_M_impl._M_buf, _M_mask(), _M_impl._M_head); }
+
+    iterator
+    end() noexcept
+    { return iterator(_M_impl._M_buf, _M_mask(), _M_impl._M_tail); }
+
+    const_iterator
+    end() const noexcept
+    { return const_iterator(_M_impl._M_buf, _M_mask(), _M_impl._M_tail); }
+
+    const_iterator
+    cbegin() const noexcept
+    { return begin(); }
+
+    const_iterator
+    cend() const noexcept
+    { return end(); }
+
+    reverse_iterator
+    rbegin() noexcept
+    { return reverse_iterator(end()); }
+
+    const_reverse_iterator
+    rbegin() const noexcept
+    { return const_reverse_iterator(end()); }
+
+    reverse_iterator
+    rend() noexcept
+    { return reverse_iterator(begin()); }
+
+    const_reverse_iterator
+    rend() const noexcept
+    { return const_reverse_iterator(begin()); }
+
+    // capacity
+    bool
+    empty() const noexcept
+    { return _M_impl._M_head == _M_impl._M_tail; }
+
+    size_type
+    size() const noexcept
+    { return _M_impl._M_tail - _M_impl._M_head; }
+
+    size_type
+    max_size() const noexcept
+    {
+      const size_type __max = _Alloc_traits::max_size(_M_get_Tp_allocator());
+      // the largest power of two fitting in __max
+      return size_type(1) << (std::__lg(__max));
+    }
+
+    size_type
+    capacity() const noexcept
+    { return _M_impl._M_cap; }
+
+    // may throw { std::length_error, std::bad_alloc }
+    void
+    reserve(size_type __n)
+    {
+      if (__n > max_size())
+        std::__throw_length_error(__N("revolver::reserve"));
+      if (__n > capacity())
+        _M_reallocate(_S_capacity_for(__n));
+    }
+
+    void
+    shrink_to_fit()
+    {
+      if (empty())
+        {
+          _M_deallocate(_M_impl._M_buf, _M_impl._M_cap);
+          _M_impl._M_buf = _M_impl._M_local_buf();
+          _M_impl._M_cap = _Nm;
+        }
+      else if (_S_capacity_for(size()) < capacity())
+        _M_reallocate(_S_capacity_for(size()));
+    }
+
+    // element access, counted from the front
+    reference
+    operator[](size_type __n) noexcept
+    { return at_index(_M_impl._M_head + __n); }
+
+    const_reference
+    operator[](size_type __n) const noexcept
+    { return at_index(_M_impl._M_head + __n); }
+
+    reference
+    at(size_type __n)
+    {
+      _M_range_check(__n);
+      return (*this)[__n];
+    }
+
+    const_reference
+    at(size_type __n) const
+    {
+      _M_range_check(__n);
+      return (*this)[__n];
+    }
+
+    reference
+    front() noexcept
+    { return at_index(_M_impl._M_head); }
+
+    const_reference
+    front() const noexcept
+    { return at_index(_M_impl._M_head); }
+
+    reference
+    back() noexcept
+    { return at_index(_M_impl._M_tail - 1); }
+
+    const_reference
+    back() const noexcept
+    { return at_index(_M_impl._M_tail - 1); }
+
+    // element access through absolute indices
+    index_type
+    front_index() const noexcept
+    { return _M_impl._M_head; }
+
+    index_type
+    back_index() const noexcept
+    { return _M_impl._M_tail - 1; }
+
+    // index the next push_back() will use
+    index_type
+    end_index() const noexcept
+    { return _M_impl._M_tail; }
+
+    bool
+    contains_index(index_type __i) const noexcept
+    { return __i - _M_impl._M_head < size(); }
+
+    // It is the responsability of the caller to give the index of an
+    // element in the container, see contains_index().
+    reference
+    at_index(index_type __i) noexcept
+    { return _M_impl._M_buf[__i & _M_mask()]; }
+
+    const_reference
+    at_index(index_type __i) const noexcept
+    { return _M_impl._M_buf[__i & _M_mask()]; }
+
+    // modifiers
+    template<typename... _Args>
+      reference
+      emplace_back(_Args&&... __args)
+      {
+        if (size() == capacity())
+          _M_realloc_insert(_M_impl._M_tail, std::forward<_Args>(__args)...);
+        else
+          _Alloc_traits::construct(_M_impl, _M_slot(_M_impl._M_tail)
+                                 , std::forward<_Args>(__args)...);
+        ++_M_impl._M_tail;
+        return back();
+      }
+
+    template<typename... _Args>
+      reference
+      emplace_front(_Args&&... __args)
+      {
+        if (size() == capacity())
+          _M_realloc_insert(_M_impl._M_head - 1
+                          , std::forward<_Args>(__args)...);
+        else
+          _Alloc_traits::construct(_M_impl, _M_slot(_M_impl._M_head - 1)
+                                 , std::forward<_Args>(__args)...);
+        --_M_impl._M_head;
+        return front();
+      }
+
+    void
+    push_back(const value_type& __x)
+    { emplace_back(__x); }
+
+    void
+    push_back(value_type&& __x)
+    { emplace_back(std::move(__x)); }
+
+    void
+    push_front(const value_type& __x)
+    { emplace_front(__x); }
+
+    void
+    push_front(value_type&& __x)
+    { emplace_front(std::move(__x)); }
+
+    void
+    pop_back() noexcept
+    {
+      --_M_impl._M_tail;
+      _Alloc_traits::destroy(_M_impl, _M_slot(_M_impl._M_tail));
+    }
+
+    void
+    pop_front() noexcept
+    {
+      _Alloc_traits::destroy(_M_impl, _M_slot(_M_impl._M_head));
+      ++_M_impl._M_head;
+    }
+
+    // Keeps the capacity, and the indices keep counting from where they
+    // were.
+    void
+    clear() noexcept
+    {
+      _M_destroy_elements();
+      _M_impl._M_head = _M_impl._M_tail;
+    }
+
+    void
+    swap(revolver& __x) noexcept(_S_nothrow_steal)
+    {
+      if (!_M_is_local() && !__x._M_is_local())
+        _M_impl._M_swap_data(__x._M_impl);
+      else
+        {
+          revolver __tmp(std::move(__x));
+          __x._M_steal(*this);
+          _M_steal(__tmp);
+        }
+      _Alloc_traits::_S_on_swap(_M_get_Tp_allocator()
+                              , __x._M_get_Tp_allocator());
+    }
+
+  private:
+    _Tp_alloc_type&
+    _M_get_Tp_allocator() noexcept
+    { return _M_impl; }
+
+    const _Tp_alloc_type&
+    _M_get_Tp_allocator() const noexcept
+    { return _M_impl; }
+
+    size_type
+    _M_mask() const noexcept
+    { return _M_impl._M_cap - 1; }
+
+    _Tp*
+    _M_slot(index_type __i) const noexcept
+    { return _M_impl._M_buf + (__i & _M_mask()); }
+
+    // never less than the inline slots
+    static size_type
+    _S_capacity_for(size_type __n) noexcept
+    {
+      size_type __cap = _Nm ? _Nm : 1;
+      while (__cap < __n)
+        __cap <<= 1;
+      return __cap;
+    }
+
+    bool
+    _M_is_local() const noexcept
+    { return _Nm != 0 && _M_impl._M_buf == _M_impl._M_local_buf(); }
+
+    void
+    _M_range_check(size_type __n) const
+    {
+      if (__n >= size())
+        std::__throw_out_of_range_fmt(__N("revolver::_M_range_check: __n "
+                                          "(which is %zu) >= this->size() "
+                                          "(which is %zu)"), __n, size());
+    }
+
+    // A buffer of _Nm slots is the inline one, only ever asked for while
+    // the elements are elsewhere.
+    _Tp*
+    _M_allocate(size_type __n)
+    {
+      if (_Nm != 0 && __n == _Nm)
+        return _M_impl._M_local_buf();
+      return std::__to_address(_Alloc_traits::allocate(_M_impl, __n));
+    }
+
+    void
+    _M_deallocate(_Tp* __p, size_type __n) noexcept
+    {
+      if (__p && __p != _M_impl._M_local_buf())
+        _Alloc_traits::deallocate(_M_impl, __p, __n);
+    }
+
+    // Destroys the elements and frees the buffer, the inline slots are
+    // the storage again.
+    void
+    _M_release() noexcept
+    {
+      _M_destroy_elements();
+      _M_deallocate(_M_impl._M_buf, _M_impl._M_cap);
+      _M_impl._M_buf = _M_impl._M_local_buf();
+      _M_impl._M_cap = _Nm;
+      _M_impl._M_head = _M_impl._M_tail = 0;
+    }
+
+    /**
+     * @brief _M_steal
+     *    Takes the elements of @a __x, at the same indices, and leaves it
+     *    empty on its inline slots. An allocated buffer changes hands, the
+     *    elements of inline slots are moved one by one. This revolver
+     *    must be empty on its inline slots, with an allocator equal to
+     *    the one of @a __x.
+     */
+    void
+    _M_steal(revolver& __x) noexcept(_S_nothrow_steal)
+    {
+      if (!__x._M_is_local())
+        {
+          _M_impl._M_buf = std::__exchange(__x._M_impl._M_buf
+                                         , __x._M_impl._M_local_buf());
+          _M_impl._M_cap = std::__exchange(__x._M_impl._M_cap, _Nm);
+          _M_impl._M_head = std::__exchange(__x._M_impl._M_head, 0);
+          _M_impl._M_tail = std::__exchange(__x._M_impl._M_tail, 0);
+          return;
+        }
+      _M_impl._M_head = _M_impl._M_tail = __x._M_impl._M_head;
+      __try
+        {
+          for (; _M_impl._M_tail != __x._M_impl._M_tail; ++_M_impl._M_tail)
+            _Alloc_traits::construct(_M_impl, _M_slot(_M_impl._M_tail)
+                                   , std::move(__x.at_index(_M_impl._M_tail)));
+        }
+      __catch(...)
+        {
+          _M_destroy_elements();
+          _M_impl._M_head = _M_impl._M_tail = 0;
+          __throw_exception_again;
+        }
+      __x._M_destroy_elements();
+      __x._M_impl._M_head = __x._M_impl._M_tail = 0;
+    }
+
+    void
+    _M_destroy_elements() noexcept
+    {
+      if constexpr (!std::is_trivially_destructible<_Tp>::value)
+        for (index_type __i = _M_impl._M_head; __i != _M_impl._M_tail; ++__i)
+          _Alloc_traits::destroy(_M_impl, _M_slot(__i));
+    }
+
+    /**
+     * @brief _M_relocate
+     *    Moves the elements into a buffer of capacity @a __cap, each one
+     *    to the slot its index masks to. The elements are contiguous runs
+     *    in both buffers, at most three of them; trivially copyable types
+     *    are copied a run at a time.
+     *    Strong guarantee: if a copy throws, the new buffer is cleaned up
+     *    and the elements stay where they were.
+     */
+    void
+    _M_relocate(_Tp* __buf, size_type __cap)
+    {
+      const size_type __omask = _M_mask(), __nmask = __cap - 1;
+      index_type __i = _M_impl._M_head;
+      if constexpr (std::is_trivially_copyable<_Tp>::value)
+        while (__i != _M_impl._M_tail)
+          {
+            const size_type __o = __i & __omask, __n = __i & __nmask;
+            const size_type __run = std::min({ size_type(_M_impl._M_tail - __i)
+                                             , _M_impl._M_cap - __o
+                                             , __cap - __n });
+            std::memcpy(__buf + __n, _M_impl._M_buf + __o, __run * sizeof(_Tp));
+            __i += __run;
+          }
+      else
+        {
+          __try
+            {
+              for (; __i != _M_impl._M_tail; ++__i)
+                _Alloc_traits::construct(_M_impl, __buf + (__i & __nmask)
+                                , std::move_if_noexcept(*_M_slot(__i)));
+            }
+          __catch(...)
+            {
+              for (index_type __j = _M_impl._M_head; __j != __i; ++__j)
+                _Alloc_traits::destroy(_M_impl, __buf + (__j & __nmask));
+              __throw_exception_again;
+            }
+          _M_destroy_elements();
+        }
+    }
+
+    void
+    _M_reallocate(size_type __cap)
+    {
+      _Tp* __buf = _M_allocate(__cap);
+      __try
+        {
+          _M_relocate(__buf, __cap);
+        }
+      __catch(...)
+        {
+          _M_deallocate(__buf, __cap);
+          __throw_exception_again;
+        }
+      _M_deallocate(_M_impl._M_buf, _M_impl._M_cap);
+      _M_impl._M_buf = __buf;
+      _M_impl._M_cap = __cap;
+    }
+
+    // The new element is constructed first, __args may refer to an element
+    // of this container.
+    template<typename... _Args>
+      void
+      _M_realloc_insert(index_type __at, _Args&&... __args)
+      {
+        if (size() == max_size())
+          std::__throw_length_error(__N("revolver::_M_realloc_insert"));
+        const size_type __cap = _M_impl._M_cap ? _M_impl._M_cap * 2 : 1;
+        _Tp* __buf = _M_allocate(__cap);
+        _Tp* __pos = __buf + (__at & (__cap - 1));
+        __try
+          {
+            _Alloc_traits::construct(_M_impl, __pos
+                                   , std::forward<_Args>(__args)...);
+          }
+        __catch(...)
+          {
+            _M_deallocate(__buf, __cap);
+            __throw_exception_again;
+          }
+        __try
+          {
+            _M_relocate(__buf, __cap);
+          }
+        __catch(...)
+          {
+            _Alloc_traits::destroy(_M_impl, __pos);
+            _M_deallocate(__buf, __cap);
+            __throw_exception_again;
+          }
+        _M_deallocate(_M_impl._M_buf, _M_impl._M_cap);
+        _M_impl._M_buf = __buf;
+        _M_impl._M_cap = __cap;
+      }
+
+    void
+    _M_copy_from(const revolver& __x)
+    {
+      if (__x.empty())
+        {
+          _M_impl._M_head = _M_impl._M_tail = __x._M_impl._M_tail;
+          return;
+        }
+      const size_type __cap = _S_capacity_for(__x.size());
+      _M_impl._M_buf = _M_allocate(__cap);
+      _M_impl._M_cap = __cap;
+      _M_impl._M_head = _M_impl._M_tail = __x._M_impl._M_head;
+      __try
+        {
+          for (; _M_impl._M_tail != __x._M_impl._M_tail; ++_M_impl._M_tail)
+            _Alloc_traits::construct(_M_impl, _M_slot(_M_impl._M_tail)
+                                   , __x.at_index(_M_impl._M_tail));
+        }
+      __catch(...)
+        {
+          _M_destroy_elements();
+          _M_deallocate(_M_impl._M_buf, _M_impl._M_cap);
+          _M_impl._M_buf = _M_impl._M_local_buf();
+          _M_impl._M_cap = _Nm;
+          __throw_exception_again;
+        }
+    }
+
+    void
+    _M_move_from(revolver& __x)
+    {
+      if (__x.empty())
+        {
+          _M_impl._M_head = _M_impl._M_tail = __x._M_impl._M_tail;
+          return;
+        }
+      const size_type __cap = _S_capacity_for(__x.size());
+      _M_impl._M_buf = _M_allocate(__cap);
+      _M_impl._M_cap = __cap;
+      _M_impl._M_head = _M_impl._M_tail = __x._M_impl._M_head;
+      __try
+        {
+          for (; _M_impl._M_tail != __x._M_impl._M_tail; ++_M_impl._M_tail)
+            _Alloc_traits::construct(_M_impl, _M_slot(_M_impl._M_tail)
+                                   , std::move(__x.at_index(_M_impl._M_tail)));
+        }
+      __catch(...)
+        {
+          _M_destroy_elements();
+          _M_deallocate(_M_impl._M_buf, _M_impl._M_cap);
+          _M_impl._M_buf = _M_impl._M_local_buf();
+          _M_impl._M_cap = _Nm;
+          __throw_exception_again;
+        }
+      __x.clear();
+    }
+  };
+
+  template<typename _Tp, typename _Alloc, std::size_t _Nm>
+    inline bool
+    operator==(const revolver<_Tp, _Alloc, _Nm>& __x
+             , const revolver<_Tp, _Alloc, _Nm>& __y)
+    {
+      return __x.size() == __y.size()
+             && std::equal(__x.begin(), __x.end(), __y.begin());
+    }
+
+  template<typename _Tp, typename _Alloc, std::size_t _Nm>
+    inline bool
+    operator!=(const revolver<_Tp, _Alloc, _Nm>& __x
+             , const revolver<_Tp, _Alloc, _Nm>& __y)
+    { return !(__x == __y); }
+
+  template<typename _Tp, typename _Alloc, std::size_t _Nm>
+    inline void
+    swap(revolver<_Tp, _Alloc, _Nm>& __x, revolver<_Tp, _Alloc, _Nm>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // REVOLVER_H
@@ -0,0 +1,745 @@
+// segmented_revolver.h header -*- C++ -*-
+
+// Copyright (C) 2007-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * @file bits/segmented_revolver.h
+ * This is an internal header file, included by other headers.
+ * Do not attempt to use it directly.
+ * @headername{hashed_stack, hashed_queue}
+ */
+
+#ifndef SEGMENTED_REVOLVER_H
+#define SEGMENTED_REVOLVER_H 1
+
+#pragma GCC system_header
+
+#include <memory>            // allocator_traits
+#include <algorithm>         // min, equal
+#include <iterator>          // reverse_iterator
+#include <stdexcept>         // out_of_range
+#include <ext/alloc_traits.h>
+#include "hasher.h"          // for the forward declaration
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+namespace __detail
+{
+  /**
+   * @brief The _Segmented_iterator class
+   *    Random access iterator of the segmented_revolver. It holds the
+   *    absolute index of the element and the segment directory, which the
+   *    index is split against.  Growing the directory invalidates it.
+   */
+  template<typename _Tp, typename _Ref, typename _Ptr, std::size_t _Seg>
+  struct _Segmented_iterator
+  {
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = _Tp;
+    using difference_type = std::ptrdiff_t;
+    using pointer = _Ptr;
+    using reference = _Ref;
+
+    using __iterator = _Segmented_iterator<_Tp, _Tp&, _Tp*, _Seg>;
+    using __index_type = std::size_t;
+
+    _Tp* const*  _M_map = nullptr;
+    __index_type _M_mask = 0;
+    __index_type _M_idx = 0;
+
+    constexpr
+    _Segmented_iterator() noexcept = default;
+
+    constexpr
+    _Segmented_iterator(_Tp* const* __map, __index_type __mask
+                      , __index_type __idx) noexcept
+    : _M_map(__map), _M_mask(__mask), _M_idx(__idx)
+    { }
+
+    // conversion from iterator to const_iterator
+    constexpr
+    _Segmented_iterator(const __iterator& __x) noexcept
+    : _M_map(__x._M_map), _M_mask(__x._M_mask), _M_idx(__x._M_idx)
+    { }
+
+    constexpr
+    reference
+    operator*() const noexcept
+    { return _M_map[(_M_idx / _Seg) & _M_mask][_M_idx % _Seg]; }
+
+    constexpr
+    pointer
+    operator->() const noexcept
+    { return std::__addressof(**this); }
+
+    constexpr
+    reference
+    operator[](difference_type __n) const noexcept
+    { return *(*this + __n); }
+
+    constexpr
+    _Segmented_iterator&
+    operator++() noexcept
+    {
+      ++_M_idx;
+      return *this;
+    }
+
+    constexpr
+    _Segmented_iterator
+    operator++(int) noexcept
+    {
+      auto __tmp = *this;
+      ++_M_idx;
+      return __tmp;
+    }
+
+    constexpr
+    _Segmented_iterator&
+    operator--() noexcept
+    {
+      --_M_idx;
+      return *this;
+    }
+
+    constexpr
+    _Segmented_iterator
+    operator--(int) noexcept
+    {
+      auto __tmp = *this;
+      --_M_idx;
+      return __tmp;
+    }
+
+    constexpr
+    _Segmented_iterator&
+    operator+=(difference_type __n) noexcept
+    {
+      _M_idx += __n;
+      return *this;
+    }
+
+    constexpr
+    _Segmented_iterator&
+    operator-=(difference_type __n) noexcept
+    {
+      _M_idx -= __n;
+      return *this;
+    }
+
+    friend constexpr
+    _Segmented_iterator
+    operator+(_Segmented_iterator __x, difference_type __n) noexcept
+    { return __x += __n; }
+
+    friend constexpr
+    _Segmented_iterator
+    operator+(difference_type __n, _Segmented_iterator __x) noexcept
+    { return __x += __n; }
+
+    friend constexpr
+    _Segmented_iterator
+    operator-(_Segmented_iterator __x, difference_type __n) noexcept
+    { return __x -= __n; }
+
+    // indices wrap around, only their distance is meaningful.
+    friend constexpr
+    difference_type
+    operator-(const _Segmented_iterator& __x
+            , const _Segmented_iterator& __y) noexcept
+    { return difference_type(__x._M_idx - __y._M_idx); }
+
+    friend constexpr
+    bool
+    operator==(const _Segmented_iterator& __x
+             , const _Segmented_iterator& __y) noexcept
+    { return __x._M_idx == __y._M_idx; }
+
+    friend constexpr
+    bool
+    operator!=(const _Segmented_iterator& __x
+             , const _Segmented_iterator& __y) noexcept
+    { return __x._M_idx != __y._M_idx; }
+
+    friend constexpr
+    bool
+    operator<(const _Segmented_iterator& __x
+            , const _Segmented_iterator& __y) noexcept
+    { return (__x - __y) < 0; }
+
+    friend constexpr
+    bool
+    operator>(const _Segmented_iterator& __x
+            , const _Segmented_iterator& __y) noexcept
+    { return __y < __x; }
+
+    friend constexpr
+    bool
+    operator<=(const _Segmented_iterator& __x
+             , const _Segmented_iterator& __y) noexcept
+    { return !(__y < __x); }
+
+    friend constexpr
+    bool
+    operator>=(const _Segmented_iterator& __x
+             , const _Segmented_iterator& __y) noexcept
+    { return !(__x < __y); }
+  };
+} // namespace __detail
+
+  /**
+   * @brief The segmented_revolver class
+   *    A revolver whose slots come in segments of _Seg elements, a power
+   *    of two, found through a directory of segments, itself a ring:
+   *    the slot of index i is slot (i % _Seg) of the segment of number
+   *    (i / _Seg).
+   *    Growing allocates one more segment, and at times a larger
+   *    directory, which holds pointers only: no element is ever moved,
+   *    and no growth needs twice the memory of the elements.
+   *    As with revolver, the index of an element never changes while it
+   *    is in the container, and push_back(), pop_back() and pop_front()
+   *    are O(1).  A segment emptied by the pops goes back to the
+   *    allocator, but for one kept aside for the next segment needed;
+   *    shrink_to_fit() frees that one too.
+   *    Unlike the revolver's, the storage of the elements is not one
+   *    array, lookups scanning them go a segment at a time.
+   */
+  template<typename _Tp, typename _Allocator, std::size_t _Seg>
+  class segmented_revolver
+  {
+    static_assert(_Seg != 0 && (_Seg & (_Seg - 1)) == 0
+                  , "segmented_revolver segments must be a power of two");
+
+    using _Tp_alloc_type =
+          typename __gnu_cxx::__alloc_traits<_Allocator>::template rebind<_Tp>::other;
+    using _Alloc_traits = __gnu_cxx::__alloc_traits<_Tp_alloc_type>;
+    using _Map_alloc_type =
+          typename _Alloc_traits::template rebind<_Tp*>::other;
+    using _Map_alloc_traits = __gnu_cxx::__alloc_traits<_Map_alloc_type>;
+
+  public:
+    using value_type = _Tp;
+    using allocator_type = _Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = typename _Alloc_traits::pointer;
+    using const_pointer = typename _Alloc_traits::const_pointer;
+    using iterator = __detail::_Segmented_iterator<_Tp, _Tp&, _Tp*, _Seg>;
+    using const_iterator =
+          __detail::_Segmented_iterator<_Tp, const _Tp&, const _Tp*, _Seg>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using index_type = std::size_t;
+
+    static constexpr size_type segment_size = _Seg;
+
+  private:
+    // We inherit from the allocator to benefit from the Zero size base
+    // struct optimization.
+    struct _Segmented_impl
+    : public _Tp_alloc_type
+    {
+      _Tp**      _M_map = nullptr;
+      size_type  _M_map_cap = 0;   // directory slots, 2^k or 0
+      _Tp*       _M_spare = nullptr;
+      index_type _M_head = 0;      // index of the front element
+      index_type _M_tail = 0;      // index one past the back element
+
+      _Segmented_impl() = default;
+
+      _Segmented_impl(const _Tp_alloc_type& __a) noexcept
+      : _Tp_alloc_type(__a)
+      { }
+
+      _Segmented_impl(_Tp_alloc_type&& __a) noexcept
+      : _Tp_alloc_type(std::move(__a))
+      { }
+
+      void
+      _M_swap_data(_Segmented_impl& __x) noexcept
+      {
+        std::swap(_M_map, __x._M_map);
+        std::swap(_M_map_cap, __x._M_map_cap);
+        std::swap(_M_spare, __x._M_spare);
+        std::swap(_M_head, __x._M_head);
+        std::swap(_M_tail, __x._M_tail);
+      }
+    };
+
+    _Segmented_impl _M_impl;
+
+  public:
+    segmented_revolver() = default;
+
+    explicit
+    segmented_revolver(const allocator_type& __a) noexcept
+    : _M_impl(_Tp_alloc_type(__a))
+    { }
+
+    // The copy keeps the indices of the source elements.
+    segmented_revolver(const segmented_revolver& __x)
+    : _M_impl(_Alloc_traits::_S_select_on_copy(__x._M_get_Tp_allocator()))
+    { _M_append_from(__x, [](const _Tp& __v) -> const _Tp& { return __v; }); }
+
+    segmented_revolver(const segmented_revolver& __x
+                     , const allocator_type& __a)
+    : _M_impl(_Tp_alloc_type(__a))
+    { _M_append_from(__x, [](const _Tp& __v) -> const _Tp& { return __v; }); }
+
+    segmented_revolver(segmented_revolver&& __x) noexcept
+    : _M_impl(std::move(__x._M_get_Tp_allocator()))
+    { _M_impl._M_swap_data(__x._M_impl); }
+
+    segmented_revolver(segmented_revolver&& __x, const allocator_type& __a)
+    : _M_impl(_Tp_alloc_type(__a))
+    {
+      if (__x._M_get_Tp_allocator() == _M_get_Tp_allocator())
+        _M_impl._M_swap_data(__x._M_impl);
+      else
+        {
+          _M_append_from(__x
+                       , [](_Tp& __v) -> _Tp&& { return std::move(__v); });
+          __x.clear();
+        }
+    }
+
+    ~segmented_revolver()
+    { _M_release(); }
+
+    segmented_revolver&
+    operator=(const segmented_revolver& __x)
+    {
+      if (this == std::__addressof(__x))
+        return *this;
+      segmented_revolver __tmp(__x
+                             , _Alloc_traits::_S_propagate_on_copy_assign()
+                               ? __x._M_get_Tp_allocator()
+                               : _M_get_Tp_allocator());
+      _M_release();
+      std::__alloc_on_copy(_M_get_Tp_allocator(), __x._M_get_Tp_allocator());
+      _M_impl._M_swap_data(__tmp._M_impl);
+      return *this;
+    }
+
+    segmented_revolver&
+    operator=(segmented_revolver&& __x)
+    noexcept(_Alloc_traits::_S_nothrow_move())
+    {
+      if (_Alloc_traits::_S_propagate_on_move_assign()
+          || __x._M_get_Tp_allocator() == _M_get_Tp_allocator())
+        {
+          _M_release();
+          std::__alloc_on_move(_M_get_Tp_allocator()
+                             , __x._M_get_Tp_allocator());
+          _M_impl._M_swap_data(__x._M_impl);
+        }
+      else
+        {
+          segmented_revolver __tmp(std::move(__x), _M_get_Tp_allocator());
+          _M_release();
+          _M_impl._M_swap_data(__tmp._M_impl);
+        }
+      return *this;
+    }
+
+    allocator_type
+    get_allocator() const noexcept
+    { return allocator_type(_M_get_Tp_allocator()); }
+
+    // iterators
+    iterator
+    begin() noexcept
+    { return iterator(_M_impl._M_map, _M_map_mask(), _M_impl._M_head); }
+
+    const_iterator
+    begin() const noexcept
+    { return const_iterator(_M_impl._M_map, _M_map_mask(), _M_impl._M_head); }
+
+    iterator
+    end() noexcept
+    { return iterator(_M_impl._M_map, _M_map_mask(), _M_impl._M_tail); }
+
+    const_iterator
+    end() const noexcept
+    { return const_iterator(_M_impl._M_map, _M_map_mask(), _M_impl._M_tail); }
+
+    const_iterator
+    cbegin() const noexcept
+    { return begin(); }
+
+    const_iterator
+    cend() const noexcept
+    { return end(); }
+
+    reverse_iterator
+    rbegin() noexcept
+    { return reverse_iterator(end()); }
+
+    const_reverse_iterator
+    rbegin() const noexcept
+    { return const_reverse_iterator(end()); }
+
+    reverse_iterator
+    rend() noexcept
+    { return reverse_iterator(begin()); }
+
+    const_reverse_iterator
+    rend() const noexcept
+    { return const_reverse_iterator(begin()); }
+
+    // capacity
+    bool
+    empty() const noexcept
+    { return _M_impl._M_head == _M_impl._M_tail; }
+
+    size_type
+    size() const noexcept
+    { return _M_impl._M_tail - _M_impl._M_head; }
+
+    size_type
+    max_size() const noexcept
+    { return _Alloc_traits::max_size(_M_get_Tp_allocator()); }
+
+    // Slots of the segments held, the one kept aside included.
+    size_type
+    capacity() const noexcept
+    { return (_M_segments() + (_M_impl._M_spare != nullptr)) * _Seg; }
+
+    // Frees the segment kept aside, and the directory slots unused.
+    void
+    shrink_to_fit()
+    {
+      _M_free_segment(std::__exchange(_M_impl._M_spare, nullptr));
+      size_type __cap = 1;
+      while (__cap < _M_segments())
+        __cap <<= 1;
+      if (empty())
+        __cap = 0;
+      if (__cap < _M_impl._M_map_cap)
+        _M_remap(__cap);
+    }
+
+    // element access, counted from the front
+    reference
+    operator[](size_type __n) noexcept
+    { return at_index(_M_impl._M_head + __n); }
+
+    const_reference
+    operator[](size_type __n) const noexcept
+    { return at_index(_M_impl._M_head + __n); }
+
+    reference
+    at(size_type __n)
+    {
+      _M_range_check(__n);
+      return (*this)[__n];
+    }
+
+    const_reference
+    at(size_type __n) const
+    {
+      _M_range_check(__n);
+      return (*this)[__n];
+    }
+
+    reference
+    front() noexcept
+    { return at_index(_M_impl._M_head); }
+
+    const_reference
+    front() const noexcept
+    { return at_index(_M_impl._M_head); }
+
+    reference
+    back() noexcept
+    { return at_index(_M_impl._M_tail - 1); }
+
+    const_reference
+    back() const noexcept
+    { return at_index(_M_impl._M_tail - 1); }
+
+    // element access through absolute indices
+    index_type
+    front_index() const noexcept
+    { return _M_impl._M_head; }
+
+    index_type
+    back_index() const noexcept
+    { return _M_impl._M_tail - 1; }
+
+    // index the next push_back() will use
+    index_type
+    end_index() const noexcept
+    { return _M_impl._M_tail; }
+
+    bool
+    contains_index(index_type __i) const noexcept
+    { return __i - _M_impl._M_head < size(); }
+
+    // It is the responsability of the caller to give the index of an
+    // element in the container, see contains_index().
+    reference
+    at_index(index_type __i) noexcept
+    { return *_M_slot(__i); }
+
+    const_reference
+    at_index(index_type __i) const noexcept
+    { return *_M_slot(__i); }
+
+    // modifiers
+    template<typename... _Args>
+      reference
+      emplace_back(_Args&&... __args)
+      {
+        const index_type __i = _M_impl._M_tail;
+        const bool __fresh = empty() || __i % _Seg == 0;
+        if (__fresh)
+          _M_add_segment(__i / _Seg);
+        __try
+          {
+            _Alloc_traits::construct(_M_impl, _M_slot(__i)
+                                   , std::forward<_Args>(__args)...);
+          }
+        __catch(...)
+          {
+            if (__fresh)
+              _M_drop_segment(__i / _Seg);
+            __throw_exception_again;
+          }
+        ++_M_impl._M_tail;
+        return back();
+      }
+
+    void
+    push_back(const value_type& __x)
+    { emplace_back(__x); }
+
+    void
+    push_back(value_type&& __x)
+    { emplace_back(std::move(__x)); }
+
+    void
+    pop_back() noexcept
+    {
+      const index_type __i = --_M_impl._M_tail;
+      _Alloc_traits::destroy(_M_impl, _M_slot(__i));
+      if (empty() || __i % _Seg == 0)
+        _M_drop_segment(__i / _Seg);
+    }
+
+    void
+    pop_front() noexcept
+    {
+      const index_type __i = _M_impl._M_head++;
+      _Alloc_traits::destroy(_M_impl, _M_slot(__i));
+      if (empty() || _M_impl._M_head % _Seg == 0)
+        _M_drop_segment(__i / _Seg);
+    }
+
+    // Keeps a segment aside, and the indices keep counting from where
+    // they were.
+    void
+    clear() noexcept
+    {
+      while (!empty())
+        pop_back();
+    }
+
+    void
+    swap(segmented_revolver& __x) noexcept
+    {
+      _M_impl._M_swap_data(__x._M_impl);
+      _Alloc_traits::_S_on_swap(_M_get_Tp_allocator()
+                              , __x._M_get_Tp_allocator());
+    }
+
+  private:
+    _Tp_alloc_type&
+    _M_get_Tp_allocator() noexcept
+    { return _M_impl; }
+
+    const _Tp_alloc_type&
+    _M_get_Tp_allocator() const noexcept
+    { return _M_impl; }
+
+    size_type
+    _M_map_mask() const noexcept
+    { return _M_impl._M_map_cap - 1; }
+
+    _Tp*
+    _M_slot(index_type __i) const noexcept
+    { return _M_impl._M_map[(__i / _Seg) & _M_map_mask()] + __i % _Seg; }
+
+    // Segments holding elements.
+    size_type
+    _M_segments() const noexcept
+    {
+      if (empty())
+        return 0;
+      return (_M_impl._M_tail - 1) / _Seg - _M_impl._M_head / _Seg + 1;
+    }
+
+    void
+    _M_range_check(size_type __n) const
+    {
+      if (__n >= size())
+        std::__throw_out_of_range_fmt(__N("segmented_revolver::"
+                                          "_M_range_check: __n "
+                                          "(which is %zu) >= this->size() "
+                                          "(which is %zu)"), __n, size());
+    }
+
+    void
+    _M_free_segment(_Tp* __seg) noexcept
+    {
+      if (__seg)
+        _Alloc_traits::deallocate(_M_impl, __seg, _Seg);
+    }
+
+    /**
+     * @brief _M_add_segment
+     *    Gives a segment to the segment number @a __s, the next one at
+     *    the back: the one kept aside, else a new one.  The directory is
+     *    doubled first when it has no slot left; that copies pointers,
+     *    never elements.
+     */
+    void
+    _M_add_segment(index_type __s)
+    {
+      if (_M_segments() + 1 > _M_impl._M_map_cap)
+        _M_remap(_M_impl._M_map_cap ? _M_impl._M_map_cap * 2 : 1);
+      _Tp* __seg = std::__exchange(_M_impl._M_spare, nullptr);
+      if (!__seg)
+        __seg = std::__to_address(_Alloc_traits::allocate(_M_impl, _Seg));
+      _M_impl._M_map[__s & _M_map_mask()] = __seg;
+    }
+
+    // The segment number __s holds no element any more: kept aside if
+    // there is none yet, else freed.
+    void
+    _M_drop_segment(index_type __s) noexcept
+    {
+      _Tp*& __slot = _M_impl._M_map[__s & _M_map_mask()];
+      if (!_M_impl._M_spare)
+        _M_impl._M_spare = __slot;
+      else
+        _M_free_segment(__slot);
+      __slot = nullptr;
+    }
+
+    // Moves the segment pointers to a directory of __cap slots, at least
+    // as many as the segments held.
+    void
+    _M_remap(size_type __cap)
+    {
+      _Map_alloc_type __a(_M_get_Tp_allocator());
+      _Tp** __map = nullptr;
+      if (__cap)
+        {
+          __map = std::__to_address(_Map_alloc_traits::allocate(__a, __cap));
+          std::fill_n(__map, __cap, nullptr);
+          if (!empty())
+            for (index_type __s = _M_impl._M_head / _Seg
+                 , __last = (_M_impl._M_tail - 1) / _Seg;; ++__s)
+              {
+                __map[__s & (__cap - 1)]
+                  = _M_impl._M_map[__s & _M_map_mask()];
+                if (__s == __last)
+                  break;
+              }
+        }
+      if (_M_impl._M_map)
+        _Map_alloc_traits::deallocate(__a, _M_impl._M_map
+                                    , _M_impl._M_map_cap);
+      _M_impl._M_map = __map;
+      _M_impl._M_map_cap = __cap;
+    }
+
+    // Destroys the elements and frees all the storage.
+    void
+    _M_release() noexcept
+    {
+      clear();
+      _M_free_segment(std::__exchange(_M_impl._M_spare, nullptr));
+      if (_M_impl._M_map)
+        {
+          _Map_alloc_type __a(_M_get_Tp_allocator());
+          _Map_alloc_traits::deallocate(__a, _M_impl._M_map
+                                      , _M_impl._M_map_cap);
+        }
+      _M_impl._M_map = nullptr;
+      _M_impl._M_map_cap = 0;
+      _M_impl._M_head = _M_impl._M_tail = 0;
+    }
+
+    // Appends __get(e) for each element e of __x, at the same indices,
+    // to this empty container.  Cleans up if that throws.
+    template<typename _Cont, typename _Get>
+      void
+      _M_append_from(_Cont& __x, _Get __get)
+      {
+        _M_impl._M_head = _M_impl._M_tail = __x._M_impl._M_head;
+        __try
+          {
+            for (index_type __i = __x._M_impl._M_head;
+                 __i != __x._M_impl._M_tail; ++__i)
+              emplace_back(__get(__x.at_index(__i)));
+          }
+        __catch(...)
+          {
+            _M_release();
+            __throw_exception_again;
+          }
+      }
+  };
+
+  template<typename _Tp, typename _Alloc, std::size_t _Seg>
+    inline bool
+    operator==(const segmented_revolver<_Tp, _Alloc, _Seg>& __x
+             , const segmented_revolver<_Tp, _Alloc, _Seg>& __y)
+    {
+      return __x.size() == __y.size()
+             && std::equal(__x.begin(), __x.end(), __y.begin());
+    }
+
+  template<typename _Tp, typename _Alloc, std::size_t _Seg>
+    inline bool
+    operator!=(const segmented_revolver<_Tp, _Alloc, _Seg>& __x
+             , const segmented_revolver<_Tp, _Alloc, _Seg>& __y)
+    { return !(__x == __y); }
+
+  template<typename _Tp, typename _Alloc, std::size_t _Seg>
+    inline void
+    swap(segmented_revolver<_Tp, _Alloc, _Seg>& __x
+       , segmented_revolver<_Tp, _Alloc, _Seg>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // SEGMENTED_REVOLVER_H
@@ -37,8 +37,11 @@
 #include <memory> // allocator_traits
 #include <optional>
 #include <initializer_list>
+#include <iterator> // iterator_traits, data
+
 #include <cstring> // memcpy
 #include <utility> // pair
+#include "container_stats.h" // svector_stats
 
 namespace stl _GLIBCXX_VISIBILITY(default)
 {
@@ -49,21 +52,11 @@ _GLIBCXX_BEGIN_NAMESPACE_VERSION
  * @ingroup _ContainerHasher-detail
  * @{
  */
-  template<typename AdaptedIter, typename Allocator>
-    class svector;
-
 namespace __detail
 {
-  /**
-   * @brief The _Silver_value_base class is the type of elements
-   * the silver_vector will allocate.
-   * @param _Container_iterator an index into _ContainerHasher's inner
-   * container. If the inner container models a random access container,
-   * the index is of type 'long long' (a simple index into an array).
-   * Otherwise it is an iterator to the elements of the _ContainerHasher
-   * elements. This design avoids the unecessary handling of iterator
-   * invalidation for random access containers.
-   */
+  // layout policies forward declaration
+  struct _Tagged_layout;
+  struct _Counted_layout;
 
   template<typename _Container_iterator>
   using __type_id = std::conditional_t<
@@ -74,20 +67,55 @@ namespace __detail
                       , long long
                       , _Container_iterator>;
 
-  template<typename _Container_iterator>
-  struct alignas(sizeof(__type_id<_Container_iterator>))
+  template<typename AdaptedIter
+           , typename Allocator = std::allocator<AdaptedIter>
+           , typename Layout = _Tagged_layout
+           , typename Index = __type_id<AdaptedIter>
+           , typename Stats = _No_stats>
+    class svector;
+
+  /**
+   * @brief The _Silver_value class is the type of elements
+   * the silver_vector will allocate.
+   * @param _Container_iterator an index into _ContainerHasher's inner
+   * container. If the inner container models a random access container,
+   * the index is of type 'long long' (a simple index into an array).
+   * Otherwise it is an iterator to the elements of the _ContainerHasher
+   * elements. This design avoids the unecessary handling of iterator
+   * invalidation for random access containers.
+   * @param _Index the stored index type, __type_id<_Container_iterator>
+   * by default. An unsigned 32 bits integer may be given instead for
+   * tables under 4 billion entries, halving the slot size.
+   *
+   * Integral indices are niche encoded: two bit patterns of _Index are
+   * reserved, all bits set (~0) means disengaged, ~0 - 1 is the end
+   * tag. A slot is then exactly sizeof(_Index) bytes, and a run of
+   * disengaged slots is a memset of 0xFF.
+   * Iterator indices keep the std::optional representation.
+   */
+  template<typename _Container_iterator
+           , typename _Index = __type_id<_Container_iterator>
+           , bool = std::is_integral_v<_Index>>
+  struct alignas(sizeof(_Index))
     _Silver_value
   {
-    using __type = _Silver_value<_Container_iterator>;
+    using __type = _Silver_value;
 
+    using __container_iterator = _Container_iterator;
     using __container_iterator_tag =
         typename std::iterator_traits<_Container_iterator>::iterator_category;
 
-    using __index_type = __type_id<_Container_iterator>;
+    using __index_type = _Index;
     using __value_type = std::optional<__index_type>;
 
+    static constexpr bool __niche = false;
+
     __value_type _M_idx;
 
+    // a disengaged value
+    constexpr
+    _Silver_value() noexcept = default;
+
     constexpr
     _Silver_value(const __index_type &before) noexcept
       : _M_idx(before) {}
@@ -106,11 +134,23 @@ namespace __detail
     __type&
     operator=(__type &&) noexcept = default;
 
+    // an engaged value-initialized iterator, never reachable in the
+    // adapted container.
+    static constexpr
+    __type
+    _S_end_tag() noexcept
+    { return __type(__index_type{}); }
+
     constexpr
     void
     swap(__type& other) noexcept
     { std::swap(_M_idx, other._M_idx); }
 
+    constexpr
+    void
+    _M_reset() noexcept
+    { _M_idx.reset(); }
+
     constexpr
     __value_type&
     _M_val() noexcept
@@ -121,6 +161,187 @@ namespace __detail
     _M_val() const noexcept
     { return _M_idx; }
 
+    // true if engaged
+    constexpr
+    explicit
+    operator bool() const noexcept
+    { return _M_idx.has_value(); }
+
+    friend constexpr
+    bool
+    operator==(const __type& __x, const __type& __y) noexcept
+    { return __x._M_idx == __y._M_idx; }
+
+    friend constexpr
+    bool
+    operator!=(const __type& __x, const __type& __y) noexcept
+    { return __x._M_idx != __y._M_idx; }
+
+    friend constexpr
+    bool
+    operator==(const __type& __x, std::nullopt_t) noexcept
+    { return !__x._M_idx; }
+
+    friend constexpr
+    bool
+    operator!=(const __type& __x, std::nullopt_t) noexcept
+    { return bool(__x._M_idx); }
+
+  };
+
+  // niche encoded integral index, no engaged flag.
+  template<typename _Container_iterator, typename _Index>
+  struct alignas(sizeof(_Index))
+    _Silver_value<_Container_iterator, _Index, true>
+  {
+    using __type = _Silver_value;
+
+    using __container_iterator = _Container_iterator;
+    using __container_iterator_tag =
+        typename std::iterator_traits<_Container_iterator>::iterator_category;
+
+    using __index_type = _Index;
+    using __value_type = _Index;
+
+    static constexpr bool __niche = true;
+
+    // reserved bit patterns, both out of reach of a valid index.
+    static constexpr __index_type _S_disengaged
+      = __index_type(~__index_type(0));
+    static constexpr __index_type _S_tag = __index_type(_S_disengaged - 1);
+
+    // the fill byte of a disengaged slot.
+    static constexpr unsigned char _S_disengaged_byte = 0xFF;
+
+    __value_type _M_idx = _S_disengaged;
+
+    // a disengaged value
+    constexpr
+    _Silver_value() noexcept = default;
+
+    // It is the responsability of the caller to never give one of the
+    // reserved patterns.
+    constexpr
+    _Silver_value(const __index_type &before) noexcept
+      : _M_idx(before) {}
+
+    constexpr
+    _Silver_value(const __type& othr) noexcept = default;
+
+    constexpr
+    _Silver_value(__type&& othr) noexcept = default;
+
+    constexpr
+    __type&
+    operator=(const __type &) noexcept = default;
+
+    constexpr
+    __type&
+    operator=(__type &&) noexcept = default;
+
+    static constexpr
+    __type
+    _S_end_tag() noexcept
+    { return __type(_S_tag); }
+
+    constexpr
+    void
+    swap(__type& other) noexcept
+    { std::swap(_M_idx, other._M_idx); }
+
+    constexpr
+    void
+    _M_reset() noexcept
+    { _M_idx = _S_disengaged; }
+
+    // the raw stored pattern, meaningful only if engaged.
+    constexpr
+    __value_type&
+    _M_val() noexcept
+    { return _M_idx; }
+
+    constexpr
+    __value_type
+    _M_val() const noexcept
+    { return _M_idx; }
+
+    // true if engaged, the end tag counts as engaged.
+    constexpr
+    explicit
+    operator bool() const noexcept
+    { return _M_idx != _S_disengaged; }
+
+    friend constexpr
+    bool
+    operator==(const __type& __x, const __type& __y) noexcept
+    { return __x._M_idx == __y._M_idx; }
+
+    friend constexpr
+    bool
+    operator!=(const __type& __x, const __type& __y) noexcept
+    { return __x._M_idx != __y._M_idx; }
+
+    friend constexpr
+    bool
+    operator==(const __type& __x, std::nullopt_t) noexcept
+    { return __x._M_idx == _S_disengaged; }
+
+    friend constexpr
+    bool
+    operator!=(const __type& __x, std::nullopt_t) noexcept
+    { return __x._M_idx != _S_disengaged; }
+
+  };
+
+  /**
+   * @brief Layout policies of the svector.
+   * _Tagged_layout: the end of the buffer is marked with a tag value,
+   *    size() and capacity() are found by probing the buffer, in
+   *    O(log2(n)). The svector is a single pointer.
+   * _Counted_layout: the size and log2 of the capacity are packed in a
+   *    header word next to the pointer, size() and capacity() are O(1).
+   *    The whole buffer holds values, no slot is spent on the tag.
+   */
+  struct _Tagged_layout { };
+  struct _Counted_layout { };
+
+  // Storage of the layout policy, nothing for the tagged layout.
+  template<typename _Layout>
+  struct _Silver_header
+  { };
+
+  template<>
+  struct _Silver_header<_Counted_layout>
+  {
+    // log2 of the capacity in the low bits, the size above them.
+    static constexpr unsigned _S_cap_bits = 6;
+    static constexpr std::size_t _S_cap_mask = (1u << _S_cap_bits) - 1;
+
+    std::size_t _M_word = 0;
+
+    constexpr
+    std::size_t
+    _M_hdr_size() const noexcept
+    { return _M_word >> _S_cap_bits; }
+
+    constexpr
+    std::size_t
+    _M_hdr_capacity() const noexcept
+    { return std::size_t(1) << (_M_word & _S_cap_mask); }
+
+    constexpr
+    void
+    _M_hdr_set_size(std::size_t __n) noexcept
+    { _M_word = (__n << _S_cap_bits) | (_M_word & _S_cap_mask); }
+
+    // __cap is a power of two
+    constexpr
+    void
+    _M_hdr_set_capacity(std::size_t __cap) noexcept
+    {
+      _M_word = (_M_word & ~_S_cap_mask)
+                | std::size_t(__builtin_ctzll(__cap));
+    }
   };
 
   /**
@@ -128,28 +349,43 @@ namespace __detail
    * @param _Container_iterator The iterator type fo the adapted container.
    * We call the _ContainerHasher inner container, the 'adapted container'.
    * @param _Rebound_alloc Allocator type got from rebinding the allocator
-   * of the _ContainerHasher's into _Silver_value.
+   * of the _ContainerHasher's into _Silver_value, its index type picks
+   * the slot representation.
    * We inherit from _Rebound_alloc to benefit from the Zero size base struct
    * optimization.
+   * @param _Layout _Tagged_layout or _Counted_layout, how size and capacity
+   * are kept.
+   * @param _Stats _No_stats, or _Record_stats to count the reallocations
+   * and the bytes allocated, an empty base otherwise.
    */
-  template<typename _Container_iterator, typename _Rebound_alloc>
-  class _Silver_vector_base : public _Rebound_alloc
+  template<typename _Container_iterator, typename _Rebound_alloc
+           , typename _Layout = _Tagged_layout
+           , typename _Stats = _No_stats>
+  class _Silver_vector_base
+    : public _Rebound_alloc
+    , protected _Silver_header<_Layout>
+    , protected _Silver_stats_recorder<_Stats::__enabled>
   {
     using __alloc_base_type = _Rebound_alloc;
     using __alloc_traits = std::allocator_traits<__alloc_base_type>;
     using __alloc_value_type = typename __alloc_traits::value_type;
     using __alloc_size_type = typename __alloc_traits::size_type;
-    using __silver_value_type = _Silver_value<_Container_iterator>;
+    using __silver_value_type =
+          _Silver_value<_Container_iterator
+                      , typename __alloc_value_type::__index_type>;
+    using __header_type = _Silver_header<_Layout>;
 
     static_assert(std::is_same_v<__alloc_value_type, __silver_value_type>
                   , "_Alloc value_type must match the vector element type");
 
+    static constexpr bool __counted = std::is_same_v<_Layout, _Counted_layout>;
+
     using __pointer = typename __alloc_traits::pointer;
     using __iterator_tag =
           typename std::iterator_traits<_Container_iterator>::iterator_category;
 
   protected:
-    __pointer _M_beg;
+    __pointer _M_beg = nullptr;
 
     // forward declaraction of iterators.
     struct __iterator;
@@ -158,84 +394,104 @@ namespace __detail
   public:
     using size_type = __alloc_size_type;
     using value_type = __alloc_value_type;
-    using reference = typename __alloc_traits::reference;
+    using reference = value_type&;
+    using const_reference = const value_type&;
     using allocator_type = __alloc_base_type;
     using iterator = __iterator;
     using const_iterator = __iterator_const;
 
   public:
     ~_Silver_vector_base()
-    {
-      if(_M_beg)
-      {
-          static_cast<__alloc_base_type*>(this)->deallocate(_M_capacity());
-          _M_beg = nullptr;
-      }
-    }
+    { _M_deallocate(); }
 
+    // no buffer until the first insertion: an empty vector costs its
+    // pointer and nothing more.
     constexpr
     _Silver_vector_base()
         noexcept(std::is_nothrow_default_constructible_v<__alloc_base_type>)
     : __alloc_base_type()
-    {
-      _M_beg = _M_get_alloc().allocate(2);
-      _M_get_alloc().construct((_M_beg + 1), _M_end_tag());
-    }
+    { }
 
     constexpr
     _Silver_vector_base(const allocator_type& othr)
         noexcept(std::is_nothrow_copy_constructible_v<allocator_type>)
     : __alloc_base_type(__alloc_traits::select_on_container_copy_construction(othr))
-    {
-      _M_beg = _M_get_alloc().allocate(2);
-      _M_get_alloc().construct((_M_beg + 1), _M_end_tag());
-    }
+    { }
 
     constexpr
     _Silver_vector_base(allocator_type&& othr)
         noexcept(std::is_nothrow_move_constructible_v<allocator_type>)
     : __alloc_base_type(std::move(othr))
-    {
-      _M_beg = _M_get_alloc().allocate(2);
-      _M_get_alloc().construct((_M_beg + 1), _M_end_tag());
-    }
+    { }
 
+    // the moved from vector is left without buffer, as a new one.
     constexpr
     _Silver_vector_base(_Silver_vector_base&& othr)
         noexcept(std::is_nothrow_move_constructible_v<allocator_type>)
     : __alloc_base_type(std::move(othr))
-    , _M_beg(std::move(othr._M_beg))
-    { }
+    , __header_type(std::move(othr))
+    , _M_beg(std::exchange(othr._M_beg, nullptr))
+    { static_cast<__header_type&>(othr) = __header_type(); }
 
     // allocate enough capacity to hold the engaged elements only
-    // maybe the source svector is sparsly filled.
+    // maybe the source svector is sparsly filled. The copy of an empty
+    // one has no buffer.
     constexpr
     _Silver_vector_base(const _Silver_vector_base& othr)
-        noexcept(std::is_nothrow_copy_constructible_v<allocator_type>)
     : __alloc_base_type(__alloc_traits::select_on_container_copy_construction(othr))
     {
-      static_assert(std::is_trivially_constructible_v<value_type>);
-
-      const size_type _sz = othr.size();
-      *this = std::move(_Silver_vector_base(_sz));
-      _M_byte_blit(othr._M_begin(), _sz);
-      _M_fill_disengaged(_sz);
+      static_assert(std::is_trivially_copyable_v<value_type>);
+
+      const size_type _sz = othr._M_size();
+      if(_sz == 0)
+        return;
+      _M_create_storage(_S_capacity_for(_sz));
+      _M_byte_blit(othr._M_beg, _sz);
+      _M_set_size(_sz);
     }
 
+    // the allocator follows the buffer only when it propagates on move
+    // assignment. Unequal allocators that do not propagate get a copy of
+    // the values in a buffer of their own.
     constexpr
     _Silver_vector_base&
     operator=(_Silver_vector_base&& rght)
-            noexcept(std::is_nothrow_move_constructible_v<allocator_type>) = default;
-
+            noexcept(__alloc_traits::propagate_on_container_move_assignment
+                       ::value
+                     || __alloc_traits::is_always_equal::value)
+    {
+      if(this == &rght)
+        return *this;
+      if constexpr (!__alloc_traits::propagate_on_container_move_assignment
+                       ::value
+                    && !__alloc_traits::is_always_equal::value)
+        if(_M_get_alloc() != rght._M_get_alloc())
+        {
+          const size_type _sz = rght._M_size();
+          _Silver_vector_base _tmp(_M_get_alloc(), _sz);
+          if(_sz)
+            _tmp._M_byte_blit(rght._M_begin(), _sz);
+          _tmp._M_set_size(_sz);
+          _M_swap_buffers(_tmp);
+          return *this;
+        }
+      _M_deallocate();
+      if constexpr (__alloc_traits::propagate_on_container_move_assignment
+                      ::value)
+        static_cast<__alloc_base_type&>(*this) = std::move(rght);
+      static_cast<__header_type&>(*this) = std::move(rght);
+      static_cast<__header_type&>(rght) = __header_type();
+      _M_beg = std::exchange(rght._M_beg, nullptr);
+      return *this;
+    }
 
     constexpr
     _Silver_vector_base&
     operator=(const _Silver_vector_base& rght)
-               noexcept(std::is_nothrow_move_constructible_v<allocator_type>)
     {
-      if(*this == rght)
+      if(this == &rght)
         return *this;
-      *this = std::move(_Silver_vector_base(rght));
+      *this = _Silver_vector_base(rght);
       return *this;
     }
 
@@ -248,22 +504,29 @@ namespace __detail
     constexpr
     explicit
     _Silver_vector_base(size_type n)
-      : _Silver_vector_base()
+      : __alloc_base_type()
+    { _M_create_storage(_S_capacity_for(n)); }
+
+    // as above, allocating from a copy of __a, an empty vector for
+    // n == 0.
+    constexpr
+    _Silver_vector_base(const allocator_type& __a, size_type n)
+      : __alloc_base_type(__a)
     {
-      size_type _cap = 2;
-      while( _cap < n )
-        _cap <<= 1;
-      auto& _M_alloc = _M_get_alloc();
-      _M_beg = _M_alloc.allocate(_cap);
-      // tag the buffer
-      _M_alloc.construct((_M_beg + _cap - 1), _M_end_tag());
+      if(n)
+        _M_create_storage(_S_capacity_for(n));
     }
 
+    // exchanges the buffers and the headers, not the allocators: those
+    // of the two vectors compare equal.
     constexpr
-    explicit
-    _Silver_vector_base(__pointer _ptr, const allocator_type& _alloc = allocator_type{})
-      : __alloc_base_type(_alloc), _M_beg(std::move(_ptr))
-    { }
+    void
+    _M_swap_buffers(_Silver_vector_base& othr) noexcept
+    {
+      std::swap(_M_beg, othr._M_beg);
+      std::swap(static_cast<__header_type&>(*this)
+              , static_cast<__header_type&>(othr));
+    }
 
     constexpr
     allocator_type&
@@ -275,19 +538,63 @@ namespace __detail
     constexpr
     inline
     __pointer
-    _M_begin() noexcept
+    _M_begin() const noexcept
     {
       return _M_beg;
     }
 
+    // smallest capacity 2^k, k >= 1, with room for n values
+    static constexpr
+    size_type
+    _S_capacity_for(size_type n) noexcept
+    {
+      size_type _cap = 2;
+      // the tagged layout keeps the last slot for the tag
+      while( _cap - (__counted ? 0 : 1) < n )
+        _cap <<= 1;
+      return _cap;
+    }
+
+    // allocates a buffer of capacity _cap, all values disengaged.
+    constexpr
+    void
+    _M_create_storage(size_type _cap)
+    {
+      auto& _M_alloc = _M_get_alloc();
+      _M_beg = __alloc_traits::allocate(_M_alloc, _cap);
+      if constexpr (__counted)
+        {
+          this->_M_hdr_set_capacity(_cap);
+          this->_M_hdr_set_size(0);
+        }
+      else
+        // tag the buffer
+        __alloc_traits::construct(_M_alloc, (_M_beg + _cap - 1), _M_end_tag());
+      _M_fill_disengaged(0, __counted ? _cap : _cap - 1);
+      this->_M_record_alloc(_cap * sizeof(value_type));
+    }
+
+    constexpr
+    void
+    _M_deallocate() noexcept
+    {
+      if(_M_beg)
+      {
+          __alloc_traits::deallocate(_M_get_alloc(), _M_beg, _M_capacity());
+          _M_beg = nullptr;
+      }
+    }
+
     // the end of the Element count
     // Time complexity Linear (_hintPos - lastElem)
     constexpr
     __pointer
     _M_end(size_type _hintPos) const noexcept
     {
+      if constexpr (__counted)
+        return _M_begin() + this->_M_hdr_size();
       auto _M_start = _M_begin() + _hintPos;
-      while(*_M_start or *_M_start != _M_end_tag())
+      while(*_M_start and *_M_start != _M_end_tag())
         ++_M_start;
       return _M_start;
     }
@@ -310,31 +617,46 @@ namespace __detail
     inline
     value_type
     _M_end_tag() const noexcept
-    {
-      if constexpr(std::is_same_v<__iterator_tag
-                                , std::random_access_iterator_tag>)
-        return {-1};
-      else
-        return {nullptr};
-    }
+    { return value_type::_S_end_tag(); }
 
     // Capacity of this container, 2^k
-    // Time complexity Log2(capacity)
+    // Time complexity Log2(capacity) for the tagged layout, O(1) for the
+    // counted one.
     constexpr
     size_type
     _M_capacity() const noexcept
     {
+      if(!_M_beg)
+        return 0;
+      if constexpr (__counted)
+        return this->_M_hdr_capacity();
       // the minimal capacity is 2;
       size_type _cap = 2;
       auto begin = _M_beg;
       while(*(begin + _cap - 1) != _M_end_tag())
-        _cap >>= 1;
+        _cap <<= 1;
       return _cap;
     }
 
+    // Number of slots able to hold a value, the tagged layout spends the
+    // last one on the tag.
+    constexpr
+    size_type
+    _M_usable() const noexcept
+    {
+      const size_type _cap = _M_capacity();
+      if constexpr (__counted)
+        return _cap;
+      else
+        return _cap ? _cap - 1 : 0;
+    }
+
     /**
      * @brief _M_find_end
      *    Finds the One past the end index. Also the adequate capacity.
+     *    The engaged values form a prefix of the buffer, closed by the
+     *    tag at the end of the capacity: binary search for the first
+     *    disengaged value.
      * @param _startHint
      *    A hint position to narrow the range of search.
      * @return
@@ -343,70 +665,42 @@ namespace __detail
      */
     constexpr
     std::pair<size_type, size_type>
-    _M_find_end(size_type _startHint) noexcept
+    _M_find_end(size_type _startHint) const noexcept
     {
+      const size_type _cap = _M_capacity();
+      if constexpr (__counted)
+        return {this->_M_hdr_size(), _cap};
+      if(_cap == 0)
+        return {0, 0};
+
       auto _arr_ptr = _M_begin();
-      size_type _idx = 0, _cap = 2, _inc = 1;
-      while(_arr_ptr[_cap - 1] != _M_end_tag())
-      {
-        if(_arr_ptr[_idx] == std::nullopt)
-          break;
-        _cap = 2 << _inc;
-        _idx = 1 << _inc;
-        ++_inc;
-      }
-      // a new constructed container with maybe a value.
-      if(_idx == 0)
+      // the answer is in [_lwr, _upr]
+      size_type _lwr = 0, _upr = _cap - 1;
+      if(_startHint < _upr)
       {
-        if(_arr_ptr[_idx] == std::nullopt)
-          return {_idx, _cap};
+        if(_arr_ptr[_startHint] != std::nullopt)
+          _lwr = _startHint + 1;
         else
-          return {_idx + 1, _cap};
-      }
-
-      size_type _upr = _cap - 1, _lwr = 0;
-      if(_startHint < _cap)
-      {
-        _upr = std::max(_startHint, _idx);
-        _lwr = std::min(_startHint, _idx);
+          _upr = _startHint;
       }
 
-      size_type _bfr = _arr_ptr[_idx] == std::nullopt ? _lwr : _idx;
-      size_type _aft = _arr_ptr[_idx] == std::nullopt ? _idx : _upr;
-
-      if(_arr_ptr[_bfr] == std::nullopt)
-      {
-        _aft = _lwr;
-        _bfr = 0;
-      }
-      if(_arr_ptr[_aft] != std::nullopt)
+      while(_lwr < _upr) // converging algorithm
       {
-        _bfr = _upr;
-        _aft = _cap - 1;
-      }
-
-      while(true) // converging algorithm
-      {
-          if((_aft - _bfr) == 1)
-          {
-            if(_arr_ptr[_idx] == std::nullopt)
-              return {_bfr + 1, _cap};
-            else
-              return {_idx + 1, _cap};
-          }
-          _idx = _bfr + (_aft - _bfr) / 2;
-          if(_arr_ptr[_idx] == std::nullopt)
-            _aft = _idx;
-          else
-            _bfr = _idx;
+        size_type _idx = _lwr + (_upr - _lwr) / 2;
+        if(_arr_ptr[_idx] == std::nullopt)
+          _upr = _idx;
+        else
+          _lwr = _idx + 1;
       }
+      return {_lwr, _cap};
     }
 
     /**
      * @brief _M_cap_size
      * @return the size is calculated by finding the first disengaged value
      *    Also returns the minimal capacity adequate to hold that much elements
-     *    Time complexity is Amortized O(log2(n))
+     *    Time complexity is Amortized O(log2(n)), O(1) for the counted
+     *    layout.
      */
     constexpr
     std::pair<size_type, size_type>
@@ -416,21 +710,34 @@ namespace __detail
       return {_cap, _sz};
     }
 
+    constexpr
+    size_type
+    _M_size() const noexcept
+    { return _M_find_end(0).first; }
+
+    // only the counted layout records the size, the tagged one reads it
+    // from the buffer.
+    constexpr
+    void
+    _M_set_size(size_type _sz) noexcept
+    {
+      if constexpr (__counted)
+        this->_M_hdr_set_size(_sz);
+    }
+
     /**
      * @brief _M_clear
      *    destroyes all elements. Pointers are not invalidated,
-     *    but the dereferenced value is an empty optional<T>
+     *    but the dereferenced value is disengaged.
      */
     constexpr
     void _M_clear() noexcept
     {
-      auto _begin = _M_begin();
-      while(*_begin)
-      {
-        // std::optional::reset
-        *_begin.reset();
-        ++_begin;
-      }
+      const size_type _sz = _M_size();
+      if(_sz == 0)
+        return;
+      _M_fill_disengaged(0, _sz);
+      _M_set_size(0);
     }
 
     /**
@@ -439,8 +746,7 @@ namespace __detail
      *    less than the capacity of the buffer.
      * @param _idx
      *    positive integer must be less than _M_capacity()
-     * @return a reference into a std::optional, either engaged or
-     *    disengaged.
+     * @return a reference to a value, either engaged or disengaged.
      */
     constexpr
     reference
@@ -449,26 +755,47 @@ namespace __detail
       return _M_begin()[_idx];
     }
 
+    constexpr
+    const_reference
+    _M_val_at(size_t _idx) const noexcept
+    {
+      return _M_begin()[_idx];
+    }
+
     /**
      * @brief _M_fill_disengaged
-     *    Fills the buffer with disengaged std::optional until the position
+     *    Fills the buffer with disengaged values until the position
      *    one less the capacity.
      *    It is the caller responsability to give a hint position less than
      *    the capacity of the buffer.
+     *    Niche encoded values are disengaged when all their bits are set,
+     *    the fill is then a single memset.
      * @param _hintPos
-     *    starting position at which the first disengaged std::optional is
+     *    starting position at which the first disengaged value is
      *    created.
      */
     constexpr
     void
-    _M_fill_disengaged(size_type _hintPos) noexcept
+    _M_fill_disengaged(size_type _hintPos, size_type _lastPos) noexcept
     {
       auto _M_start = _M_begin() + _hintPos;
-      auto& _M_alloc = _M_get_alloc();
-      while(*_M_start != _M_end_tag())
-        _M_alloc.construct(_M_start++, value_type{});
+      auto _M_last = _M_begin() + _lastPos;
+      if constexpr (value_type::__niche)
+        std::memset(std::__to_address(_M_start), value_type::_S_disengaged_byte
+                    , (_M_last - _M_start) * sizeof(value_type));
+      else
+        {
+          auto& _M_alloc = _M_get_alloc();
+          while(_M_start != _M_last)
+            __alloc_traits::construct(_M_alloc, _M_start++, value_type{});
+        }
     }
 
+    constexpr
+    void
+    _M_fill_disengaged(size_type _hintPos) noexcept
+    { _M_fill_disengaged(_hintPos, _M_usable()); }
+
     /**
      * @brief _M_byte_blit
      *    Copy construct the _count values from source into destination,
@@ -483,9 +810,9 @@ namespace __detail
      */
     constexpr
     void
-    _M_byte_blit(__pointer _dst, __pointer _src, size_t _count)
+    _M_byte_blit(__pointer _dst, const value_type* _src, size_t _count)
     {
-      if constexpr( std::is_trivially_constructible_v<value_type>)
+      if constexpr( std::is_trivially_copyable_v<value_type>)
         std::memcpy(_dst, _src, _count * sizeof(value_type));
       else
         std::uninitialized_copy_n(_src, _count, _dst);
@@ -493,7 +820,7 @@ namespace __detail
 
     constexpr
     void
-    _M_byte_blit(__pointer _src, size_t _count) noexcept
+    _M_byte_blit(const value_type* _src, size_t _count) noexcept
     {
       _M_byte_blit(_M_begin(), _src, _count);
     }
@@ -501,48 +828,44 @@ namespace __detail
     /**
      * @brief _M_construct_at
      *    constructs a value_type at position. It is the responsability of
-     *    the caller to give a position inside the buffer.
-     *    If the _pos is at capacity, but the buffer is still empty then no
-     *    reallocation heppens, otherwise reallocate and copy.
+     *    the caller to give a position at most the size of the buffer.
+     *    If the _pos is at capacity, then reallocate and copy.
      * @param _pos
-     *    Must be inside the buffer
+     *    Must be at most the size
      * @param _val
      *    The value to copy into the position
      * @return
      *    A pointer into the position of the inserted value, and boolean
      *    to indicate if reallocation happended.
      */
+    // may throw { std::bad_array_new_length, std::bad_alloc }
     std::pair<__pointer, bool>
-    _M_construct_at(size_type _pos, const value_type& _val) noexcept
+    _M_construct_at(size_type _pos, const value_type& _val)
     {
-      auto& _M_alloc = _M_get_alloc();
-      if(_M_begin()[_pos] == _M_end_tag())
+      const auto [_cap, _n_elem] = _M_cap_size();
+      bool _realloc = false;
+      if(_pos >= _M_usable())
       {
-        // reallocate if necessary
-        size_type _new_cap = (_pos + 1) << 1;
-        auto [_cap, _n_elem] = _M_cap_size();
-        __pointer _tmp = nullptr;
-        if (_cap < _new_cap)
-          // no need to reallocate, just insert at the end
-
-        try
-        {
-          _tmp = _M_alloc.allocate(_new_cap);
-          _tmp[_new_cap - 1] = _M_end_tag();
-          _M_byte_blit(_tmp, _M_begin(), _n_elem);
-          _M_fill_disengaged(_n_elem);
-        }
-        catch (...)
-        {
-          throw;
-        }
-        _M_alloc.deallocate(_pos);
-        *this = std::move(_Silver_vector_base(_tmp));
+        // reallocate, keep the engaged values only. The first buffer
+        // is allocated here too, there is nothing to copy then. The new
+        // buffer comes from this allocator, the old one goes with _tmp.
+        _Silver_vector_base _tmp(_M_get_alloc(), _pos + 1);
+        if(_n_elem)
+          _tmp._M_byte_blit(_M_begin(), _n_elem);
+        _tmp._M_set_size(_n_elem);
+        _M_swap_buffers(_tmp);
+        _realloc = true;
+        // the buffer was counted by _tmp
+        if(_cap)
+          this->_M_record_realloc();
+        this->_M_record_alloc(_S_capacity_for(_pos + 1) * sizeof(value_type));
       }
 
       __pointer _ret = _M_begin() + _pos;
-      _M_beg[_pos] = _val;
-      return _ret;
+      *_ret = _val;
+      if(_pos >= _n_elem)
+        _M_set_size(_pos + 1);
+      return {_ret, _realloc};
     }
   };
 
@@ -550,13 +873,15 @@ namespace __detail
    * @brief The _Silver_vector_base::__iterator class
    * out of class definition
    */
-  template<typename _Container_iterator, typename _Rebound_alloc>
+  template<typename _Container_iterator, typename _Rebound_alloc
+           , typename _Layout, typename _Stats>
   struct
-    _Silver_vector_base<_Container_iterator, _Rebound_alloc>
+    _Silver_vector_base<_Container_iterator, _Rebound_alloc, _Layout, _Stats>
     ::__iterator
   {
     using __vector_type = _Silver_vector_base<_Container_iterator
-                                            , _Rebound_alloc>;
+                                            , _Rebound_alloc, _Layout
+                                            , _Stats>;
     using __pointer = typename __vector_type::__pointer;
     using __ref = typename __vector_type::value_type&;
     using __const_ref = const typename __vector_type::value_type&;
@@ -611,19 +936,31 @@ namespace __detail
     {
       return *_M_ptr;
     }
+
+    friend constexpr
+    bool
+    operator==(const __iterator& __x, const __iterator& __y) noexcept
+    { return __x._M_ptr == __y._M_ptr; }
+
+    friend constexpr
+    bool
+    operator!=(const __iterator& __x, const __iterator& __y) noexcept
+    { return __x._M_ptr != __y._M_ptr; }
   };
 
   /**
    * @brief The _Silver_vector_base::__iterator_const class
    * out of class definition
    */
-  template<typename _Container_iterator, typename _Rebound_alloc>
+  template<typename _Container_iterator, typename _Rebound_alloc
+           , typename _Layout, typename _Stats>
   struct
-    _Silver_vector_base<_Container_iterator, _Rebound_alloc>
+    _Silver_vector_base<_Container_iterator, _Rebound_alloc, _Layout, _Stats>
     ::__iterator_const
   {
     using __vector_type = _Silver_vector_base<_Container_iterator
-                                            , _Rebound_alloc>;
+                                            , _Rebound_alloc, _Layout
+                                            , _Stats>;
     using __pointer = typename __vector_type::__pointer;
     using __ref = typename __vector_type::value_type&;
     using __const_ref = const typename __vector_type::value_type&;
@@ -678,25 +1015,52 @@ namespace __detail
     {
       return *_M_ptr;
     }
+
+    friend constexpr
+    bool
+    operator==(const __iterator_const& __x
+             , const __iterator_const& __y) noexcept
+    { return __x._M_ptr == __y._M_ptr; }
+
+    friend constexpr
+    bool
+    operator!=(const __iterator_const& __x
+             , const __iterator_const& __y) noexcept
+    { return __x._M_ptr != __y._M_ptr; }
   };
 
   /**
    * @brief The svector class
    * A vector class with minimal memory foot print.
    * capacity growth is 2^k where k >= 1
-   * the buffer is marked with a bogus value at the end of capacity
-   * size() and capacity() calculate their value, i.e. not stored values
+   * With the default _Tagged_layout:
+   *   the buffer is marked with a bogus value at the end of capacity
+   *   size() and capacity() calculate their value, i.e. not stored values
+   *   push_back() is O(log(n))
+   * With _Counted_layout:
+   *   size and capacity are stored in one header word, both O(1)
+   *   push_back() is amortized O(1)
    * begin() is O(1)
    * erase() bubbles the value to the end of the buffer then disengage it.
-   * push_back() is O(n)
    * pop_back() is O(n)
    * insert() is O(n-pos)
+   * Index is the stored index type, std::uint32_t opts random access
+   * containers into 4 bytes slots (at most 2^32 - 2 distinct indices).
+   * Stats is _No_stats, or _Record_stats to enable stats().
    */
-  template<typename AdaptedIter
-           , typename Allocator = std::allocator<AdaptedIter>>
-  class svector : public _Silver_vector_base<AdaptedIter, Allocator>
+  template<typename AdaptedIter, typename Allocator, typename Layout
+           , typename Index, typename Stats>
+  class svector
+    : public _Silver_vector_base<AdaptedIter
+                               , std::__alloc_rebind<Allocator
+                                        , _Silver_value<AdaptedIter, Index>>
+                               , Layout, Stats>
   {
-    using __base_type = _Silver_vector_base<AdaptedIter, Allocator>;
+    using __base_type =
+          _Silver_vector_base<AdaptedIter
+                            , std::__alloc_rebind<Allocator
+                                        , _Silver_value<AdaptedIter, Index>>
+                            , Layout, Stats>;
   public:
     using value_type = typename __base_type::value_type;
     using allocator_type = typename __base_type::allocator_type;
@@ -716,31 +1080,23 @@ namespace __detail
     using __base_type::__base_type
          ,__base_type::operator=;
 
-    ~svector() = default;
+    svector() = default;
 
     // allocate enough capacity to hold the elements count
-    constexpr svector(std::initializer_list<value_type> const& il) noexcept
+    constexpr svector(std::initializer_list<value_type> const& il)
       : __base_type(il.size())
     {
-      using __base_type::_M_byte_blit
-          , __base_type::_M_fill_disengaged;
+      static_assert(std::is_trivially_copyable_v<value_type>);
 
-      static_assert(std::is_trivially_constructible_v<value_type>);
-
-      _M_byte_blit(std::data(il), il.size());
-
-      // finish the rest till the capacity with disengaged value_type
-      _M_fill_disengaged(il.size());
+      this->_M_byte_blit(std::data(il), il.size());
+      this->_M_set_size(il.size());
     }
 
-    // should be used sparsly
+    // O(log(n)) with the tagged layout, should be used sparsly
     constexpr
     size_type
     size() const noexcept
-    {
-      using __base_type::_M_size;
-      return _M_size();
-    }
+    { return this->_M_size(); }
 
     // relys on size(),i.e should be used sparsly
     constexpr
@@ -748,32 +1104,64 @@ namespace __detail
     empty() const noexcept
     { return size() == 0; }
 
+    constexpr
+    size_type
+    capacity() const noexcept
+    { return this->_M_usable(); }
+
     // recyle container instead of clearing it
     // Linear in time.
     constexpr
     void
     clear() noexcept
-    {
-      using __base_type::_M_clear;
-      _M_clear();
-    }
+    { this->_M_clear(); }
+
+    // may throw { std::bad_array_new_length, std::bad_alloc }
+    constexpr
+    void
+    push_back(const value_type& _val)
+    { this->_M_construct_at(size(), _val); }
+
+    constexpr
+    iterator
+    begin() noexcept
+    { return iterator(this->_M_begin()); }
+
+    constexpr
+    const_iterator
+    begin() const noexcept
+    { return const_iterator(this->_M_begin()); }
+
+    constexpr
+    iterator
+    end() noexcept
+    { return iterator(this->_M_begin() + size()); }
+
+    constexpr
+    const_iterator
+    end() const noexcept
+    { return const_iterator(this->_M_begin() + size()); }
 
     constexpr
     reference
     operator[](size_t index) noexcept
-    {
-      using __base_type::_M_val_at;
-      return _M_val_at(index);
-    }
+    { return this->_M_val_at(index); }
 
     constexpr
     const_reference
     operator[](size_t index) const noexcept
+    { return this->_M_val_at(index); }
+
+    // reallocations and bytes allocated since construction, with the
+    // _Record_stats policy only.
+    svector_stats
+    stats() const noexcept
     {
-      using __base_type::_M_val_at;
-      return _M_val_at(index);
+      static_assert(Stats::__enabled
+                    , "stats() needs the Stats policy _Record_stats");
+      return { this->_M_reallocs, this->_M_bytes
+             , this->_M_capacity() * sizeof(value_type) };
     }
-
   };
 
 ///@} _Silver_vector
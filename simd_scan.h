@@ -0,0 +1,271 @@
+// Vectorized linear scan for small tables -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file bits/simd_scan.h
+ *  This is an internal header file, included by other library headers.
+ *  Do not attempt to use it directly.
+ *  @headername{hashed_stack, hashed_queue}
+ */
+
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H 1
+
+#pragma GCC system_header
+
+#include <cstddef>
+#include <cstdint>     // for std::uint64_t
+#include <cstring>     // for std::memcpy
+#include <functional>  // for std::equal_to
+#include <type_traits>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+# if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  include <immintrin.h>
+#  define _STL_SIMD_SCAN_AVX2 1
+# endif
+#endif
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+    /// @cond undocumented
+
+namespace __detail
+{
+/**
+  *  @addtogroup _ContainerHasher-detail
+  *  @{
+  */
+
+  /**
+   *  struct __simd_scannable
+   *
+   *  Whether a small table of _Key elements compared with _Equal can be
+   *  scanned a vector at a time: keys of 1, 2, 4 or 8 bytes whose
+   *  equality is that of their bits, i.e. integers, enumerations and
+   *  pointers under std::equal_to.  A user defined operator== may not
+   *  compare bits, so other types are scanned one key at a time.
+   */
+  template<typename _Key, typename _Equal>
+    struct __simd_scannable
+    : std::bool_constant<
+#if defined(__SSE2__)
+        (std::is_integral<_Key>::value || std::is_enum<_Key>::value
+         || std::is_pointer<_Key>::value)
+        && (sizeof(_Key) == 1 || sizeof(_Key) == 2
+            || sizeof(_Key) == 4 || sizeof(_Key) == 8)
+        && (std::is_same<_Equal, std::equal_to<_Key>>::value
+            || std::is_same<_Equal, std::equal_to<>>::value)
+#else
+        false
+#endif
+      >
+    { };
+
+  /**
+   *  Elements up to which a scan keeps up with hashing and probing the
+   *  index, by key width: the crossovers measured by
+   *  benchmark/simd_scan_bench.cpp against an index in the L1 cache,
+   *  rounded down to a power of two.  The unindexed table also saves the
+   *  index storage and its allocations.  Zero without SSE2.
+   */
+  constexpr std::size_t
+  __simd_scan_threshold(std::size_t __width) noexcept
+  {
+#if defined(__SSE2__)
+    switch (__width)
+      {
+      case 1:
+        return 32;
+      case 2:
+        return 16;
+      case 4:
+      case 8:
+        return 8;
+      }
+#endif
+    return 0;
+  }
+
+  // The unsigned integer holding the bits of a key of _Width bytes.
+  template<std::size_t _Width>
+    using __scan_word = std::conditional_t<_Width == 1, std::uint8_t
+                      , std::conditional_t<_Width == 2, std::uint16_t
+                      , std::conditional_t<_Width == 4, std::uint32_t
+                                                       , std::uint64_t>>>;
+
+  template<std::size_t _Width>
+    inline std::size_t
+    __scan_scalar(const unsigned char* __p, std::size_t __n
+                , __scan_word<_Width> __k) noexcept
+    {
+      for (std::size_t __i = 0; __i != __n; ++__i)
+        {
+          __scan_word<_Width> __w;
+          std::memcpy(&__w, __p + __i * _Width, _Width);
+          if (__w == __k)
+            return __i;
+        }
+      return __n;
+    }
+
+#if defined(__SSE2__)
+  // Sixteen bytes at a time.  The last vector is loaded to end with the
+  // last key, overlapping the one before, so that only fewer keys than
+  // a vector holds are compared one by one.  SSE2 has no 64-bit compare,
+  // and two keys a vector do not pay: 8-byte keys are compared one by
+  // one.
+  template<std::size_t _Width>
+    inline std::size_t
+    __scan_sse2(const unsigned char* __p, std::size_t __n
+              , __scan_word<_Width> __k) noexcept
+    {
+      constexpr std::size_t __lanes = 16 / _Width;
+      if constexpr (_Width == 8)
+        return __scan_scalar<_Width>(__p, __n, __k);
+      else
+        {
+          if (__n < __lanes)
+            return __scan_scalar<_Width>(__p, __n, __k);
+
+          __m128i __key;
+          if constexpr (_Width == 1)
+            __key = _mm_set1_epi8(static_cast<char>(__k));
+          else if constexpr (_Width == 2)
+            __key = _mm_set1_epi16(static_cast<short>(__k));
+          else
+            __key = _mm_set1_epi32(static_cast<int>(__k));
+
+          for (std::size_t __i = 0;; __i += __lanes)
+            {
+              if (__i + __lanes > __n)
+                __i = __n - __lanes;
+              const __m128i __v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(__p + __i * _Width));
+              __m128i __cmp;
+              if constexpr (_Width == 1)
+                __cmp = _mm_cmpeq_epi8(__v, __key);
+              else if constexpr (_Width == 2)
+                __cmp = _mm_cmpeq_epi16(__v, __key);
+              else
+                __cmp = _mm_cmpeq_epi32(__v, __key);
+              if (const unsigned __m = _mm_movemask_epi8(__cmp))
+                return __i + __builtin_ctz(__m) / _Width;
+              if (__i + __lanes == __n)
+                return __n;
+            }
+        }
+    }
+#endif
+
+#if defined(_STL_SIMD_SCAN_AVX2)
+  // Thirty-two bytes at a time, the last vector overlapping as with
+  // SSE2.  Only called once the CPU is known to support AVX2, with at
+  // least a vector of keys.
+  template<std::size_t _Width>
+    __attribute__((__target__("avx2")))
+    std::size_t
+    __scan_avx2(const unsigned char* __p, std::size_t __n
+              , __scan_word<_Width> __k) noexcept
+    {
+      constexpr std::size_t __lanes = 32 / _Width;
+      __m256i __key;
+      if constexpr (_Width == 1)
+        __key = _mm256_set1_epi8(static_cast<char>(__k));
+      else if constexpr (_Width == 2)
+        __key = _mm256_set1_epi16(static_cast<short>(__k));
+      else if constexpr (_Width == 4)
+        __key = _mm256_set1_epi32(static_cast<int>(__k));
+      else
+        __key = _mm256_set1_epi64x(static_cast<long long>(__k));
+
+      for (std::size_t __i = 0;; __i += __lanes)
+        {
+          if (__i + __lanes > __n)
+            __i = __n - __lanes;
+          const __m256i __v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(__p + __i * _Width));
+          __m256i __cmp;
+          if constexpr (_Width == 1)
+            __cmp = _mm256_cmpeq_epi8(__v, __key);
+          else if constexpr (_Width == 2)
+            __cmp = _mm256_cmpeq_epi16(__v, __key);
+          else if constexpr (_Width == 4)
+            __cmp = _mm256_cmpeq_epi32(__v, __key);
+          else
+            __cmp = _mm256_cmpeq_epi64(__v, __key);
+          if (const unsigned __m = _mm256_movemask_epi8(__cmp))
+            return __i + __builtin_ctz(__m) / _Width;
+          if (__i + __lanes == __n)
+            return __n;
+        }
+    }
+
+  // Asked once per process.
+  inline bool
+  __cpu_has_avx2() noexcept
+  {
+    static const bool __avx2 = []
+      {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+      }();
+    return __avx2;
+  }
+#endif
+
+  /**
+   *  @brief __simd_find
+   *    Position of the first of the @a __n keys at @a __first equal to
+   *    @a __k, @a __n if there is none.  The keys are compared by their
+   *    bits, with AVX2 when the CPU has it, SSE2 otherwise.
+   */
+  template<typename _Key>
+    inline std::size_t
+    __simd_find(const _Key* __first, std::size_t __n, const _Key& __k) noexcept
+    {
+      constexpr std::size_t __width = sizeof(_Key);
+      const unsigned char* __p
+        = reinterpret_cast<const unsigned char*>(__first);
+      __scan_word<__width> __w;
+      std::memcpy(&__w, std::__addressof(__k), __width);
+#if defined(_STL_SIMD_SCAN_AVX2)
+      if (__n >= 32 / __width && __cpu_has_avx2())
+        return __scan_avx2<__width>(__p, __n, __w);
+#endif
+#if defined(__SSE2__)
+      return __scan_sse2<__width>(__p, __n, __w);
+#else
+      return __scan_scalar<__width>(__p, __n, __w);
+#endif
+    }
+
+  ///@} _ContainerHasher-detail
+} // namespace __detail
+    /// @endcond
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // SIMD_SCAN_H
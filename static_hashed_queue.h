@@ -0,0 +1,326 @@
+// static_hashed_queue.h header -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file static_hashed_queue.h
+ *  This is a Standard C++ Library style header.
+ */
+
+#ifndef STATIC_HASHED_QUEUE_H
+#define STATIC_HASHED_QUEUE_H 1
+
+#pragma GCC system_header
+
+#include "container_hasher.h"
+
+namespace stl _GLIBCXX_VISIBILITY(default)
+{
+_GLIBCXX_BEGIN_NAMESPACE_VERSION
+
+  /**
+   *  @brief A FIFO container of at most @a _Nm unique elements, which
+   *  never allocates.
+   *
+   *  As hashed_queue, with the elements in a ring and the index in a
+   *  flat table, both embedded in the object.  push() into a full queue
+   *  fails, returning end() and false, rather than growing.
+   *
+   *  The ring has twice @a _Nm slots: the holes left by extract() and
+   *  erase() are dropped in place when it fills up, which keeps push()
+   *  amortized constant time.
+   *
+   *  @tparam _Value  Type of the elements, move assignable.
+   *  @tparam _Nm  Most elements held at once.
+   *  @tparam _Hash  Hashing function object type, defaults to
+   *                 hash<_Value>.
+   *  @tparam _Pred  Predicate function object type, defaults
+   *                 to equal_to<_Value>.
+   */
+  template<typename _Value, std::size_t _Nm
+          ,typename _Hash = std::hash<_Value>
+          ,typename _Pred = std::equal_to<_Value>>
+    class static_hashed_queue
+    {
+      static_assert(_Nm != 0, "static_hashed_queue must hold an element");
+      static_assert(std::is_move_assignable<_Value>::value
+                    , "static_hashed_queue compacts its elements in place");
+
+      static constexpr std::size_t _S_ring = __detail::__static_capacity(_Nm);
+
+      using _Alloc = std::allocator<_Value>;
+      using _Hashtable
+        = _ContainerHasher<_Value, _Alloc, _Value
+                          , revolver<_Value, _Alloc, _S_ring>
+                          , _Hash, _Pred
+                          , __detail::_Static_flat_index_policy<_Nm>>;
+      _Hashtable _M_h;
+
+    public:
+      using key_type = typename _Hashtable::key_type;
+      using value_type = typename _Hashtable::value_type;
+      using hasher = typename _Hashtable::hasher;
+      using key_equal = typename _Hashtable::key_equal;
+      using container_type = typename _Hashtable::container_type;
+      using size_type = typename _Hashtable::size_type;
+      using difference_type = typename _Hashtable::difference_type;
+      using reference = typename _Hashtable::reference;
+      using const_reference = typename _Hashtable::const_reference;
+      using iterator = typename _Hashtable::iterator;
+      using const_iterator = typename _Hashtable::const_iterator;
+
+      static_hashed_queue() = default;
+
+      explicit
+      static_hashed_queue(const hasher& __hf
+                        , const key_equal& __eql = key_equal())
+      : _M_h(0, __hf, __eql)
+      { }
+
+      // The elements past the capacity are dropped.
+      template<typename _InputIterator>
+        static_hashed_queue(_InputIterator __first, _InputIterator __last
+                          , const hasher& __hf = hasher()
+                          , const key_equal& __eql = key_equal())
+        : _M_h(0, __hf, __eql)
+        { push_range(__first, __last); }
+
+      static_hashed_queue(std::initializer_list<value_type> __l
+                        , const hasher& __hf = hasher()
+                        , const key_equal& __eql = key_equal())
+      : static_hashed_queue(__l.begin(), __l.end(), __hf, __eql)
+      { }
+
+      static_hashed_queue(const static_hashed_queue&) = default;
+      static_hashed_queue(static_hashed_queue&&) = default;
+
+      static_hashed_queue&
+      operator=(const static_hashed_queue&) = default;
+
+      static_hashed_queue&
+      operator=(static_hashed_queue&&) = default;
+
+      // iterators, oldest element first
+      const_iterator
+      begin() const
+      { return _M_h.begin(); }
+
+      const_iterator
+      end() const noexcept
+      { return _M_h.end(); }
+
+      const_iterator
+      cbegin() const
+      { return _M_h.begin(); }
+
+      const_iterator
+      cend() const noexcept
+      { return _M_h.end(); }
+
+      // capacity
+      [[__nodiscard__]] bool
+      empty() const noexcept
+      { return _M_h.empty(); }
+
+      [[__nodiscard__]] bool
+      full() const noexcept
+      { return _M_h.size() == _Nm; }
+
+      size_type
+      size() const noexcept
+      { return _M_h.size(); }
+
+      static constexpr size_type
+      capacity() noexcept
+      { return _Nm; }
+
+      static constexpr size_type
+      max_size() noexcept
+      { return _Nm; }
+
+      // element access
+      const_reference
+      front() const
+      { return _M_h.front(); }
+
+      const_reference
+      back() const noexcept
+      { return _M_h.back(); }
+
+      // modifiers
+      // Fails, returning end() and false, when the queue is full and
+      // __x not in.
+      std::pair<iterator, bool>
+      push(const value_type& __x)
+      { return _M_push(__x); }
+
+      std::pair<iterator, bool>
+      push(value_type&& __x)
+      { return _M_push(std::move(__x)); }
+
+      template<typename... _Args>
+        std::pair<iterator, bool>
+        emplace(_Args&&... __args)
+        { return _M_push(value_type(std::forward<_Args>(__args)...)); }
+
+      // Pushes the elements of [__first, __last) not already in, in order,
+      // until the queue is full. Returns the number pushed.
+      template<typename _InputIterator>
+        size_type
+        push_range(_InputIterator __first, _InputIterator __last)
+        {
+          size_type __n = 0;
+          for (; __first != __last; ++__first)
+            {
+              const auto __res = _M_push(*__first);
+              if (__res.first == end())
+                break;
+              __n += __res.second;
+            }
+          return __n;
+        }
+
+      void
+      pop()
+      { _M_h.pop_front(); }
+
+      // Pops up to __n elements to __out, oldest first.
+      template<typename _OutputIterator>
+        _OutputIterator
+        pop_n(size_type __n, _OutputIterator __out)
+        { return _M_h.pop_front_n(__n, __out); }
+
+      std::optional<value_type>
+      extract(const key_type& __x)
+      { return _M_h.extract(__x); }
+
+      size_type
+      erase(const key_type& __x)
+      { return _M_h.erase(__x); }
+
+      template<typename _Kt>
+        auto
+        erase(const _Kt& __x)
+        -> decltype(_M_h.erase(__x))
+        { return _M_h.erase(__x); }
+
+      void
+      clear() noexcept
+      { _M_h.clear(); }
+
+      void
+      swap(static_hashed_queue& __x)
+      noexcept(noexcept(_M_h.swap(__x._M_h)))
+      { _M_h.swap(__x._M_h); }
+
+      // lookup
+      const_iterator
+      find(const key_type& __x) const
+      { return _M_h.find(__x); }
+
+      size_type
+      count(const key_type& __x) const
+      { return _M_h.count(__x); }
+
+      bool
+      contains(const key_type& __x) const
+      { return _M_h.contains(__x); }
+
+      // Heterogeneous lookup, with transparent hash and key equality types.
+      template<typename _Kt>
+        auto
+        find(const _Kt& __x) const
+        -> decltype(_M_h.find(__x))
+        { return _M_h.find(__x); }
+
+      template<typename _Kt>
+        auto
+        count(const _Kt& __x) const
+        -> decltype(_M_h.count(__x))
+        { return _M_h.count(__x); }
+
+      template<typename _Kt>
+        auto
+        contains(const _Kt& __x) const
+        -> decltype(_M_h.contains(__x))
+        { return _M_h.contains(__x); }
+
+      // Writes whether each key of [__first, __last) is in, to __out.
+      template<typename _ForwardIterator, typename _OutputIterator>
+        _OutputIterator
+        contains_batch(_ForwardIterator __first, _ForwardIterator __last
+                     , _OutputIterator __out) const
+        { return _M_h.contains_batch(__first, __last, __out); }
+
+      // hash policy
+      size_type
+      bucket_count() const noexcept
+      { return _M_h.bucket_count(); }
+
+      float
+      load_factor() const noexcept
+      { return _M_h.load_factor(); }
+
+      float
+      max_load_factor() const noexcept
+      { return _M_h.max_load_factor(); }
+
+      // Drops the holes and the tombstones of the index, in place.
+      void
+      shrink_to_fit()
+      { _M_h.shrink_to_fit(); }
+
+      // observers
+      hasher
+      hash_function() const
+      { return _M_h.hash_function(); }
+
+      key_equal
+      key_eq() const
+      { return _M_h.key_eq(); }
+
+    private:
+      // A ring full of elements and holes is compacted first, which
+      // leaves room for at least _Nm more.
+      template<typename _Arg>
+        std::pair<iterator, bool>
+        _M_push(_Arg&& __x)
+        {
+          if (_M_h.container().size() == _S_ring)
+            _M_h.shrink_to_fit();
+          if (full())
+            return { _M_h.find(__x), false };
+          return _M_h.push_back(std::forward<_Arg>(__x));
+        }
+    };
+
+  template<typename _Value, std::size_t _Nm, typename _Hash, typename _Pred>
+    inline void
+    swap(static_hashed_queue<_Value, _Nm, _Hash, _Pred>& __x
+       , static_hashed_queue<_Value, _Nm, _Hash, _Pred>& __y)
+    noexcept(noexcept(__x.swap(__y)))
+    { __x.swap(__y); }
+
+_GLIBCXX_END_NAMESPACE_VERSION
+} // namespace stl
+
+#endif // STATIC_HASHED_QUEUE_H
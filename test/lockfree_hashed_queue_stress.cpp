@@ -0,0 +1,322 @@
+// lockfree_hashed_queue_stress.cpp -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file lockfree_hashed_queue_stress.cpp
+ *  Multi producer, multi consumer stress of lockfree_hashed_queue with
+ *  keys pushed again and again while they are queued.
+ *
+ *  Build and run, from the top of the tree (add -fsanitize=thread to
+ *  check the memory orders too):
+ *    g++ -std=c++17 -O2 -g -pthread -I. test/lockfree_hashed_queue_stress.cpp
+ *        -o lockfree_hashed_queue_stress && ./lockfree_hashed_queue_stress
+ *
+ *  Usage: lockfree_hashed_queue_stress [--producers P] [--consumers C]
+ *                                      [--pushes N]
+ *  Checks:
+ *    racing    threads pushing the same keys at once, no consumer: each
+ *              key is accepted exactly once
+ *    churn     the same, round after round of fresh keys popped by racing
+ *              threads, over an index full of tombstones
+ *    crowded   keys of one hash code: 32 are queued, the next is refused
+ *              while the ring has room, and accepted after a pop
+ *    no loss   every element accepted is popped once, and only those
+ *    in flight a key is accepted again only after it was popped
+ *    fifo      the elements of a producer come out of each consumer in
+ *              the order the producer pushed them
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "lockfree_hashed_queue.h"
+
+#define VERIFY(__e)                                                     \
+  ((__e) ? (void)0                                                      \
+         : (std::fprintf(stderr, "%s:%d: %s: Assertion '%s' failed.\n"   \
+                         , __FILE__, __LINE__, __func__, #__e)          \
+            , std::abort()))
+
+namespace
+{
+  using queue_type = stl::lockfree_hashed_queue<std::uint64_t>;
+
+  // Ticks taken by pushes and pops, to order them across threads.
+  std::atomic<std::uint64_t> g_clock{0};
+
+  // Producer p owns the keys p << 32 | [0, keys).
+  std::uint64_t
+  make_key(std::size_t p, std::size_t k)
+  { return std::uint64_t(p) << 32 | k; }
+
+  struct event
+  {
+    std::uint64_t key;
+    std::uint64_t tick;
+  };
+
+  // Threads pushing the same keys at once, with no consumer.
+  void
+  test_racing(std::size_t threads)
+  {
+    constexpr std::size_t keys = 4096;
+    queue_type q(keys);
+    std::vector<std::atomic<unsigned>> accepted(keys);
+    std::atomic<bool> go{false};
+    std::vector<std::thread> pool;
+    for (std::size_t t = 0; t != threads; ++t)
+      pool.emplace_back([&, t]
+        {
+          while (!go.load())
+            std::this_thread::yield();
+          // every thread walks the keys from its own end
+          for (std::size_t i = 0; i != keys; ++i)
+            {
+              const std::size_t k = (t & 1) ? keys - 1 - i : i;
+              if (q.try_push(k))
+                accepted[k].fetch_add(1);
+            }
+        });
+    go.store(true);
+    for (auto& th : pool)
+      th.join();
+
+    for (std::size_t k = 0; k != keys; ++k)
+      {
+        VERIFY( accepted[k].load() == 1 );
+        VERIFY( q.contains(k) );
+      }
+    VERIFY( q.size() == keys );
+    for (std::size_t k = 0; k != keys; ++k)
+      VERIFY( !q.try_push(k) );
+  }
+
+  // Rounds of fresh keys pushed, then popped, by racing threads: the
+  // windows of the index fill up with tombstones, and the pops trim the
+  // reach of their home slots.
+  void
+  test_churn(std::size_t threads)
+  {
+    constexpr std::size_t keys = 128;
+    constexpr std::size_t rounds = 200;
+    queue_type q(keys);
+    for (std::size_t r = 0; r != rounds; ++r)
+      {
+        std::vector<std::atomic<unsigned>> accepted(keys);
+        std::vector<std::atomic<unsigned>> popped(keys);
+        std::vector<std::thread> pool;
+        for (std::size_t t = 0; t != threads; ++t)
+          pool.emplace_back([&, t]
+            {
+              for (std::size_t i = 0; i != keys; ++i)
+                {
+                  const std::size_t k = (t & 1) ? keys - 1 - i : i;
+                  if (q.try_push(make_key(r, k)))
+                    accepted[k].fetch_add(1);
+                }
+            });
+        for (auto& th : pool)
+          th.join();
+        pool.clear();
+        for (std::size_t k = 0; k != keys; ++k)
+          {
+            VERIFY( accepted[k].load() == 1 );
+            VERIFY( q.contains(make_key(r, k)) );
+          }
+
+        for (std::size_t t = 0; t != threads; ++t)
+          pool.emplace_back([&]
+            {
+              while (auto v = q.try_pop())
+                {
+                  VERIFY( (*v >> 32) == r && (*v & 0xffffffff) < keys );
+                  popped[*v & 0xffffffff].fetch_add(1);
+                }
+            });
+        for (auto& th : pool)
+          th.join();
+        VERIFY( q.empty() );
+        for (std::size_t k = 0; k != keys; ++k)
+          {
+            VERIFY( popped[k].load() == 1 );
+            VERIFY( !q.contains(make_key(r, k)) );
+          }
+      }
+  }
+
+  // Every key hashes to the same home slot.
+  struct same_hash
+  {
+    std::size_t
+    operator()(std::uint64_t) const noexcept
+    { return 0; }
+  };
+
+  void
+  test_crowded()
+  {
+    constexpr std::size_t window = 32;
+    stl::lockfree_hashed_queue<std::uint64_t, same_hash> q(1024);
+    for (std::uint64_t k = 0; k != window; ++k)
+      VERIFY( q.try_push(k) );
+    VERIFY( !q.try_push(window) );
+    VERIFY( q.size() == window && q.size() < q.capacity() );
+    VERIFY( !q.contains(window) );
+    VERIFY( q.try_pop() == std::uint64_t(0) );
+    VERIFY( q.try_push(window) );
+    VERIFY( q.contains(window) );
+  }
+
+  void
+  test_mpmc(std::size_t producers, std::size_t consumers, std::size_t pushes)
+  {
+    // few keys a producer: most of the pushes find their key queued
+    constexpr std::size_t keys = 4;
+    queue_type q(producers * keys);
+    const std::size_t total = producers * pushes;
+
+    std::vector<std::vector<event>> pushed(producers);
+    std::vector<std::vector<event>> popped(consumers);
+    std::vector<std::size_t> refused(producers);
+    std::atomic<std::size_t> nb_popped{0};
+
+    std::vector<std::thread> pool;
+    for (std::size_t p = 0; p != producers; ++p)
+      pool.emplace_back([&, p]
+        {
+          pushed[p].reserve(pushes);
+          for (std::size_t i = 0; pushed[p].size() != pushes; ++i)
+            {
+              const std::uint64_t key = make_key(p, i % keys);
+              if (q.try_push(key))
+                // ticked after the push took the key
+                pushed[p].push_back({key, g_clock.fetch_add(1)});
+              else if (++refused[p] % 64 == 0)
+                std::this_thread::yield();
+            }
+        });
+    for (std::size_t c = 0; c != consumers; ++c)
+      pool.emplace_back([&, c]
+        {
+          while (nb_popped.load() != total)
+            {
+              // ticked before the pop released the key
+              const std::uint64_t tick = g_clock.fetch_add(1);
+              if (auto v = q.try_pop())
+                {
+                  popped[c].push_back({*v, tick});
+                  nb_popped.fetch_add(1);
+                }
+              else
+                std::this_thread::yield();
+            }
+        });
+    for (auto& th : pool)
+      th.join();
+
+    VERIFY( q.empty() );
+    VERIFY( !q.try_pop() );
+
+    // no loss: the pops of a key match its pushes, one for one
+    std::vector<std::vector<std::uint64_t>> push_ticks(producers * keys);
+    std::vector<std::vector<std::uint64_t>> pop_ticks(producers * keys);
+    for (std::size_t p = 0; p != producers; ++p)
+      for (const event& e : pushed[p])
+        push_ticks[p * keys + (e.key & 0xffffffff)].push_back(e.tick);
+    for (std::size_t c = 0; c != consumers; ++c)
+      for (const event& e : popped[c])
+        {
+          const std::size_t p = e.key >> 32;
+          VERIFY( p < producers && (e.key & 0xffffffff) < keys );
+          pop_ticks[p * keys + (e.key & 0xffffffff)].push_back(e.tick);
+        }
+
+    for (std::size_t k = 0; k != producers * keys; ++k)
+      {
+        auto& pu = push_ticks[k];
+        auto& po = pop_ticks[k];
+        VERIFY( pu.size() == po.size() );
+        std::sort(po.begin(), po.end());
+        // in flight: push n + 1 of a key comes after pop n of it
+        for (std::size_t n = 0; n + 1 < pu.size(); ++n)
+          VERIFY( po[n] < pu[n + 1] );
+      }
+
+    // fifo: what a consumer got of a producer is a subsequence of what
+    // the producer pushed
+    for (std::size_t c = 0; c != consumers; ++c)
+      for (std::size_t p = 0; p != producers; ++p)
+        {
+          std::size_t at = 0;
+          for (const event& e : popped[c])
+            {
+              if ((e.key >> 32) != p)
+                continue;
+              while (at != pushed[p].size() && pushed[p][at].key != e.key)
+                ++at;
+              VERIFY( at != pushed[p].size() );
+              ++at;
+            }
+        }
+
+    std::size_t nb_refused = 0;
+    for (std::size_t r : refused)
+      nb_refused += r;
+    std::printf("mpmc: %zu producers, %zu consumers, %zu pushed, %zu refused\n"
+              , producers, consumers, total, nb_refused);
+  }
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::size_t producers = 4, consumers = 4, pushes = 20000;
+  for (int i = 1; i < argc; ++i)
+    {
+      if (std::strcmp(argv[i], "--producers") == 0 && i + 1 < argc)
+        producers = std::strtoul(argv[++i], nullptr, 10);
+      else if (std::strcmp(argv[i], "--consumers") == 0 && i + 1 < argc)
+        consumers = std::strtoul(argv[++i], nullptr, 10);
+      else if (std::strcmp(argv[i], "--pushes") == 0 && i + 1 < argc)
+        pushes = std::size_t(std::strtod(argv[++i], nullptr));
+      else
+        {
+          std::fprintf(stderr, "usage: %s [--producers P] [--consumers C]"
+                               " [--pushes N]\n", argv[0]);
+          return 1;
+        }
+    }
+  if (producers == 0 || consumers == 0)
+    return 1;
+
+  test_racing(producers + consumers);
+  test_churn(producers + consumers);
+  test_crowded();
+  test_mpmc(producers, consumers, pushes);
+}
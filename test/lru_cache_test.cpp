@@ -0,0 +1,210 @@
+// lru_cache_test.cpp -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file lru_cache_test.cpp
+ *  Checks lru_cache against a std::list of the entries in recency order,
+ *  with every index policy.
+ *
+ *  Build and run, from the top of the tree:
+ *    g++ -std=c++17 -O2 -g -I. test/lru_cache_test.cpp -o lru_cache_test
+ *        && ./lru_cache_test
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lru_cache.h"
+
+#define VERIFY(__e)                                                     \
+  ((__e) ? (void)0                                                      \
+         : (std::fprintf(stderr, "%s:%d: %s: Assertion '%s' failed.\n"   \
+                         , __FILE__, __LINE__, __func__, #__e)          \
+            , std::abort()))
+
+namespace
+{
+  using entry = std::pair<int, std::string>;
+
+  template<typename _Policy>
+    using cache_type
+      = stl::lru_cache<int, std::string, std::hash<int>, std::equal_to<int>
+                     , std::allocator<entry>, _Policy>;
+
+  // Recency order, least recent first.
+  struct model
+  {
+    std::list<entry> l;
+    std::size_t cap;
+
+    std::list<entry>::iterator
+    find(int k)
+    {
+      for (auto it = l.begin(); it != l.end(); ++it)
+        if (it->first == k)
+          return it;
+      return l.end();
+    }
+
+    bool
+    touch(int k)
+    {
+      auto it = find(k);
+      if (it == l.end())
+        return false;
+      l.splice(l.end(), l, it);
+      return true;
+    }
+
+    void
+    insert(int k, std::string v, std::vector<entry>& evicted)
+    {
+      l.emplace_back(k, std::move(v));
+      if (l.size() > cap)
+        {
+          evicted.push_back(std::move(l.front()));
+          l.pop_front();
+        }
+    }
+  };
+
+  template<typename _Policy>
+    void
+    check_equal(const cache_type<_Policy>& c, const model& m)
+    {
+      VERIFY( c.size() == m.l.size() );
+      auto it = m.l.begin();
+      for (const entry& e : c)
+        VERIFY( e == *it++ );
+    }
+
+  // Misses evicting once touches left holes behind: the compaction steps
+  // the evictions take move the new entries down.
+  template<typename _Policy>
+    void
+    test_insert_after_holes()
+    {
+      constexpr int cap = 19;
+      cache_type<_Policy> c(cap);
+      std::mt19937 gen(cap);
+      int next = 0;
+      for (int i = 0; i != 10000; ++i)
+        if (c.size() == cap && gen() % 4 != 0)
+          c.touch(next - 1 - int(gen() % cap));
+        else
+          {
+            const std::string s = "entry " + std::to_string(next);
+            std::string& v = c.get_or_insert(next++, s);
+            VERIFY( v == s );
+            VERIFY( &v == &c.back().second );
+          }
+    }
+
+  template<typename _Policy>
+    void
+    test_model(std::size_t cap)
+    {
+      std::vector<entry> evicted, m_evicted;
+      cache_type<_Policy> c(cap, [&](entry&& e)
+                                 { evicted.push_back(std::move(e)); });
+      model m{{}, cap};
+      std::mt19937 gen(cap);
+      for (int step = 0; step != 100000; ++step)
+        {
+          const int k = int(gen() % (3 * cap));
+          const std::string s = std::to_string(step);
+          switch (gen() % 6)
+            {
+            case 0:
+              VERIFY( c.touch(k) == m.touch(k) );
+              break;
+            case 1:
+              {
+                std::string* p = c.get(k);
+                VERIFY( (p != nullptr) == m.touch(k) );
+                if (p)
+                  {
+                    VERIFY( *p == m.l.back().second );
+                    *p += '+';
+                    m.l.back().second += '+';
+                  }
+              }
+              break;
+            case 2:
+            case 3:
+              {
+                std::string& v = c.get_or_insert(k, s);
+                if (!m.touch(k))
+                  m.insert(k, s, m_evicted);
+                VERIFY( v == m.l.back().second );
+                VERIFY( &v == &c.back().second );
+              }
+              break;
+            case 4:
+              {
+                const bool inserted = c.insert_or_assign(k, s);
+                VERIFY( inserted != m.touch(k) );
+                if (inserted)
+                  m.insert(k, s, m_evicted);
+                else
+                  m.l.back().second = s;
+              }
+              break;
+            default:
+              {
+                auto it = m.find(k);
+                VERIFY( c.erase(k) == (it != m.l.end()) );
+                if (it != m.l.end())
+                  m.l.erase(it);
+              }
+            }
+          VERIFY( c.size() == m.l.size() );
+          if (step % 97 == 0)
+            check_equal(c, m);
+        }
+      check_equal(c, m);
+      VERIFY( evicted == m_evicted );
+    }
+
+  template<typename _Policy>
+    void
+    test_policy()
+    {
+      test_insert_after_holes<_Policy>();
+      for (std::size_t cap : { 1, 2, 19, 64 })
+        test_model<_Policy>(cap);
+    }
+} // namespace
+
+int
+main()
+{
+  test_policy<stl::__detail::_Chained_index_policy>();
+  test_policy<stl::__detail::_Incremental_chained_index_policy>();
+  test_policy<stl::__detail::_Flat_index_policy>();
+}
@@ -0,0 +1,312 @@
+// mapped_queue_test.cpp -*- C++ -*-
+
+// Copyright (C) 2010-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU ISO C++ Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/** @file mapped_queue_test.cpp
+ *  Checks mapped_queue and mapped_stack against a std::list of the
+ *  entries in sequence order, with every index policy, with and without
+ *  inline slots, and with mapped values that cannot be assigned, moved
+ *  to a new container by the compaction. The value column is read alone
+ *  too.
+ *
+ *  Build and run, from the top of the tree:
+ *    g++ -std=c++17 -O2 -g -I. test/mapped_queue_test.cpp
+ *        -o mapped_queue_test && ./mapped_queue_test
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <list>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mapped_queue.h"
+#include "mapped_stack.h"
+
+#define VERIFY(__e)                                                     \
+  ((__e) ? (void)0                                                      \
+         : (std::fprintf(stderr, "%s:%d: %s: Assertion '%s' failed.\n"   \
+                         , __FILE__, __LINE__, __func__, #__e)          \
+            , std::abort()))
+
+namespace
+{
+  // A mapped value that can be moved but not assigned.
+  struct frozen
+  {
+    const std::string s;
+
+    frozen(std::string x)
+    : s(std::move(x))
+    { }
+
+    frozen(const frozen&) = default;
+    frozen(frozen&&) = default;
+    frozen& operator=(frozen&&) = delete;
+
+    bool
+    operator==(const std::string& x) const
+    { return s == x; }
+  };
+
+  const std::string&
+  str(const std::string& v)
+  { return v; }
+
+  const std::string&
+  str(const frozen& v)
+  { return v.s; }
+
+  // Sequence order, oldest first.
+  struct model
+  {
+    std::list<std::pair<int, std::string>> l;
+
+    std::list<std::pair<int, std::string>>::iterator
+    find(int k)
+    {
+      for (auto it = l.begin(); it != l.end(); ++it)
+        if (it->first == k)
+          return it;
+      return l.end();
+    }
+  };
+
+  template<typename _Container>
+    void
+    check_equal(const _Container& c, const model& m)
+    {
+      VERIFY( c.size() == m.l.size() );
+      VERIFY( std::size_t(std::distance(c.begin(), c.end())) == m.l.size() );
+      auto it = m.l.begin();
+      for (const auto& e : c)
+        {
+          VERIFY( e.first == it->first );
+          VERIFY( str(e.second) == it->second );
+          ++it;
+        }
+    }
+
+  // The value column holds the mapped values in sequence order.
+  template<typename _Container>
+    void
+    check_values(_Container& c, const model& m)
+    {
+      const auto& v = c.values();
+      VERIFY( v.size() == m.l.size() );
+      auto it = m.l.begin();
+      for (const auto& e : v)
+        VERIFY( str(e) == (it++)->second );
+      check_equal(c, m);
+    }
+
+  // Pops at the front for a queue, at the back for a stack.
+  template<bool _Stack, typename _Container>
+    void
+    test_model(unsigned seed)
+    {
+      _Container c;
+      model m;
+      std::mt19937 gen(seed);
+      for (int step = 0; step != 100000; ++step)
+        {
+          const int k = int(gen() % 200);
+          const std::string s = std::to_string(step);
+          switch (gen() % 9)
+            {
+            case 0:
+            case 1:
+            case 2:
+              {
+                auto r = c.try_emplace(k, s);
+                const bool in = m.find(k) != m.l.end();
+                VERIFY( r.second != in );
+                if (!in)
+                  m.l.emplace_back(k, s);
+                VERIFY( r.first->first == k );
+                VERIFY( str(r.first->second) == m.find(k)->second );
+              }
+              break;
+            case 3:
+              if (!m.l.empty())
+                {
+                  auto& e = _Stack ? m.l.back() : m.l.front();
+                  if constexpr (_Stack)
+                    VERIFY( c.top().first == e.first );
+                  else
+                    VERIFY( c.front().first == e.first );
+                  c.pop();
+                  _Stack ? m.l.pop_back() : m.l.pop_front();
+                }
+              break;
+            case 4:
+              {
+                auto v = c.extract(k);
+                auto it = m.find(k);
+                VERIFY( bool(v) == (it != m.l.end()) );
+                if (v)
+                  {
+                    VERIFY( v->first == k && str(v->second) == it->second );
+                    m.l.erase(it);
+                  }
+              }
+              break;
+            case 5:
+              {
+                auto it = m.find(k);
+                VERIFY( c.erase(k) == (it != m.l.end()) );
+                if (it != m.l.end())
+                  m.l.erase(it);
+              }
+              break;
+            case 6:
+              {
+                auto r = c.end();
+                if constexpr (_Stack)
+                  r = c.move_to_top(k);
+                else
+                  r = c.move_to_back(k);
+                auto it = m.find(k);
+                VERIFY( (r != c.end()) == (it != m.l.end()) );
+                if (it != m.l.end())
+                  {
+                    VERIFY( r->first == k && str(r->second) == it->second );
+                    m.l.splice(m.l.end(), m.l, it);
+                  }
+              }
+              break;
+            case 7:
+              {
+                auto it = m.find(k);
+                VERIFY( c.contains(k) == (it != m.l.end()) );
+                if (it != m.l.end())
+                  VERIFY( str(c.at(k)) == it->second );
+              }
+              break;
+            default:
+              {
+                std::vector<typename _Container::value_type> out;
+                const std::size_t n = gen() % 4;
+                c.pop_n(n, std::back_inserter(out));
+                VERIFY( out.size() == std::min(n, m.l.size()) );
+                for (auto& v : out)
+                  {
+                    auto& e = _Stack ? m.l.back() : m.l.front();
+                    VERIFY( v.first == e.first && str(v.second) == e.second );
+                    _Stack ? m.l.pop_back() : m.l.pop_front();
+                  }
+              }
+            }
+          VERIFY( c.size() == m.l.size() );
+          if (step % 97 == 0)
+            check_equal(c, m);
+          if (step % 499 == 0)
+            check_values(c, m);
+          if (step % 1009 == 0)
+            {
+              _Container copy(c);
+              check_equal(copy, m);
+              _Container moved(std::move(copy));
+              check_equal(moved, m);
+              c.swap(moved);
+              check_equal(c, m);
+            }
+          if (step % 4999 == 0)
+            {
+              c.shrink_to_fit();
+              check_equal(c, m);
+            }
+        }
+      check_equal(c, m);
+    }
+
+  // Mapped values modified in place, through the iterators, at() and the
+  // element access, while holes come and go, then read from their column.
+  template<typename _Container>
+    void
+    test_modify()
+    {
+      _Container c;
+      for (int k = 0; k != 100; ++k)
+        c.try_emplace(k, 0);
+      for (int k = 0; k < 100; k += 3)
+        c.erase(k);
+      for (auto&& e : c)
+        e.second = e.first * 2;
+      for (int k = 1; k < 100; k += 3)
+        c.at(k) += 1;
+      c.find(2)->second += 1;
+      for (const auto& e : c)
+        VERIFY( e.second == e.first * 2 + (e.first % 3 == 1 || e.first == 2) );
+      std::vector<int> seen;
+      for (const auto& e : c)
+        seen.push_back(e.second);
+      const auto& v = c.values();
+      VERIFY( std::vector<int>(v.begin(), v.end()) == seen );
+      bool threw = false;
+      try
+        {
+          c.at(0);
+        }
+      catch (const std::out_of_range&)
+        {
+          threw = true;
+        }
+      VERIFY( threw );
+    }
+
+  template<typename _Tp, typename _Policy, std::size_t _Nm>
+    using queue_type
+      = stl::mapped_queue<int, _Tp, std::hash<int>, std::equal_to<int>
+                        , std::allocator<std::pair<int, _Tp>>, _Policy, _Nm>;
+
+  template<typename _Tp, typename _Policy, std::size_t _Nm>
+    using stack_type
+      = stl::mapped_stack<int, _Tp, std::hash<int>, std::equal_to<int>
+                        , std::allocator<std::pair<int, _Tp>>, _Policy, _Nm>;
+
+  template<typename _Policy, std::size_t _Nm>
+    void
+    test_policy()
+    {
+      test_model<false, queue_type<std::string, _Policy, _Nm>>(1);
+      test_model<true, stack_type<std::string, _Policy, _Nm>>(2);
+      test_model<false, queue_type<frozen, _Policy, _Nm>>(3);
+      test_model<true, stack_type<frozen, _Policy, _Nm>>(4);
+      test_modify<queue_type<int, _Policy, _Nm>>();
+      test_modify<stack_type<int, _Policy, _Nm>>();
+    }
+} // namespace
+
+int
+main()
+{
+  test_policy<stl::__detail::_Chained_index_policy, 0>();
+  test_policy<stl::__detail::_Chained_index_policy, 8>();
+  test_policy<stl::__detail::_Incremental_chained_index_policy, 0>();
+  test_policy<stl::__detail::_Flat_index_policy, 0>();
+  test_policy<stl::__detail::_Flat_index_policy, 8>();
+}